@@ -0,0 +1,371 @@
+// Checks of the parts of QModUtils that the benchmark doesn't go through, like reading core-mods.json, version ranges and resolving conflicting dependencies
+//
+// Usage: qmod-utils-checks (or ctest in the build folder). Exits with 1 if any check failed
+
+#include "modloader/shared/modloader.hpp"
+
+Logger& getLogger() {
+	static Logger logger;
+	return logger;
+}
+
+#include "qmod-utils/shared/JsonUtils.hpp"
+#include "qmod-utils/shared/Types/FieldDescriptors.hpp"
+#include "qmod-utils/shared/DependencyResolver.hpp"
+#include "qmod-utils/shared/PackageInfo.hpp"
+#include "qmod-utils/shared/Paths.hpp"
+#include "qmod-utils/shared/Semver.hpp"
+
+#include "Generator.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace {
+	int s_Failures = 0;
+
+#define CHECK(condition)                                                                             \
+	do {                                                                                             \
+		if (!(condition)) {                                                                          \
+			std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition);       \
+			s_Failures++;                                                                            \
+		}                                                                                            \
+	} while (0)
+
+	void CheckReadCoreMods() {
+		using namespace QModUtils;
+
+		// Read without in-situ parsing, the same as a downloaded copy. The version we want comes second, so the one before it has to be skipped
+		std::string json = R"({
+			"1.1.0": { "lastUpdated": "2022-01-01T00:00:00Z", "mods": [ { "id": "other-core-mod", "version": "9.9.9" } ] },
+			"1.0.0": {
+				"lastUpdated": "2022-01-01T00:00:00Z",
+				"mods": [
+					{ "id": "core-mod-a", "version": "1.2.3", "downloadLink": "https://example.com/core-mod-a.qmod", "filename": "core-mod-a.qmod" },
+					{ "id": "core-mod-b", "version": "0.4.0" }
+				]
+			}
+		})";
+
+		std::vector<CoreModInfo> coreMods;
+		CHECK(JsonUtils::ReadCoreMods(json.c_str(), "1.0.0", coreMods) == JsonUtils::FindResult::Found);
+		CHECK(coreMods.size() == 2);
+
+		if (coreMods.size() == 2) {
+			CHECK(coreMods[0].id == "core-mod-a");
+			CHECK(coreMods[0].version == "1.2.3");
+			CHECK(coreMods[0].downloadLink == "https://example.com/core-mod-a.qmod");
+			CHECK(coreMods[0].filename == "core-mod-a.qmod");
+
+			CHECK(coreMods[1].id == "core-mod-b");
+			CHECK(coreMods[1].version == "0.4.0");
+		}
+
+		CHECK(JsonUtils::ReadCoreMods(json.c_str(), "2.0.0", coreMods) == JsonUtils::FindResult::NotFound);
+		CHECK(JsonUtils::ReadCoreMods("{ \"1.0.0\": ", "1.0.0", coreMods) == JsonUtils::FindResult::Invalid);
+	}
+
+	void CheckWriteObjectOver() {
+		using namespace QModUtils;
+
+		// Keys that aren't in the field table, like ones a newer BMBF wrote, have to survive a rewrite
+		std::string json = R"({"id":"core-mod-a","future":{"nested":[1,2]},"version":"1.0.0"})";
+
+		rapidjson::Document existing;
+		existing.Parse(json.c_str());
+		CHECK(!existing.HasParseError());
+
+		CoreModInfo info;
+		info.id = "core-mod-a";
+		info.version = "2.0.0";
+		info.downloadLink = "https://example.com/core-mod-a.qmod";
+		info.filename = "core-mod-a.qmod";
+
+		rapidjson::StringBuffer buffer;
+		Fields::JsonWriter writer(buffer);
+		Fields::WriteObjectOver<Fields::FieldTable<CoreModInfo>::fields>(info, existing, writer);
+
+		CHECK(std::string(buffer.GetString(), buffer.GetSize()) ==
+			R"({"id":"core-mod-a","future":{"nested":[1,2]},"version":"2.0.0","downloadLink":"https://example.com/core-mod-a.qmod","filename":"core-mod-a.qmod"})");
+	}
+
+	struct SemverCase {
+		const char* version;
+		const char* range;
+		bool satisfies; // What node-semver's satisfies() gives
+		bool fallback; // Whether our parser rejects the version or the range, so cpp-semver decides
+	};
+
+	void CheckSemver() {
+		using namespace QModUtils;
+
+		static const SemverCase cases[] = {
+			// Plain versions and operators
+			{ "1.2.3", "1.2.3", true, false },
+			{ "1.2.4", "1.2.3", false, false },
+			{ "1.2.3", "=1.2.3", true, false },
+			{ "1.2.3", ">1.2.2", true, false },
+			{ "1.2.2", ">1.2.2", false, false },
+			{ "1.2.3", ">=1.2.3", true, false },
+			{ "1.2.3", "<1.2.3", false, false },
+			{ "1.2.2", "<=1.2.2", true, false },
+			// Hyphen ranges, where a partial upper bound takes in the whole of its last part
+			{ "1.2.3", "1.2.3 - 2.3.4", true, false },
+			{ "2.3.4", "1.2.3 - 2.3.4", true, false },
+			{ "2.3.5", "1.2.3 - 2.3.4", false, false },
+			{ "1.2.2", "1.2.3 - 2.3.4", false, false },
+			{ "2.3.9", "1.2.3 - 2.3", true, false },
+			{ "2.4.0", "1.2.3 - 2.3", false, false },
+			{ "2.9.9", "1.2.3 - 2", true, false },
+			{ "3.0.0", "1.2.3 - 2", false, false },
+			{ "1.0.0", "1.2 - 2.3.4", false, false },
+			{ "1.2.0", "1.2 - 2.3.4", true, false },
+			// X-ranges and partial versions
+			{ "0.0.1", "*", true, false },
+			{ "1.2.3", "", true, false },
+			{ "1.5.0", "1.x", true, false },
+			{ "2.0.0", "1.x", false, false },
+			{ "1.2.9", "1.2.x", true, false },
+			{ "1.3.0", "1.2.x", false, false },
+			{ "1.2.9", "1.2", true, false },
+			{ "1.3.0", "1.2", false, false },
+			{ "2.0.0", ">1", true, false },
+			{ "1.9.9", ">1", false, false },
+			{ "1.0.0", ">=1", true, false },
+			{ "1.9.9", "<=1", true, false },
+			{ "2.0.0", "<=1", false, false },
+			{ "0.9.9", "<1", true, false },
+			{ "1.0.0", "<1", false, false },
+			{ "1.1.9", "<1.2", true, false },
+			{ "1.2.0", "<1.2", false, false },
+			// Tilde allows patch changes, or minor changes if only the major is given
+			{ "1.2.9", "~1.2.3", true, false },
+			{ "1.3.0", "~1.2.3", false, false },
+			{ "1.9.9", "~1", true, false },
+			{ "2.0.0", "~1", false, false },
+			{ "1.2.0", "~1.2", true, false },
+			{ "1.3.0", "~1.2", false, false },
+			// Caret allows changes that don't touch the leftmost non-zero part
+			{ "1.9.9", "^1.2.3", true, false },
+			{ "2.0.0", "^1.2.3", false, false },
+			{ "0.2.9", "^0.2.3", true, false },
+			{ "0.3.0", "^0.2.3", false, false },
+			{ "0.0.3", "^0.0.3", true, false },
+			{ "0.0.4", "^0.0.3", false, false },
+			{ "0.0.9", "^0.0", true, false },
+			{ "0.1.0", "^0.0", false, false },
+			{ "0.9.0", "^0", true, false },
+			{ "1.0.0", "^0", false, false },
+			// Sets of comparators, and || between sets
+			{ "1.2.3", ">= 1.2.3", true, false },
+			{ "1.2.3", ">=1.2.3 <2.0.0", true, false },
+			{ "2.0.0", ">=1.2.3 <2.0.0", false, false },
+			{ "1.0.0", "1.0.0 || 2.0.0", true, false },
+			{ "2.0.0", "1.0.0 || 2.0.0", true, false },
+			{ "3.0.0", "1.0.0 || 2.0.0", false, false },
+			{ "3.1.0", "<2.0.0 || >=3.0.0", true, false },
+			{ "2.5.0", "<2.0.0 || >=3.0.0", false, false },
+			// Prereleases only match a range that opts in to them on the same major.minor.patch. Build metadata is ignored
+			{ "1.2.3-alpha", "1.2.3-alpha", true, false },
+			{ "1.2.3-beta", ">=1.2.3-alpha", true, false },
+			{ "1.2.4-beta", ">=1.2.3-alpha", false, false },
+			{ "1.2.3-alpha", ">=1.2.0", false, false },
+			{ "1.2.3-alpha", "^1.2.3-alpha", true, false },
+			{ "1.2.3-alpha.10", ">1.2.3-alpha.9", true, false },
+			{ "1.2.3-alpha.beta", ">1.2.3-alpha.1", true, false },
+			{ "1.2.3-1", "<1.2.3", false, false },
+			{ "1.2.3", ">1.2.3-rc.1", true, false },
+			{ "2.0.0-0", "<2.0.0", false, false },
+			{ "2.0.0-rc.1", "~1.2.3", false, false },
+			{ "1.2.3+build.5", "1.2.3", true, false },
+			{ "1.2.3", ">=1.2.3+build", true, false },
+			// Leading v, ranges that match nothing, and partial versions or leading zeros, which node-semver rejects
+			{ "1.0", ">=1.0.0", false, true },
+			{ "v1.2.3", "1.2.3", true, false },
+			{ "1.2.3", "<*", false, false },
+			{ "1.2.3", ">*", false, false },
+			{ "01.2.3", ">=1.0.0", false, true },
+			{ "1.2.3-01", ">=1.0.0", false, true },
+			{ "1.2.3-0a", "1.2.3-0a", true, false },
+			{ "1.2.3+001", "1.2.3", true, false },
+			{ "1.2.0", "~01.2", false, true },
+			// Anything our parser rejects goes to cpp-semver. The host stand in treats it as not satisfied, as node-semver does
+			{ "not-a-version", "*", false, true },
+			{ "1.2.3", "foo", false, true },
+		};
+
+		for (const SemverCase& semverCase : cases) {
+			Semver::Version version;
+			Semver::Range range;
+			bool fallback = !Semver::ParseVersion(semverCase.version, version) || !Semver::CompileRange(semverCase.range, range);
+
+			if (Semver::Satisfies(semverCase.version, semverCase.range) != semverCase.satisfies || fallback != semverCase.fallback) {
+				std::fprintf(stderr, "%s:%d: check failed: \"%s\" against \"%s\" should %s%s\n", __FILE__, __LINE__, semverCase.version, semverCase.range,
+					semverCase.satisfies ? "satisfy it" : "not satisfy it", semverCase.fallback ? ", through cpp-semver" : "");
+				s_Failures++;
+			}
+		}
+
+		// Precedence from the semver spec, each lower than the next
+		static const char* ordered[] = {
+			"1.0.0-alpha", "1.0.0-alpha.1", "1.0.0-alpha.beta", "1.0.0-beta", "1.0.0-beta.2", "1.0.0-beta.11", "1.0.0-rc.1", "1.0.0", "1.0.1", "1.1.0", "2.0.0"
+		};
+
+		for (size_t i = 0; i + 1 < std::size(ordered); i++) {
+			CHECK(Semver::Compare(Semver::InternVersion(ordered[i]), Semver::InternVersion(ordered[i + 1])) < 0);
+			CHECK(Semver::Compare(Semver::InternVersion(ordered[i + 1]), Semver::InternVersion(ordered[i])) > 0);
+		}
+
+		CHECK(Semver::Compare(Semver::InternVersion("1.0.0+build.1"), Semver::InternVersion("1.0.0")) == 0);
+	}
+
+	struct ModSpec {
+		std::string id;
+		std::string version;
+		std::string dependencies; // id:range pairs, separated by commas
+		bool installed = false;
+	};
+
+	/**
+	 * @brief Starts from an empty mod folder, and loads a .qmod for each spec. The first version of each mod loaded is the active one, so installed ones go first
+	 */
+	std::vector<QModUtils::QMod*> LoadMods(const std::vector<ModSpec>& specs) {
+		using namespace QModUtils;
+
+		QMod::ClearDownloadedQMods();
+		std::system(("rm -rf \"" + Paths::Root() + "\"").c_str());
+		FileUtils::MakeDirs(Paths::Mods());
+		FileUtils::MakeDirs(Paths::BMBFData());
+
+		std::string config = "{\"Mods\":[";
+		for (const ModSpec& spec : specs) {
+			if (config.back() != '[') config += ",";
+			config += Bench::BMBFEntry(spec.id, spec.id, spec.installed);
+		}
+		config += "],\"Playlists\":[],\"IsCommitted\":true,\"SyncConfig\":null}";
+
+		FILE* file = std::fopen(Paths::Config().c_str(), "wb");
+		if (file != nullptr) {
+			std::fwrite(config.data(), 1, config.size(), file);
+			std::fclose(file);
+		}
+
+		std::vector<QMod*> mods;
+
+		for (const ModSpec& spec : specs) {
+			std::string dependencies;
+			std::string_view rest = spec.dependencies;
+
+			while (!rest.empty()) {
+				std::string_view pair = rest.substr(0, rest.find(','));
+				rest.remove_prefix(std::min(rest.size(), pair.size() + 1));
+
+				size_t colon = pair.find(':');
+				if (!dependencies.empty()) dependencies += ",";
+				dependencies += "{\"id\":\"" + std::string(pair.substr(0, colon)) + "\",\"version\":\"" + std::string(pair.substr(colon + 1)) + "\"}";
+			}
+
+			std::string modJson = "{\"_QPVersion\":\"0.1.1\",\"name\":\"" + spec.id + "\",\"id\":\"" + spec.id + "\",\"author\":\"Checks\",\"version\":\"" + spec.version + "\","
+				"\"packageId\":\"com.beatgames.beatsaber\",\"packageVersion\":\"1.0.0\",\"description\":\"\",\"isLibrary\":false,"
+				"\"dependencies\":[" + dependencies + "],\"modFiles\":[],\"libraryFiles\":[],\"fileCopies\":[]}";
+
+			Bench::ZipWriter zip;
+			zip.Add("mod.json", modJson);
+
+			std::string path = Paths::Mods() + spec.id + "@" + spec.version + ".qmod";
+			zip.Write(path);
+
+			mods.push_back(new QMod(path));
+		}
+
+		return mods;
+	}
+
+	std::string PickedVersion(const QModUtils::DependencyResolver::Plan& plan, const std::string& id) {
+		for (const QModUtils::DependencyResolver::Step& step : plan.steps) {
+			if (step.id == id && step.mod != nullptr) return std::string(step.mod->Version());
+		}
+
+		return "";
+	}
+
+	void CheckResolve() {
+		using namespace QModUtils;
+
+		Paths::SetRoot("/tmp/qmod-utils-checks");
+		PackageInfo::SetProvider([]() { return PackageInfo::Info { "com.beatgames.beatsaber", "1.0.0" }; });
+
+		{
+			// The installed b 0.1.0 wants a below 2, but the plan upgrades b to a version that wants a 2 or above, so the old range no longer counts
+			std::vector<QMod*> mods = LoadMods({
+				{ "a", "1.0.0", "", true }, { "a", "2.0.0" },
+				{ "b", "0.1.0", "a:<2.0.0", true }, { "b", "1.0.0", "a:>=2.0.0" },
+				{ "c", "1.0.0", "b:^1.0.0" },
+			});
+
+			DependencyResolver::Plan plan = DependencyResolver::Resolve({ mods.back() });
+			CHECK(plan.valid);
+			CHECK(PickedVersion(plan, "a") == "2.0.0");
+			CHECK(PickedVersion(plan, "b") == "1.0.0");
+		}
+
+		{
+			// x 2.0.0 is the highest, but only x 1.0.0 works with the y that t needs, so the first pick has to be gone back on
+			std::vector<QMod*> mods = LoadMods({
+				{ "x", "1.0.0", "y:^1.0.0" }, { "x", "2.0.0", "y:>=2.0.0" },
+				{ "y", "1.0.0" },
+				{ "t", "1.0.0", "x:*,y:^1.0.0" },
+			});
+
+			DependencyResolver::Plan plan = DependencyResolver::Resolve({ mods.back() });
+			CHECK(plan.valid);
+			CHECK(plan.error.empty());
+			CHECK(PickedVersion(plan, "x") == "1.0.0");
+		}
+
+		{
+			// An installed mod outside of the plan still stops it changing what it depends on
+			std::vector<QMod*> mods = LoadMods({
+				{ "a", "1.0.0", "", true }, { "a", "2.0.0" },
+				{ "d", "1.0.0", "a:<2.0.0", true },
+				{ "t", "1.0.0", "a:>=2.0.0" },
+			});
+
+			DependencyResolver::Plan plan = DependencyResolver::Resolve({ mods.back() });
+			CHECK(!plan.valid);
+			CHECK(plan.error.find("\"d\" v1.0.0") != std::string::npos);
+		}
+
+		{
+			// The installed version is kept when it fits, even with a higher one around
+			std::vector<QMod*> mods = LoadMods({
+				{ "a", "1.0.0", "", true }, { "a", "1.5.0" },
+				{ "t", "1.0.0", "a:>=1.0.0" },
+			});
+
+			DependencyResolver::Plan plan = DependencyResolver::Resolve({ mods.back() });
+			CHECK(plan.valid);
+			CHECK(PickedVersion(plan, "a") == "1.0.0");
+		}
+
+		QMod::ClearDownloadedQMods();
+	}
+}
+
+int main() {
+	CheckReadCoreMods();
+	CheckWriteObjectOver();
+	CheckSemver();
+	CheckResolve();
+
+	if (s_Failures != 0) {
+		std::fprintf(stderr, "%d checks failed\n", s_Failures);
+		return 1;
+	}
+
+	std::printf("All checks passed\n");
+	return 0;
+}
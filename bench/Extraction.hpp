@@ -0,0 +1,140 @@
+#pragma once
+
+#include "qmod-utils/shared/FileUtils.hpp"
+#include "qmod-utils/shared/ZipUtils.hpp"
+
+#include "Generator.hpp"
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace Bench {
+	struct ExtractionOptions {
+		int fileCount = 8;
+		size_t fileSize = 2 * 1024 * 1024;
+		bool deflate = true; // Real QMods are deflated, stored ones show the cost of the copy on its own
+		int repetitions = 5;
+	};
+
+	struct ExtractionResult {
+		bool valid = false;
+		uint64_t uncompressedSize = 0;
+		uint64_t archiveSize = 0;
+
+		// The fastest repetition of each, as both read the archive from the page cache
+		double unzipMs = 0;
+		double inProcessMs = 0;
+	};
+
+	/**
+	 * @brief Bytes that compress about as well as a .so: mostly a handful of common ones, with random ones mixed in
+	 */
+	inline std::string CodeLikeBytes(uint64_t seed, size_t size) {
+		static const char common[16] = { 0x00, 0x00, 0x00, 0x00, (char)0xff, (char)0xe0, (char)0x03, (char)0x1f, (char)0x91, (char)0xd6, (char)0x5f, (char)0xf9, (char)0x40, (char)0xa9, (char)0xb4, 0x01 };
+
+		std::string data = RandomBytes(seed, size);
+
+		for (size_t i = 0; i < size; i++) {
+			uint8_t value = (uint8_t)data[i];
+			if ((value & 3) != 0) data[i] = common[value >> 4];
+		}
+
+		return data;
+	}
+
+	inline bool WriteBenchFile(const std::string& path, const std::string& data) {
+		FILE* file = std::fopen(path.c_str(), "wb");
+		if (file == nullptr) return false;
+
+		bool ok = std::fwrite(data.data(), 1, data.size(), file) == data.size();
+		return std::fclose(file) == 0 && ok;
+	}
+
+	/**
+	 * @brief Times extracting every file of a QMod the way it used to be done (an unzip process per file), against ZipReader
+	 * @details The QMod is made with the system zip, so it's compressed the same way a real one is. Every extracted file is checked against its CRC-32
+	 *
+	 * @param folder Where the QMod and the extracted files go. It's emptied first
+	 */
+	inline ExtractionResult CompareExtraction(const std::string& folder, const ExtractionOptions& options = {}) {
+		using namespace QModUtils;
+
+		ExtractionResult result;
+
+		std::string payload = folder + "/payload/";
+		std::string archive = folder + "/bench.qmod";
+		std::string out = folder + "/out/";
+
+		std::system(("rm -rf \"" + folder + "\"").c_str());
+		if (!FileUtils::MakeDirs(payload)) return result;
+
+		for (int i = 0; i < options.fileCount; i++) {
+			if (!WriteBenchFile(payload + "libbench" + std::to_string(i) + ".so", CodeLikeBytes(4000000 + i, options.fileSize))) return result;
+		}
+
+		std::string zipCommand = "cd \"" + payload + "\" && zip -q -X -r " + (options.deflate ? "" : "-0 ") + "\"" + archive + "\" .";
+		if (std::system(zipCommand.c_str()) != 0) return result;
+
+		ZipUtils::ZipReader reader;
+		if (!reader.Open(archive)) return result;
+
+		std::vector<ZipUtils::ZipEntry> entries = reader.Entries();
+		reader.Close();
+
+		struct stat st;
+		if (stat(archive.c_str(), &st) != 0) return result;
+		result.archiveSize = st.st_size;
+
+		for (const ZipUtils::ZipEntry& entry : entries) result.uncompressedSize += entry.uncompressedSize;
+
+		auto Verify = [&]() {
+			return std::all_of(entries.begin(), entries.end(), [&](const ZipUtils::ZipEntry& entry) { return ZipUtils::MatchesEntry(out + entry.name, entry); });
+		};
+
+		auto Time = [&](auto&& extract, double& fastest) {
+			for (int repetition = 0; repetition < options.repetitions; repetition++) {
+				std::system(("rm -rf \"" + out + "\"").c_str());
+				if (!FileUtils::MakeDirs(out)) return false;
+
+				auto start = std::chrono::steady_clock::now();
+				if (!extract()) return false;
+				double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+				if (!Verify()) return false;
+				if (repetition == 0 || ms < fastest) fastest = ms;
+			}
+
+			return true;
+		};
+
+		bool unzipped = Time([&]() {
+			for (const ZipUtils::ZipEntry& entry : entries) {
+				std::string command = "unzip -q -o \"" + archive + "\" \"" + entry.name + "\" -d \"" + out + "\"";
+				if (std::system(command.c_str()) != 0) return false;
+			}
+
+			return true;
+		}, result.unzipMs);
+
+		bool extracted = Time([&]() {
+			ZipUtils::ZipReader zip;
+			if (!zip.Open(archive)) return false;
+
+			for (const ZipUtils::ZipEntry& entry : zip.Entries()) {
+				if (!zip.Extract(entry, out + entry.name)) return false;
+			}
+
+			return true;
+		}, result.inProcessMs);
+
+		result.valid = unzipped && extracted;
+		return result;
+	}
+}
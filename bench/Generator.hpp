@@ -0,0 +1,231 @@
+#pragma once
+
+#include "qmod-utils/shared/FileUtils.hpp"
+#include "qmod-utils/shared/Paths.hpp"
+#include "qmod-utils/shared/ZipUtils.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace Bench {
+	struct TreeOptions {
+		int modCount = 100;
+
+		int maxDependencies = 3; // Each mod depends on up to this many of the mods generated before it
+		int sharedLibCount = 16; // Libraries that are shipped by more than one mod
+		int fillerEntriesPerMod = 4; // Entries in the config.json that don't belong to any generated mod
+		int songsPerMod = 20; // Playlist entries in the config.json, so it's about as big as a real one
+
+		size_t modFileSize = 64 * 1024;
+		size_t sharedLibSize = 128 * 1024;
+		size_t fileCopySize = 4 * 1024;
+		size_t coverSize = 8 * 1024;
+
+		std::string packageId = "com.beatgames.beatsaber";
+		std::string packageVersion = "1.0.0";
+	};
+
+	// xorshift64, seeded per file so a shared library has the same bytes in every mod that ships it
+	inline std::string RandomBytes(uint64_t seed, size_t size) {
+		std::string data(size, '\0');
+		uint64_t state = seed * 0x9E3779B97F4A7C15ull + 1;
+
+		for (size_t i = 0; i < size; i++) {
+			state ^= state << 13;
+			state ^= state >> 7;
+			state ^= state << 17;
+			data[i] = (char)state;
+		}
+
+		return data;
+	}
+
+	/**
+	 * @brief Writes an uncompressed zip, which is all a QMod needs to be
+	 */
+	class ZipWriter {
+	public:
+		void Add(const std::string& name, const std::string& data) {
+			uint32_t crc = QModUtils::ZipUtils::Crc32(data.data(), data.size());
+
+			m_Entries.push_back({ name, crc, (uint32_t)data.size(), (uint32_t)m_Data.size() });
+
+			PutU32(m_Data, 0x04034b50);
+			PutU16(m_Data, 20); // Version needed
+			PutU16(m_Data, 0); // Flags
+			PutU16(m_Data, 0); // Stored
+			PutU16(m_Data, 0); // Time
+			PutU16(m_Data, 0x21); // Date, 1980-01-01
+			PutU32(m_Data, crc);
+			PutU32(m_Data, data.size());
+			PutU32(m_Data, data.size());
+			PutU16(m_Data, name.size());
+			PutU16(m_Data, 0); // Extra length
+
+			m_Data += name;
+			m_Data += data;
+		}
+
+		bool Write(const std::string& path) {
+			std::string directory;
+			for (const Entry& entry : m_Entries) {
+				PutU32(directory, 0x02014b50);
+				PutU16(directory, 20); // Version made by
+				PutU16(directory, 20); // Version needed
+				PutU16(directory, 0);
+				PutU16(directory, 0);
+				PutU16(directory, 0);
+				PutU16(directory, 0x21);
+				PutU32(directory, entry.crc32);
+				PutU32(directory, entry.size);
+				PutU32(directory, entry.size);
+				PutU16(directory, entry.name.size());
+				PutU16(directory, 0); // Extra length
+				PutU16(directory, 0); // Comment length
+				PutU16(directory, 0); // Disk
+				PutU16(directory, 0); // Internal attributes
+				PutU32(directory, 0); // External attributes
+				PutU32(directory, entry.offset);
+
+				directory += entry.name;
+			}
+
+			std::string end;
+			PutU32(end, 0x06054b50);
+			PutU16(end, 0);
+			PutU16(end, 0);
+			PutU16(end, m_Entries.size());
+			PutU16(end, m_Entries.size());
+			PutU32(end, directory.size());
+			PutU32(end, m_Data.size());
+			PutU16(end, 0);
+
+			FILE* file = std::fopen(path.c_str(), "wb");
+			if (file == nullptr) return false;
+
+			bool ok = std::fwrite(m_Data.data(), 1, m_Data.size(), file) == m_Data.size()
+				&& std::fwrite(directory.data(), 1, directory.size(), file) == directory.size()
+				&& std::fwrite(end.data(), 1, end.size(), file) == end.size();
+
+			return std::fclose(file) == 0 && ok;
+		}
+
+	private:
+		struct Entry {
+			std::string name;
+			uint32_t crc32;
+			uint32_t size;
+			uint32_t offset;
+		};
+
+		std::vector<Entry> m_Entries;
+		std::string m_Data;
+
+		static void PutU16(std::string& out, uint16_t value) {
+			out += (char)(value & 0xFF);
+			out += (char)(value >> 8);
+		}
+
+		static void PutU32(std::string& out, uint32_t value) {
+			PutU16(out, value & 0xFFFF);
+			PutU16(out, value >> 16);
+		}
+	};
+
+	inline std::string ModId(int index) {
+		char id[32];
+		std::snprintf(id, sizeof(id), "bench-mod-%04d", index);
+		return id;
+	}
+
+	inline std::string BMBFEntry(const std::string& id, const std::string& name, bool installed) {
+		return "{\"Id\":\"" + id + "\",\"Name\":\"" + name + "\",\"Author\":\"Bench\",\"Porter\":null,\"Version\":\"1.0.0\","
+			"\"Description\":\"A mod made up by the benchmark generator, to make this file about as big as a real one\","
+			"\"TargetBeatsaberVersion\":\"1.0.0\",\"Installed\":" + (installed ? "true" : "false") + ",\"Uninstallable\":true,"
+			"\"CoverImageFilename\":null,\"Path\":\"/sdcard/BMBFData/Mods/" + id + ".qmod\",\"RemovingOnSync\":false,\"TogglingOnSync\":false}";
+	}
+
+	/**
+	 * @brief Fills the current Paths root with QMods and a BMBF config.json
+	 * @details Mod i depends on up to maxDependencies of the mods before it, so the graph is acyclic and mods further down have deeper trees.
+	 * Every mod has a library of its own, one of the shared libraries, a file copy, and a cover image
+	 */
+	inline bool GenerateTree(const TreeOptions& options) {
+		using namespace QModUtils;
+
+		for (const std::string& dir : { Paths::Mods(), Paths::GameMods(), Paths::GameLibs() }) {
+			if (!FileUtils::MakeDirs(dir)) return false;
+		}
+
+		uint64_t seed = 0x5EED;
+		auto Next = [&seed]() {
+			seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+			return seed >> 33;
+		};
+
+		for (int i = 0; i < options.modCount; i++) {
+			std::string id = ModId(i);
+			int sharedLib = i % options.sharedLibCount;
+
+			std::string dependencies;
+			int dependencyCount = i == 0 ? 0 : (int)(Next() % (options.maxDependencies + 1));
+
+			for (int d = 0; d < dependencyCount; d++) {
+				int dependency = (int)(Next() % i);
+
+				if (dependencies.find(ModId(dependency)) != std::string::npos) continue;
+				if (!dependencies.empty()) dependencies += ",";
+
+				dependencies += "{\"id\":\"" + ModId(dependency) + "\",\"version\":\"^1.0.0\"}";
+			}
+
+			std::string modJson = "{\"_QPVersion\":\"0.1.1\",\"name\":\"Bench Mod " + std::to_string(i) + "\",\"id\":\"" + id + "\",\"author\":\"Bench\","
+				"\"version\":\"1.0.0\",\"packageId\":\"" + options.packageId + "\",\"packageVersion\":\"" + options.packageVersion + "\","
+				"\"description\":\"Generated\",\"coverImage\":\"cover.png\",\"isLibrary\":false,"
+				"\"dependencies\":[" + dependencies + "],"
+				"\"modFiles\":[\"lib" + id + ".so\"],"
+				"\"libraryFiles\":[\"libshared" + std::to_string(sharedLib) + ".so\"],"
+				"\"fileCopies\":[{\"name\":\"data.bin\",\"destination\":\"" + Paths::Root() + "/ModData/" + id + "/data.bin\"}]}";
+
+			ZipWriter zip;
+			zip.Add("mod.json", modJson);
+			zip.Add("lib" + id + ".so", RandomBytes(1000000 + i, options.modFileSize));
+			zip.Add("libshared" + std::to_string(sharedLib) + ".so", RandomBytes(sharedLib, options.sharedLibSize));
+			zip.Add("data.bin", RandomBytes(2000000 + i, options.fileCopySize));
+			zip.Add("cover.png", RandomBytes(3000000 + i, options.coverSize));
+
+			if (!zip.Write(Paths::Mods() + id + ".qmod")) return false;
+		}
+
+		// Every generated mod has an entry, along with a lot of entries and songs that aren't ours
+		std::string config = "{\"Mods\":[";
+
+		for (int i = 0; i < options.modCount; i++) {
+			if (i != 0) config += ",";
+			config += BMBFEntry(ModId(i), "Bench Mod " + std::to_string(i), false);
+
+			for (int f = 0; f < options.fillerEntriesPerMod; f++) {
+				config += ",";
+				config += BMBFEntry("filler-" + std::to_string(i) + "-" + std::to_string(f), "Filler", true);
+			}
+		}
+
+		config += "],\"Playlists\":[{\"PlaylistID\":\"CustomSongs\",\"PlaylistName\":\"Custom Songs\",\"SongList\":[";
+
+		for (int i = 0; i < options.modCount * options.songsPerMod; i++) {
+			if (i != 0) config += ",";
+			config += "{\"SongID\":\"custom_level_" + std::to_string(i) + "\",\"SongName\":\"Song " + std::to_string(i) + "\","
+				"\"SongSubName\":\"\",\"SongAuthorName\":\"Bench\",\"LevelAuthorName\":\"Bench\",\"CustomSongPath\":\"/sdcard/BMBFData/CustomSongs/" + std::to_string(i) + "\"}";
+		}
+
+		config += "]}],\"IsCommitted\":true,\"SyncConfig\":null}";
+
+		FILE* file = std::fopen(Paths::Config().c_str(), "wb");
+		if (file == nullptr) return false;
+
+		bool ok = std::fwrite(config.data(), 1, config.size(), file) == config.size();
+		return std::fclose(file) == 0 && ok;
+	}
+}
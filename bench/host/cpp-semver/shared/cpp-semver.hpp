@@ -0,0 +1,11 @@
+#pragma once
+
+// Host stand in for cpp-semver. QModUtils only falls back to it for versions it can't parse itself, which the generated mods never have
+#include <stdexcept>
+#include <string>
+
+namespace semver {
+	inline bool satisfies(const std::string& version, const std::string& range) {
+		throw std::runtime_error("cpp-semver isn't available on the host (\"" + version + "\" against \"" + range + "\")");
+	}
+}
@@ -0,0 +1,4 @@
+#pragma once
+
+// Host stand in for the libcurl package, the system's libcurl is used instead
+#include <curl/curl.h>
@@ -0,0 +1,71 @@
+#pragma once
+
+// Host stand in for the modloader, with just enough of it for QModUtils to run outside of the game
+
+#include <cstdarg>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+// The real modloader header (through beatsaber-hook's logging) brings these in, and QModUtils leans on that
+#include <algorithm>
+#include <functional>
+#include <optional>
+#include <thread>
+#include <vector>
+#include <dlfcn.h>
+
+struct Logger {
+	// Logging is off by default, so it doesn't show up in the numbers
+	inline static bool enabled = false;
+
+	void Log(const char* level, const char* format, va_list args) {
+		if (!enabled) return;
+
+		std::fprintf(stderr, "[%s] ", level);
+		std::vfprintf(stderr, format, args);
+		std::fputc('\n', stderr);
+	}
+
+	void info(const char* format, ...) { va_list args; va_start(args, format); Log("I", format, args); va_end(args); }
+	void debug(const char* format, ...) { va_list args; va_start(args, format); Log("D", format, args); va_end(args); }
+	void warning(const char* format, ...) { va_list args; va_start(args, format); Log("W", format, args); va_end(args); }
+	void error(const char* format, ...) { va_list args; va_start(args, format); Log("E", format, args); va_end(args); }
+	void critical(const char* format, ...) { va_list args; va_start(args, format); Log("C", format, args); va_end(args); }
+};
+
+template<typename... TArgs>
+inline std::string string_format(const std::string_view format, TArgs... args) {
+	std::string fmt(format);
+
+	int size = std::snprintf(nullptr, 0, fmt.c_str(), args...);
+	if (size <= 0) return "";
+
+	std::string result(size, '\0');
+	std::snprintf(result.data(), size + 1, fmt.c_str(), args...);
+
+	return result;
+}
+
+struct ModInfo {
+	std::string name;
+	std::string id;
+	std::string version;
+};
+
+namespace Modloader {
+	// Nothing is ever loaded on the host
+	inline std::unordered_map<std::string, ModInfo>& loadedMods() {
+		static std::unordered_map<std::string, ModInfo> mods;
+		return mods;
+	}
+
+	inline std::string& destinationPath() {
+		static std::string path;
+		return path;
+	}
+
+	inline std::unordered_map<std::string, ModInfo> getMods() { return loadedMods(); }
+	inline std::string getDestinationPath() { return destinationPath(); }
+}
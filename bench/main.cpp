@@ -0,0 +1,239 @@
+// Runs the slow parts of QModUtils against a generated mod tree, and reports the wall time, syscalls and allocations of each
+//
+// Usage: qmod-utils-bench [root] [mod counts...]
+// Every mod count gets its own folder under root (by default /tmp/qmod-utils-bench), and its own process, as QModUtils' state is global
+
+#include "modloader/shared/modloader.hpp"
+
+Logger& getLogger() {
+	static Logger logger;
+	return logger;
+}
+
+#include "qmod-utils/shared/QModUtils.hpp"
+#include "qmod-utils/shared/PackageInfo.hpp"
+#include "qmod-utils/shared/Paths.hpp"
+#include "qmod-utils/shared/Trace.hpp"
+#include "qmod-utils/shared/Metrics.hpp"
+#include "qmod-utils/shared/Background.hpp"
+
+#include "Generator.hpp"
+#include "Extraction.hpp"
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <vector>
+
+// Every allocation goes through here, so each operation can report how many it made
+
+static std::atomic<uint64_t> s_Allocations = 0;
+
+void* operator new(size_t size) {
+	s_Allocations.fetch_add(1, std::memory_order_relaxed);
+
+	if (void* pointer = std::malloc(size ? size : 1)) return pointer;
+	throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) {
+	return operator new(size);
+}
+
+void operator delete(void* pointer) noexcept { std::free(pointer); }
+void operator delete[](void* pointer) noexcept { std::free(pointer); }
+void operator delete(void* pointer, size_t) noexcept { std::free(pointer); }
+void operator delete[](void* pointer, size_t) noexcept { std::free(pointer); }
+
+namespace {
+	struct Counters {
+		std::chrono::steady_clock::time_point time;
+		uint64_t readCalls = 0;
+		uint64_t writeCalls = 0;
+		uint64_t allocations = 0;
+	};
+
+	// syscr and syscw are every read and write like syscall this process (all of its threads) has made. Children spawned with std::system aren't counted
+	Counters Sample() {
+		Counters counters;
+
+		if (FILE* io = std::fopen("/proc/self/io", "r")) {
+			char line[128];
+
+			while (std::fgets(line, sizeof(line), io)) {
+				unsigned long long value;
+
+				if (std::sscanf(line, "syscr: %llu", &value) == 1) counters.readCalls = value;
+				else if (std::sscanf(line, "syscw: %llu", &value) == 1) counters.writeCalls = value;
+			}
+
+			std::fclose(io);
+		}
+
+		counters.allocations = s_Allocations.load(std::memory_order_relaxed);
+		counters.time = std::chrono::steady_clock::now();
+
+		return counters;
+	}
+
+	// What taking a Sample adds to the next one's counters, as reading /proc/self/io is itself a few read calls
+	Counters SampleOverhead() {
+		Counters first = Sample();
+		Counters second = Sample();
+
+		Counters overhead;
+		overhead.readCalls = second.readCalls - first.readCalls;
+		overhead.writeCalls = second.writeCalls - first.writeCalls;
+		overhead.allocations = second.allocations - first.allocations;
+
+		return overhead;
+	}
+
+	template<typename F>
+	void Measure(int modCount, const char* operation, F&& function) {
+		static const Counters overhead = SampleOverhead();
+
+		Counters before = Sample();
+		function();
+		Counters after = Sample();
+
+		double ms = std::chrono::duration<double, std::milli>(after.time - before.time).count();
+
+		std::printf("%6d  %-28s %12.3f %12llu %12llu %14llu\n", modCount, operation, ms,
+			(unsigned long long)(after.readCalls - before.readCalls - overhead.readCalls),
+			(unsigned long long)(after.writeCalls - before.writeCalls - overhead.writeCalls),
+			(unsigned long long)(after.allocations - before.allocations - overhead.allocations));
+		std::fflush(stdout);
+	}
+
+	std::vector<QModUtils::QMod*> BenchMods() {
+		std::vector<QModUtils::QMod*> mods;
+
+		for (QModUtils::QMod* qmod : QModUtils::QMod::DownloadedQMods()) {
+			if (qmod->Id().starts_with("bench-mod-")) mods.push_back(qmod);
+		}
+
+		return mods;
+	}
+
+	int Run(const std::string& root, int modCount) {
+		using namespace QModUtils;
+
+		std::system(("rm -rf \"" + root + "\"").c_str());
+
+		Paths::SetRoot(root);
+		Modloader::destinationPath() = Paths::GameMods();
+
+		Bench::TreeOptions options;
+		options.modCount = modCount;
+
+		PackageInfo::SetProvider([options]() { return PackageInfo::Info { options.packageId, options.packageVersion }; });
+
+		if (!Bench::GenerateTree(options)) {
+			std::fprintf(stderr, "Failed to generate %d mods under \"%s\"\n", modCount, root.c_str());
+			return 1;
+		}
+
+		// The core mods list is on the network, so it's left out
+		Measure(modCount, "Init", []() { Init(false); });
+
+		std::vector<QMod*> mods = BenchMods();
+		if ((int)mods.size() != modCount) {
+			std::fprintf(stderr, "Only %zu of the %d generated mods were found\n", mods.size(), modCount);
+			return 1;
+		}
+
+		Measure(modCount, "CacheDownloadedMods (rescan)", []() { CacheDownloadedMods(); });
+		mods = BenchMods();
+
+		Measure(modCount, "Install all (plan)", [&mods]() { DependencyResolver::ExecutePlan(mods); });
+
+		Measure(modCount, "UpdateBMBFData (every mod)", [&mods]() {
+			for (QMod* mod : mods) mod->UpdateBMBFData(false);
+		});
+
+		Measure(modCount, "Reinstall one", [&mods]() { mods.back()->Reinstall(true); });
+
+		Measure(modCount, "Uninstall all", [&mods]() {
+			for (QMod* mod : mods) {
+				if (mod->IsInstalled()) mod->Uninstall(true, true, true);
+			}
+		});
+
+		Measure(modCount, "Install one (with deps)", [&mods]() { mods.back()->Install(true); });
+
+		if (const char* tracePath = std::getenv("QMODUTILS_BENCH_TRACE")) Trace::ExportChrome(string_format("%s.%d.json", tracePath, modCount));
+		if (std::getenv("QMODUTILS_BENCH_METRICS")) std::fprintf(stderr, "%d mods: %s\n", modCount, Metrics::ToJson(Metrics::TakeSnapshot()).c_str());
+
+		return 0;
+	}
+
+	// Extracting a QMod with an unzip process per file, the way it used to be done, against extracting it in process
+	int RunExtraction(const std::string& root) {
+		std::printf("\n%-10s %14s %14s %12s %16s %8s\n", "archive", "files (KiB)", "archive (KiB)", "unzip (ms)", "in process (ms)", "speedup");
+
+		for (bool deflate : { true, false }) {
+			Bench::ExtractionOptions options;
+			options.deflate = deflate;
+
+			Bench::ExtractionResult result = Bench::CompareExtraction(root + "/extraction", options);
+
+			if (!result.valid) {
+				std::fprintf(stderr, "Failed to compare extraction of a %s QMod (is zip/unzip installed?)\n", deflate ? "deflated" : "stored");
+				return 1;
+			}
+
+			std::printf("%-10s %14llu %14llu %12.3f %16.3f %7.1fx\n", deflate ? "deflated" : "stored",
+				(unsigned long long)(result.uncompressedSize / 1024), (unsigned long long)(result.archiveSize / 1024),
+				result.unzipMs, result.inProcessMs, result.unzipMs / result.inProcessMs);
+			std::fflush(stdout);
+		}
+
+		return 0;
+	}
+}
+
+int main(int argc, char** argv) {
+	std::string root = argc > 1 ? argv[1] : "/tmp/qmod-utils-bench";
+
+	std::vector<int> modCounts;
+	for (int i = 2; i < argc; i++) modCounts.push_back(std::atoi(argv[i]));
+	if (modCounts.empty()) modCounts = { 10, 100, 1000 };
+
+	if (std::getenv("QMODUTILS_BENCH_LOG")) Logger::enabled = true;
+	if (std::getenv("QMODUTILS_BENCH_TRACE")) QModUtils::Trace::SetEnabled(true);
+
+	if (const char* writeLimit = std::getenv("QMODUTILS_BENCH_WRITE_LIMIT")) {
+		QModUtils::Background::Policy policy = QModUtils::Background::GetPolicy();
+		policy.writeBytesPerSecond = std::strtoull(writeLimit, nullptr, 10);
+		QModUtils::Background::SetPolicy(policy);
+	}
+
+	std::printf("%6s  %-28s %12s %12s %12s %14s\n", "mods", "operation", "wall (ms)", "read calls", "write calls", "allocations");
+
+	int result = 0;
+
+	for (int modCount : modCounts) {
+		// QModUtils' state is global, so every tree gets a fresh process
+		pid_t pid = fork();
+
+		if (pid == 0) std::_Exit(Run(root + "/" + std::to_string(modCount), modCount));
+
+		int status = 0;
+		if (pid < 0 || waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+			std::fprintf(stderr, "The run with %d mods failed\n", modCount);
+			result = 1;
+		}
+	}
+
+	if (RunExtraction(root) != 0) result = 1;
+
+	return result;
+}
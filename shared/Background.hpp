@@ -0,0 +1,170 @@
+#pragma once
+
+#include "qmod-utils/shared/Operation.hpp"
+
+#include <sched.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+namespace QModUtils {
+	/**
+	 * @brief How hard mod operations are allowed to push the CPU and storage, so they don't take frames away from the game
+	 * @details Every thread QModUtils starts for an operation lowers its own scheduling and I/O priority when it starts.
+	 * Writes of extracted files go through a token bucket, and downloads are capped by curl, so neither can saturate the sdcard or the network while the game is rendering.
+	 * Combine this with Operation::Pause to stop installs completely while a song is being played
+	 */
+	namespace Background {
+		struct Policy {
+			int niceness = 10; // Added on top of the process's nice value, 0 leaves it alone
+			bool batchScheduling = true; // Run workers as SCHED_BATCH, so the scheduler treats them as CPU bound and is less eager to let them preempt the game's threads when they wake
+			bool idleIo = false; // Only touch storage when nothing else is. When false, workers get the lowest best effort I/O priority instead
+
+			uint64_t writeBytesPerSecond = 0; // 0 is unlimited
+			uint64_t downloadBytesPerSecond = 0; // Per transfer, 0 is unlimited
+		};
+
+		// Declerations
+
+		/**
+		 * @brief Replaces the policy. Threads that have already started keep the priority they had, the rate limits apply straight away
+		 */
+		inline void SetPolicy(const Policy& policy);
+		inline Policy GetPolicy();
+
+		/**
+		 * @brief Lowers the calling thread's CPU and I/O priority as the policy says. Failures are ignored, the thread just keeps its priority
+		 */
+		inline void ApplyToCurrentThread();
+
+		/**
+		 * @brief Waits until a write of this many bytes fits in the write rate limit, and while operations are paused
+		 * @details Never gives way to interactive operations, so it's safe to call with the install lock held
+		 *
+		 * @return Returns false if the current operation has been cancelled
+		 */
+		inline bool ThrottleWrite(uint64_t bytes);
+
+		/**
+		 * @brief How many bytes a writer should write at once, so a throttled write is spread out instead of being one long wait followed by a burst
+		 */
+		inline uint64_t WriteChunk(uint64_t remaining);
+
+		/**
+		 * @brief The download rate limit of the current policy, in bytes per second. 0 is unlimited
+		 */
+		inline uint64_t DownloadRate();
+
+		// Definitions
+
+		inline std::mutex m_PolicyLock;
+		inline Policy m_Policy;
+
+		inline std::atomic<uint64_t> m_WriteRate = 0;
+		inline std::atomic<uint64_t> m_DownloadRate = 0;
+
+		// Read while the library is loaded, before any worker has lowered its own. Workers started by workers would drift lower otherwise
+		inline const int m_BaseNiceness = getpriority(PRIO_PROCESS, 0);
+
+		constexpr uint64_t c_ThrottledChunkSize = 256 * 1024;
+
+		/**
+		 * @brief A token bucket holding up to a second's worth of bytes. Callers may overdraw it, and then sleep until it's back to empty
+		 */
+		class TokenBucket {
+		public:
+			void Acquire(uint64_t bytes, uint64_t rate) {
+				std::chrono::nanoseconds wait;
+
+				{
+					std::unique_lock lock(m_Lock);
+
+					auto now = std::chrono::steady_clock::now();
+					double elapsed = std::chrono::duration<double>(now - m_LastRefill).count();
+					m_LastRefill = now;
+
+					m_Tokens = std::min(m_Tokens + elapsed * rate, (double)rate);
+					m_Tokens -= bytes;
+
+					if (m_Tokens >= 0) return;
+
+					wait = std::chrono::nanoseconds((int64_t)(-m_Tokens / rate * 1e9));
+				}
+
+				std::this_thread::sleep_for(wait);
+			}
+
+		private:
+			std::mutex m_Lock;
+			double m_Tokens = 0;
+			std::chrono::steady_clock::time_point m_LastRefill = std::chrono::steady_clock::now();
+		};
+
+		inline TokenBucket m_WriteBucket;
+
+		void SetPolicy(const Policy& policy) {
+			std::unique_lock lock(m_PolicyLock);
+
+			m_Policy = policy;
+			m_WriteRate.store(policy.writeBytesPerSecond, std::memory_order_relaxed);
+			m_DownloadRate.store(policy.downloadBytesPerSecond, std::memory_order_relaxed);
+		}
+
+		Policy GetPolicy() {
+			std::unique_lock lock(m_PolicyLock);
+			return m_Policy;
+		}
+
+		void ApplyToCurrentThread() {
+			Policy policy = GetPolicy();
+
+			// On Linux, nice and the scheduling policy are per thread, even though the calls are named after processes
+			if (policy.niceness != 0) {
+				pid_t tid = (pid_t)syscall(SYS_gettid);
+				setpriority(PRIO_PROCESS, tid, std::clamp(m_BaseNiceness + policy.niceness, -20, 19));
+			}
+
+#ifdef SCHED_BATCH
+			if (policy.batchScheduling) {
+				sched_param param = {};
+				sched_setscheduler(0, SCHED_BATCH, &param);
+			}
+#endif
+
+#ifdef SYS_ioprio_set
+			// There's no libc wrapper. Class 3 is idle, class 2 is best effort, where 7 is the lowest priority
+			constexpr int c_IoprioWhoProcess = 1;
+			constexpr int c_IoprioClassShift = 13;
+
+			int ioprio = policy.idleIo ? (3 << c_IoprioClassShift) : ((2 << c_IoprioClassShift) | 7);
+			syscall(SYS_ioprio_set, c_IoprioWhoProcess, 0, ioprio);
+#endif
+		}
+
+		bool ThrottleWrite(uint64_t bytes) {
+			if (!Operation::WaitWhilePaused()) return false;
+
+			uint64_t rate = m_WriteRate.load(std::memory_order_relaxed);
+			if (rate != 0) m_WriteBucket.Acquire(bytes, rate);
+
+			return !Operation::IsCancelled();
+		}
+
+		uint64_t WriteChunk(uint64_t remaining) {
+			if (m_WriteRate.load(std::memory_order_relaxed) == 0) return remaining;
+
+			return std::min(remaining, c_ThrottledChunkSize);
+		}
+
+		uint64_t DownloadRate() {
+			return m_DownloadRate.load(std::memory_order_relaxed);
+		}
+	}
+}
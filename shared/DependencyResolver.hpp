@@ -0,0 +1,477 @@
+#pragma once
+
+#include "qmod-utils/shared/Types/QMod.hpp"
+#include "qmod-utils/shared/Semver.hpp"
+#include "qmod-utils/shared/WebUtils.hpp"
+#include "qmod-utils/shared/Trace.hpp"
+#include "qmod-utils/shared/Operation.hpp"
+
+#include "modloader/shared/modloader.hpp"
+#include "qmod-utils/shared/Log.hpp"
+
+#include <algorithm>
+#include <deque>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+Logger& getLogger();
+
+namespace QModUtils {
+	/**
+	 * @brief Works out every mod that needs to be downloaded and installed for a set of mods, before anything is touched
+	 * @details Constraints come from the version picked for every mod in the plan. Installed mods outside of it only add their constraints on a mod whose installed version the plan would change,
+	 * so installing one mod can't silently break another, without every installed mod having to be resolved again.
+	 * Versions are picked highest first, and a pick is gone back on whenever it leaves a later mod without a version that fits.
+	 * If no combination works, the plan is invalid and its error lists each constraint on the mod that couldn't be picked, and who it came from.
+	 */
+	namespace DependencyResolver {
+		struct Constraint {
+			std::string dependent; // The id of the mod that has this dependency
+			std::string dependentVersion; // And its version, as each version of a mod has its own dependencies
+			std::string range;
+			Semver::RangeId rangeId;
+			std::string downloadIfMissing;
+		};
+
+		enum class StepAction {
+			Download, // No local version fits, the mod has to be downloaded before the plan can be finished
+			Install,
+			Keep // Already installed, and fits every constraint
+		};
+
+		struct Step {
+			StepAction action;
+			std::string id;
+			QMod* mod = nullptr; // Null for downloads
+
+			std::string downloadUrl;
+			std::vector<Constraint> constraints; // Every constraint the chosen version has to satisfy
+		};
+
+		struct Plan {
+			bool valid = false;
+			std::string error;
+
+			// Downloads come first, then every mod comes after all of its dependencies
+			std::vector<Step> steps;
+
+			bool NeedsDownloads() const {
+				for (const Step& step : steps) {
+					if (step.action == StepAction::Download) return true;
+				}
+
+				return false;
+			}
+		};
+
+		// Declerations
+
+		/**
+		 * @brief Resolves the full dependency closure of a set of mods, without doing any I/O
+		 *
+		 * @param targets The mods to install
+		 * @param extraCandidates Mods to consider on top of the downloaded ones, like ones that have just been downloaded for a plan
+		 */
+		inline Plan Resolve(const std::vector<QMod*>& targets, const std::vector<QMod*>& extraCandidates = {});
+
+		/**
+		 * @brief Resolves and installs a set of mods along with their dependencies
+		 * @details If the plan needs downloads, they're all done first and the plan is resolved again with them as candidates.
+		 * Installs only start once there's a plan with nothing left to download, and are done in dependency order.
+		 *
+		 * @return Returns false if the mods couldn't be resolved, or a download / install failed
+		 */
+		inline bool ExecutePlan(const std::vector<QMod*>& targets, int maxDownloadRounds = 8);
+
+		// Definitions
+
+		inline std::vector<QMod*> GetCandidates(std::string_view id, const std::vector<QMod*>& extraCandidates) {
+			std::vector<QMod*> candidates = QMod::GetVersions(std::string(id));
+
+			for (QMod* candidate : extraCandidates) {
+				if (candidate->Id() == id && std::find(candidates.begin(), candidates.end(), candidate) == candidates.end()) candidates.push_back(candidate);
+			}
+
+			return candidates;
+		}
+
+		inline bool SatisfiesAll(QMod* mod, const std::vector<Constraint>& constraints) {
+			for (const Constraint& constraint : constraints) {
+				if (!Semver::Satisfies(mod->VersionId(), constraint.rangeId)) return false;
+			}
+
+			return true;
+		}
+
+		inline std::string DescribeConflict(std::string_view id, const std::vector<Constraint>& constraints, const std::vector<QMod*>& candidates) {
+			std::string error = string_format("No version of \"%s\" satisfies every dependency on it:", std::string(id).c_str());
+
+			for (const Constraint& constraint : constraints) {
+				error += string_format(" \"%s\" (from \"%s\" v%s),", constraint.range.c_str(), constraint.dependent.c_str(), constraint.dependentVersion.c_str());
+			}
+
+			error.pop_back();
+
+			if (candidates.empty()) {
+				error += ". There's no local version, and no dependency on it has a download link";
+			} else {
+				error += ". Local versions:";
+
+				for (QMod* candidate : candidates) error += string_format(" %s,", candidate->Version().data());
+				error.pop_back();
+			}
+
+			return error;
+		}
+
+		Plan Resolve(const std::vector<QMod*>& targets, const std::vector<QMod*>& extraCandidates) {
+			TRACE_SCOPE("DependencyResolver", "Resolve");
+
+			Plan plan;
+
+			std::unordered_map<std::string, QMod*> chosen; // Null if the mod has to be downloaded
+			std::unordered_map<std::string, std::vector<Constraint>> constraints; // Only ever from chosen versions, so un-picking a version takes its constraints with it
+			std::vector<std::string> order; // Every mod the plan needs, in the order they were found
+			std::unordered_set<std::string> known;
+
+			// An installed mod outside of the plan only has a say on a mod whose installed version the plan changes
+			std::unordered_map<std::string, QMod*> installed;
+			std::unordered_map<std::string, std::vector<std::pair<QMod*, const Dependency*>>> installedDependents;
+
+			for (QMod* qmod : QMod::DownloadedQMods()) {
+				if (!qmod->IsInstalled()) continue;
+
+				installed[std::string(qmod->Id())] = qmod;
+
+				for (const Dependency& dependency : qmod->Dependencies()) installedDependents[std::string(dependency.id)].emplace_back(qmod, &dependency);
+			}
+
+			auto MakeConstraint = [](QMod* dependent, const Dependency& dependency) -> Constraint {
+				return { std::string(dependent->Id()), std::string(dependent->Version()), std::string(dependency.version), dependency.versionRange, std::string(dependency.downloadIfMissing) };
+			};
+
+			auto OutsideConstraints = [&](const std::string& id) {
+				std::vector<Constraint> outside;
+
+				auto search = installedDependents.find(id);
+				if (search == installedDependents.end()) return outside;
+
+				for (auto& [dependent, dependency] : search->second) {
+					if (!chosen.contains(std::string(dependent->Id()))) outside.push_back(MakeConstraint(dependent, *dependency));
+				}
+
+				return outside;
+			};
+
+			// Returns false if the version's constraints rule out a version that's already chosen. Its constraints are added either way, so Unchoose can undo it
+			auto Choose = [&](const std::string& id, QMod* mod) {
+				chosen[id] = mod;
+				if (mod == nullptr) return true;
+
+				bool fits = true;
+
+				for (const Dependency& dependency : mod->Dependencies()) {
+					std::string dependencyId(dependency.id);
+					constraints[dependencyId].push_back(MakeConstraint(mod, dependency));
+
+					auto search = chosen.find(dependencyId);
+					if (search != chosen.end() && search->second != nullptr && !Semver::Satisfies(search->second->VersionId(), dependency.versionRange)) fits = false;
+
+					if (known.insert(dependencyId).second) order.push_back(std::move(dependencyId));
+				}
+
+				return fits;
+			};
+
+			auto Unchoose = [&](const std::string& id, QMod* mod, size_t orderSize) {
+				chosen.erase(id);
+				if (mod == nullptr) return;
+
+				// Choices are undone in the reverse order they were made, so this version's constraints are the last ones on each of its dependencies
+				for (const Dependency& dependency : mod->Dependencies()) constraints[std::string(dependency.id)].pop_back();
+
+				for (size_t i = orderSize; i < order.size(); i++) known.erase(order[i]);
+				order.resize(orderSize);
+			};
+
+			for (QMod* target : targets) {
+				std::string id(target->Id());
+				if (known.insert(id).second) order.push_back(id);
+			}
+
+			for (QMod* target : targets) Choose(std::string(target->Id()), target);
+
+			// The targets' versions can't change, so they have to fit each other as they are
+			for (QMod* target : targets) {
+				std::string id(target->Id());
+
+				if (!SatisfiesAll(target, constraints[id])) {
+					plan.error = DescribeConflict(id, constraints[id], { target });
+					return plan;
+				}
+			}
+
+			size_t attempts = 0;
+			size_t deepest = 0;
+			bool gaveUp = false;
+
+			auto Fail = [&](size_t depth, std::string error) {
+				if (depth < deepest) return;
+
+				deepest = depth;
+				plan.error = std::move(error);
+			};
+
+			// Once every mod is picked, the installed mods outside of the plan have to be fine with any installed version it changes
+			auto CheckOutside = [&](size_t depth) {
+				for (auto& [id, mod] : chosen) {
+					auto current = installed.find(id);
+					if (mod == nullptr || current == installed.end() || current->second == mod) continue;
+
+					std::vector<Constraint> outside = OutsideConstraints(id);
+					if (SatisfiesAll(mod, outside)) continue;
+
+					outside.insert(outside.begin(), constraints[id].begin(), constraints[id].end());
+					Fail(depth, DescribeConflict(id, outside, { mod }));
+
+					return false;
+				}
+
+				return true;
+			};
+
+			// Picks a version for each mod in the order they're found, going back to an earlier pick whenever a later mod can't be satisfied
+			std::function<bool(size_t, size_t)> Search = [&](size_t from, size_t depth) -> bool {
+				auto next = std::find_if(order.begin() + from, order.end(), [&](const std::string& id) { return !chosen.contains(id); });
+				if (next == order.end()) return CheckOutside(depth);
+
+				size_t index = next - order.begin();
+				std::string id = *next;
+
+				// Copied, as picks further down add to the constraints
+				std::vector<Constraint> idConstraints = constraints[id];
+				std::vector<QMod*> candidates = GetCandidates(id, extraCandidates);
+
+				auto current = installed.find(id);
+				QMod* installedVersion = current != installed.end() ? current->second : nullptr;
+				std::vector<Constraint> outside = installedVersion != nullptr ? OutsideConstraints(id) : std::vector<Constraint>();
+
+				// Keeping the installed version changes nothing, so it goes first. Then the highest versions, ones every installed mod outside of the plan is fine with first
+				std::vector<std::pair<int, QMod*>> ordered;
+				for (QMod* candidate : candidates) {
+					if (!candidate->Valid() || !SatisfiesAll(candidate, idConstraints)) continue;
+
+					ordered.emplace_back(candidate == installedVersion ? 0 : SatisfiesAll(candidate, outside) ? 1 : 2, candidate);
+				}
+
+				std::sort(ordered.begin(), ordered.end(), [](const std::pair<int, QMod*>& a, const std::pair<int, QMod*>& b) {
+					if (a.first != b.first) return a.first < b.first;
+					return Semver::Compare(a.second->VersionId(), b.second->VersionId()) > 0;
+				});
+
+				for (auto& [rank, candidate] : ordered) {
+					if (++attempts > 65536) {
+						gaveUp = true;
+						plan.error = string_format("Gave up resolving dependencies after trying %zu versions, last on \"%s\"", attempts - 1, id.c_str());
+						return false;
+					}
+
+					size_t orderSize = order.size();
+
+					if (!Choose(id, candidate)) {
+						// Report the version it rules out, with this candidate's constraint on it
+						for (const Dependency& dependency : candidate->Dependencies()) {
+							auto other = chosen.find(std::string(dependency.id));
+
+							if (other != chosen.end() && other->second != nullptr && !Semver::Satisfies(other->second->VersionId(), dependency.versionRange)) {
+								Fail(depth + 1, DescribeConflict(dependency.id, constraints[other->first], { other->second }));
+								break;
+							}
+						}
+					} else if (Search(index + 1, depth + 1)) {
+						return true;
+					}
+
+					Unchoose(id, candidate, orderSize);
+					if (gaveUp) return false;
+				}
+
+				// Nothing local works, so it has to be downloaded. Any download link will do, as the download is checked against every constraint
+				bool hasDownload = std::any_of(idConstraints.begin(), idConstraints.end(), [](const Constraint& constraint) { return constraint.downloadIfMissing != ""; });
+
+				if (hasDownload) {
+					Choose(id, nullptr);
+					if (Search(index + 1, depth + 1)) return true;
+
+					Unchoose(id, nullptr, order.size());
+					if (gaveUp) return false;
+				}
+
+				if (ordered.empty() && !hasDownload) Fail(depth, DescribeConflict(id, idConstraints, candidates));
+				return false;
+			};
+
+			if (!Search(0, 0)) {
+				if (plan.error.empty()) plan.error = "Failed to resolve dependencies";
+				return plan;
+			}
+
+			// Left over from picks that were gone back on
+			plan.error.clear();
+
+			// Order the plan so every mod comes after its dependencies. Downloads go first, as their dependencies aren't known yet
+			for (auto& pair : chosen) {
+				if (pair.second != nullptr) continue;
+
+				Step& step = plan.steps.emplace_back();
+				step.action = StepAction::Download;
+				step.id = pair.first;
+				step.constraints = constraints[pair.first];
+
+				// The download replaces an installed version, so the installed mods outside of the plan get a say in it too
+				if (installed.contains(pair.first)) {
+					std::vector<Constraint> outside = OutsideConstraints(pair.first);
+					step.constraints.insert(step.constraints.end(), outside.begin(), outside.end());
+				}
+
+				for (const Constraint& constraint : step.constraints) {
+					if (constraint.downloadIfMissing != "") {
+						step.downloadUrl = constraint.downloadIfMissing;
+						break;
+					}
+				}
+			}
+
+			enum class Mark { None, Visiting, Done };
+			std::unordered_map<std::string, Mark> marks;
+			std::vector<std::string> path;
+
+			std::function<bool(const std::string&)> Visit = [&](const std::string& id) -> bool {
+				Mark& mark = marks[id];
+				if (mark == Mark::Done) return true;
+
+				if (mark == Mark::Visiting) {
+					std::string cycle;
+					for (const std::string& mod : path) cycle += string_format("\"%s\" -> ", mod.c_str());
+
+					plan.error = string_format("Recursive dependency detected: %s\"%s\"", cycle.c_str(), id.c_str());
+					return false;
+				}
+
+				QMod* mod = chosen[id];
+				if (mod == nullptr) {
+					mark = Mark::Done;
+					return true;
+				}
+
+				mark = Mark::Visiting;
+				path.push_back(id);
+
+				for (const Dependency& dependency : mod->Dependencies()) {
+					if (!Visit(std::string(dependency.id))) return false;
+				}
+
+				path.pop_back();
+				marks[id] = Mark::Done;
+
+				Step& step = plan.steps.emplace_back();
+				step.action = mod->IsInstalled() ? StepAction::Keep : StepAction::Install;
+				step.id = id;
+				step.mod = mod;
+				step.constraints = constraints[id];
+
+				return true;
+			};
+
+			for (QMod* target : targets) {
+				if (!Visit(std::string(target->Id()))) return plan;
+			}
+
+			plan.valid = true;
+			return plan;
+		}
+
+		bool ExecutePlan(const std::vector<QMod*>& targets, int maxDownloadRounds) {
+			TRACE_SCOPE("DependencyResolver", "ExecutePlan");
+
+			std::vector<QMod*> downloaded;
+			Plan plan;
+
+			for (int round = 0; ; round++) {
+				plan = Resolve(targets, downloaded);
+
+				if (!plan.valid) {
+					QLOG_ERROR("Failed to resolve dependencies: %s", plan.error.c_str());
+					return false;
+				}
+
+				if (!plan.NeedsDownloads()) break;
+
+				if (round == maxDownloadRounds) {
+					QLOG_ERROR("Failed to resolve dependencies: Still missing dependencies after %i rounds of downloads", maxDownloadRounds);
+					return false;
+				}
+
+				for (const Step& step : plan.steps) {
+					if (step.action != StepAction::Download) continue;
+
+					if (!Operation::Checkpoint()) {
+						QLOG_INFO("Installing the plan was cancelled");
+						return false;
+					}
+
+					QLOG_INFO("Downloading dependency \"%s\" from \"%s\"", step.id.c_str(), step.downloadUrl.c_str());
+
+					std::string downloadFileLoc = string_format("%s%s", Paths::Downloads().c_str(), step.id.c_str());
+
+					if (!WebUtils::DownloadFile(step.downloadUrl, downloadFileLoc)) {
+						QLOG_ERROR("Failed to download dependency \"%s\"", step.id.c_str());
+						return false;
+					}
+
+					QMod* mod = new QMod(downloadFileLoc);
+
+					// Sanity checks that the download link actually pointed to the right mod. A wrong one is unregistered, so it can't stand in for another mod
+					if (!mod->Valid() || mod->Id() != step.id) {
+						QLOG_ERROR("Downloaded dependency had Id \"%s\", whereas the dependency stated ID \"%s\"", mod->Id().data(), step.id.c_str());
+
+						QMod::DiscardDownload(mod, downloadFileLoc);
+						return false;
+					}
+
+					if (!SatisfiesAll(mod, step.constraints)) {
+						QLOG_ERROR("%s", DescribeConflict(step.id, step.constraints, { mod }).c_str());
+
+						QMod::DiscardDownload(mod, downloadFileLoc);
+						return false;
+					}
+
+					downloaded.push_back(mod);
+				}
+			}
+
+			for (const Step& step : plan.steps) {
+				if (step.action != StepAction::Install) continue;
+
+				if (!Operation::Checkpoint()) {
+					QLOG_INFO("Installing the plan was cancelled");
+					return false;
+				}
+
+				std::vector<std::string> installedInBranch;
+				step.mod->Install(true, &installedInBranch, false);
+
+				if (!step.mod->IsInstalled()) {
+					QLOG_ERROR("Failed to install \"%s\", stopping the install of its dependents", step.id.c_str());
+					return false;
+				}
+			}
+
+			return true;
+		}
+	}
+}
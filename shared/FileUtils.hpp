@@ -0,0 +1,247 @@
+#pragma once
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/fs.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace QModUtils {
+	namespace FileUtils {
+		struct DirEntry {
+			std::string name;
+			uint64_t inode;
+			uint64_t size;
+			int64_t mtime; // Nanoseconds since the epoch
+		};
+
+		// The layout the kernel uses for getdents64, this isn't exposed by every libc
+		struct LinuxDirent64 {
+			uint64_t d_ino;
+			int64_t d_off;
+			unsigned short d_reclen;
+			unsigned char d_type;
+			char d_name[];
+		};
+
+		/**
+		 * @brief Closes a file descriptor when it goes out of scope
+		 */
+		struct ScopedFd {
+			int fd;
+
+			explicit ScopedFd(int fd) : fd(fd) {}
+			ScopedFd(const ScopedFd&) = delete;
+			ScopedFd& operator=(const ScopedFd&) = delete;
+			~ScopedFd() { if (fd >= 0) close(fd); }
+
+			operator int() const { return fd; }
+		};
+
+		inline bool EndsWith(std::string_view str, std::string_view suffix) {
+			return str.size() >= suffix.size() && str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+		}
+
+		/**
+		 * @brief Creates a directory and any missing parents, like "mkdir -p" but without spawning a shell
+		 *
+		 * @return Returns false if the directory doesn't exist afterwards
+		 */
+		inline bool MakeDirs(const std::string& path) {
+			for (size_t slash = path.find('/', 1); slash != std::string::npos; slash = path.find('/', slash + 1)) {
+				mkdir(path.substr(0, slash).c_str(), 0777);
+			}
+
+			return mkdir(path.c_str(), 0777) == 0 || errno == EEXIST;
+		}
+
+		/**
+		 * @brief FNV-1a 64 hash of a file's contents
+		 *
+		 * @return Returns 0 if the file couldn't be read
+		 */
+		inline uint64_t HashFile(const std::string& path) {
+			ScopedFd fd(open(path.c_str(), O_RDONLY | O_CLOEXEC));
+			if (fd < 0) return 0;
+
+			uint64_t hash = 14695981039346656037ull;
+			char buffer[64 * 1024];
+
+			while (true) {
+				ssize_t len = read(fd, buffer, sizeof(buffer));
+
+				if (len < 0 && errno == EINTR) continue;
+				if (len <= 0) break;
+
+				for (ssize_t i = 0; i < len; i++) {
+					hash ^= (uint8_t)buffer[i];
+					hash *= 1099511628211ull;
+				}
+			}
+
+			return hash;
+		}
+
+		/**
+		 * @brief Replaces a file's contents so that it's always either the old or the new contents, even if the game dies or the power goes mid-write
+		 * @details The data is written to a temp file next to it and synced, which is then renamed over the file. The directory is synced last so the rename itself is durable
+		 *
+		 * @return Returns false if any step failed, in which case the file is untouched
+		 */
+		inline bool WriteFileAtomic(const std::string& path, const char* data, size_t size) {
+			std::string tmpPath = path + ".tmp";
+
+			{
+				ScopedFd fd(open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666));
+				if (fd < 0) return false;
+
+				size_t total = 0;
+				while (total < size) {
+					ssize_t len = write(fd, data + total, size - total);
+
+					if (len < 0 && errno == EINTR) continue;
+					if (len <= 0) break;
+
+					total += len;
+				}
+
+				if (total != size || fdatasync(fd) != 0) {
+					unlink(tmpPath.c_str());
+					return false;
+				}
+			}
+
+			if (rename(tmpPath.c_str(), path.c_str()) != 0) {
+				unlink(tmpPath.c_str());
+				return false;
+			}
+
+			size_t slash = path.find_last_of('/');
+			ScopedFd dirFd(open(slash == std::string::npos ? "." : path.substr(0, slash + 1).c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC));
+
+			// Some filesystems (like the sdcard's FUSE layer) don't allow syncing a directory, the rename has still happened
+			if (dirFd >= 0) fsync(dirFd);
+
+			return true;
+		}
+
+		enum class PlaceMethod {
+			Hardlink,
+			Reflink,
+			Rename,	// The source is gone, it has to be moved back with ReturnFile
+			Failed
+		};
+
+		/**
+		 * @brief Makes a file from a store appear at a destination, as cheaply as the filesystem allows
+		 * @details Tries a hardlink, then a reflink (FICLONE), and finally moves the file. Any existing destination file is replaced
+		 */
+		inline PlaceMethod PlaceFile(const std::string& source, const std::string& destination) {
+			unlink(destination.c_str());
+
+			if (link(source.c_str(), destination.c_str()) == 0) return PlaceMethod::Hardlink;
+
+			{
+				ScopedFd sourceFd(open(source.c_str(), O_RDONLY | O_CLOEXEC));
+				if (sourceFd >= 0) {
+					ScopedFd destinationFd(open(destination.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666));
+
+					if (destinationFd >= 0 && ioctl(destinationFd, FICLONE, (int)sourceFd) == 0) return PlaceMethod::Reflink;
+				}
+
+				unlink(destination.c_str());
+			}
+
+			if (rename(source.c_str(), destination.c_str()) == 0) return PlaceMethod::Rename;
+
+			return PlaceMethod::Failed;
+		}
+
+		/**
+		 * @brief Undoes PlaceFile. Linked files are just unlinked, moved files are moved back into the store
+		 */
+		inline bool ReturnFile(const std::string& source, const std::string& destination) {
+			if (access(source.c_str(), F_OK) == 0) return unlink(destination.c_str()) == 0 || errno == ENOENT;
+
+			return rename(destination.c_str(), source.c_str()) == 0;
+		}
+
+		/**
+		 * @brief Fills in the inode, size and modification time of a file in an already opened directory
+		 *
+		 * @return Returns false if the file couldn't be stat'd or isn't a regular file
+		 */
+		inline bool StatAt(int dirFd, const char* name, DirEntry& entry) {
+		#if defined(__ANDROID_API__) && __ANDROID_API__ < 30
+			// statx is only available from Android 11 onwards
+			struct stat st;
+			if (fstatat(dirFd, name, &st, AT_SYMLINK_NOFOLLOW) != 0 || !S_ISREG(st.st_mode)) return false;
+
+			entry.inode = st.st_ino;
+			entry.size = st.st_size;
+			entry.mtime = (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+		#else
+			struct statx stx;
+			if (statx(dirFd, name, AT_SYMLINK_NOFOLLOW | AT_STATX_DONT_SYNC, STATX_TYPE | STATX_INO | STATX_SIZE | STATX_MTIME, &stx) != 0 || !S_ISREG(stx.stx_mode)) return false;
+
+			entry.inode = stx.stx_ino;
+			entry.size = stx.stx_size;
+			entry.mtime = (int64_t)stx.stx_mtime.tv_sec * 1000000000 + stx.stx_mtime.tv_nsec;
+		#endif
+
+			return true;
+		}
+
+		/**
+		 * @brief Lists the regular files in a directory, reading the entries in bulk with getdents64
+		 * @details Entries are filtered by extension before anything is allocated or stat'd, so unrelated files (like cover images) cost nothing
+		 *
+		 * @param dirPath The directory to scan
+		 * @param extension Only files ending in this are returned, leave empty to return every file
+		 * @return The matching files, in the order the kernel returned them
+		 */
+		inline std::vector<DirEntry> ScanDir(const std::string& dirPath, std::string_view extension = "") {
+			std::vector<DirEntry> entries;
+
+			ScopedFd dirFd(open(dirPath.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC));
+			if (dirFd < 0) return entries;
+
+			alignas(LinuxDirent64) char buffer[32 * 1024];
+
+			while (true) {
+				long len = syscall(SYS_getdents64, (int)dirFd, buffer, sizeof(buffer));
+				if (len <= 0) break;
+
+				for (long offset = 0; offset < len;) {
+					LinuxDirent64* dirent = (LinuxDirent64*)(buffer + offset);
+					offset += dirent->d_reclen;
+
+					// DT_UNKNOWN is returned by some filesystems, in which case StatAt is what rejects directories
+					if (dirent->d_type != DT_REG && dirent->d_type != DT_UNKNOWN) continue;
+
+					std::string_view name = dirent->d_name;
+					if (!EndsWith(name, extension)) continue;
+
+					DirEntry& entry = entries.emplace_back();
+					if (!StatAt(dirFd, dirent->d_name, entry)) {
+						entries.pop_back();
+						continue;
+					}
+
+					entry.name = name;
+				}
+			}
+
+			return entries;
+		}
+	}
+}
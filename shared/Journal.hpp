@@ -0,0 +1,335 @@
+#pragma once
+
+#include "qmod-utils/shared/FileUtils.hpp"
+#include "qmod-utils/shared/Paths.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace QModUtils {
+	/**
+	 * @brief An append only log of what each install and uninstall is about to do, so one that was cut short (the game being killed) can be finished or undone on the next start
+	 * @details A transaction writes its whole plan (every file it's going to place or remove) in a single write before touching anything, then a CONFIG record before changing config.json, then COMMIT.
+	 * Lines are tab separated, like "PLACE\t<tx>\t<linked>\t<source>\t<destination>". A transaction that never got its COMMIT (or ABORT) is incomplete, and is handed to whoever recovers at startup.
+	 * Recovery only reads the journal, so it takes time in proportion to its length, not to the number of mods. Once nothing is in flight the journal is emptied
+	 */
+	namespace Journal {
+		enum class Action : uint8_t {
+			Place,
+			Remove
+		};
+
+		struct Entry {
+			Action action;
+			bool linked;
+			std::string source; // Where a placed file comes from, or where a removed linked file goes back to. Can be empty
+			std::string destination;
+		};
+
+		/**
+		 * @brief A transaction from the journal that never finished
+		 */
+		struct Pending {
+			uint64_t id;
+			std::string operation;
+			std::string modId;
+			std::string version;
+
+			std::vector<Entry> plan;
+			std::string config; // The state config.json was about to be given, empty if it hadn't got that far
+		};
+
+		// Declerations
+
+		/**
+		 * @brief Reads every incomplete transaction from the journal, in the order they began
+		 * @details A transaction whose plan didn't make it into the journal in full is left out, as nothing was touched before its plan was written
+		 */
+		inline std::vector<Pending> ReadIncomplete();
+
+		/**
+		 * @brief Empties the journal. Only call this once every incomplete transaction has been dealt with
+		 *
+		 * @return Returns false if it couldn't be emptied, so the same transactions will be recovered again on the next start. Recovering one is safe to repeat
+		 */
+		inline bool Reset();
+
+		// Definitions
+
+		constexpr off_t c_CompactSize = 64 * 1024; // Once nothing is in flight, a journal bigger than this is emptied
+
+		inline std::mutex m_Lock;
+		inline int m_Fd = -1;
+		inline int m_OpenTransactions = 0;
+		inline int m_Batches = 0; // While above 0, commits are held back in m_DeferredCommits
+		inline std::string m_DeferredCommits;
+		inline bool m_Abandoned = false; // Set once held back commits were dropped. The journal isn't emptied again until Reset, so recovery can still find their transactions
+		inline uint64_t m_NextId = (uint64_t)std::chrono::system_clock::now().time_since_epoch().count();
+
+		inline bool Append(const std::string& records, bool sync) {
+			std::unique_lock lock(m_Lock);
+
+			if (m_Fd < 0) {
+				FileUtils::MakeDirs(Paths::BMBFData());
+				m_Fd = open(Paths::Journal().c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0666);
+				if (m_Fd < 0) return false;
+			}
+
+			const char* data = records.data();
+			size_t size = records.size();
+
+			while (size > 0) {
+				ssize_t len = write(m_Fd, data, size);
+
+				if (len < 0 && errno == EINTR) continue;
+				if (len <= 0) return false;
+
+				data += len;
+				size -= len;
+			}
+
+			return !sync || fdatasync(m_Fd) == 0;
+		}
+
+		/**
+		 * @brief Records one install or uninstall. Add its plan, then Begin, and Commit once everything is done
+		 * @details Going out of scope after Begin without a Commit writes ABORT, as the operation stopped on purpose and has already cleaned up after itself
+		 */
+		class Transaction {
+		public:
+			Transaction(const char* operation, std::string_view modId, std::string_view version) {
+				std::unique_lock lock(m_Lock);
+				m_Id = m_NextId++;
+
+				m_Begin = "BEGIN\t" + std::to_string(m_Id) + "\t" + operation + "\t" + std::string(modId) + "\t" + std::string(version) + "\t";
+			}
+
+			~Transaction() {
+				if (m_Begun && !m_Ended) End("ABORT");
+			}
+
+			Transaction(const Transaction&) = delete;
+			Transaction& operator=(const Transaction&) = delete;
+
+			void Place(bool linked, std::string_view source, std::string_view destination) { Add("PLACE", linked, source, destination); }
+			void Remove(bool linked, std::string_view source, std::string_view destination) { Add("REMOVE", linked, source, destination); }
+
+			/**
+			 * @brief Writes the plan out, and waits for it to reach storage. Nothing should be touched before this
+			 *
+			 * @return Returns false if the plan couldn't be written or synced, in which case the operation has to stop without touching anything. The transaction still ends in ABORT
+			 */
+			bool Begin() {
+				{
+					std::unique_lock lock(m_Lock);
+					m_OpenTransactions++;
+				}
+
+				// The BEGIN line ends in the number of entries, so a plan that was cut off can be told apart
+				bool written = Append(m_Begin + std::to_string(m_Count) + "\n" + m_Plan, true);
+				m_Plan.clear();
+				m_Begun = true;
+
+				return written;
+			}
+
+			/**
+			 * @brief Writes that config.json is about to give the mod a new state
+			 */
+			void Config(const char* state) {
+				Append("CONFIG\t" + std::to_string(m_Id) + "\t" + state + "\n", false);
+			}
+
+			void Commit() {
+				if (m_Begun && !m_Ended) End("COMMIT");
+			}
+
+		private:
+			uint64_t m_Id;
+			std::string m_Begin;
+			std::string m_Plan;
+			size_t m_Count = 0;
+
+			bool m_Begun = false;
+			bool m_Ended = false;
+
+			void Add(const char* action, bool linked, std::string_view source, std::string_view destination) {
+				m_Plan += std::string(action) + "\t" + std::to_string(m_Id) + "\t" + (linked ? "1" : "0") + "\t" + std::string(source) + "\t" + std::string(destination) + "\n";
+				m_Count++;
+			}
+
+			void End(const char* record) {
+				m_Ended = true;
+				std::string line = std::string(record) + "\t" + std::to_string(m_Id) + "\n";
+
+				{
+					std::unique_lock lock(m_Lock);
+
+					if (m_Batches > 0 && std::string_view(record) == "COMMIT") {
+						m_DeferredCommits += line;
+						return;
+					}
+				}
+
+				Append(line, false);
+				Closed(1);
+			}
+
+			friend class Batch;
+
+			static void Closed(int count) {
+				std::unique_lock lock(m_Lock);
+
+				m_OpenTransactions -= count;
+
+				struct stat st;
+				// Failing to empty it only means it's tried again once the next transaction closes
+				if (m_OpenTransactions == 0 && !m_Abandoned && m_Fd >= 0 && fstat(m_Fd, &st) == 0 && st.st_size > c_CompactSize)
+					(void)ftruncate(m_Fd, 0);
+			}
+		};
+
+		/**
+		 * @brief Holds back the COMMIT of every transaction that finishes while it's in scope, and writes them all at once when it goes out of scope
+		 * @details For operations made of many transactions that share a single config.json write. Until that write has happened, recovery still sees each one as unfinished, and finishes it
+		 */
+		class Batch {
+		public:
+			Batch() {
+				std::unique_lock lock(m_Lock);
+				m_Batches++;
+			}
+
+			~Batch() {
+				std::string commits;
+
+				{
+					std::unique_lock lock(m_Lock);
+					if (--m_Batches > 0) return;
+
+					commits.swap(m_DeferredCommits);
+				}
+
+				if (commits.empty()) return;
+
+				Append(commits, false);
+				Transaction::Closed((int)std::count(commits.begin(), commits.end(), '\n'));
+			}
+
+			/**
+			 * @brief Drops every commit held back so far, for when the write they were waiting on failed
+			 * @details Their transactions stay unfinished in the journal, so recovery finishes them on the next start
+			 */
+			void Abandon() {
+				int count;
+
+				{
+					std::unique_lock lock(m_Lock);
+
+					count = (int)std::count(m_DeferredCommits.begin(), m_DeferredCommits.end(), '\n');
+					m_DeferredCommits.clear();
+					m_Abandoned = true;
+				}
+
+				Transaction::Closed(count);
+			}
+
+			Batch(const Batch&) = delete;
+			Batch& operator=(const Batch&) = delete;
+		};
+
+		inline std::vector<std::string_view> SplitFields(std::string_view line) {
+			std::vector<std::string_view> fields;
+
+			while (true) {
+				size_t tab = line.find('\t');
+				fields.push_back(line.substr(0, tab));
+
+				if (tab == std::string_view::npos) return fields;
+				line.remove_prefix(tab + 1);
+			}
+		}
+
+		std::vector<Pending> ReadIncomplete() {
+			std::string contents;
+
+			{
+				FileUtils::ScopedFd fd(open(Paths::Journal().c_str(), O_RDONLY | O_CLOEXEC));
+				if (fd < 0) return {};
+
+				char buffer[64 * 1024];
+				ssize_t len;
+
+				while ((len = read(fd, buffer, sizeof(buffer))) > 0 || (len < 0 && errno == EINTR)) {
+					if (len > 0) contents.append(buffer, len);
+				}
+			}
+
+			std::vector<Pending> pending;
+			std::unordered_map<uint64_t, size_t> indices; // Transaction id to its index in pending
+			std::unordered_map<uint64_t, size_t> expected; // How many entries each plan should have
+
+			std::string_view view = contents;
+
+			// A line without a newline was being written when the game died, so it's ignored
+			for (size_t newline = view.find('\n'); newline != std::string_view::npos; newline = view.find('\n')) {
+				std::vector<std::string_view> fields = SplitFields(view.substr(0, newline));
+				view.remove_prefix(newline + 1);
+
+				if (fields.size() < 2) continue;
+
+				uint64_t id = std::strtoull(std::string(fields[1]).c_str(), nullptr, 10);
+				std::string_view record = fields[0];
+
+				if (record == "BEGIN" && fields.size() == 6) {
+					indices[id] = pending.size();
+					expected[id] = std::strtoull(std::string(fields[5]).c_str(), nullptr, 10);
+					pending.push_back({ id, std::string(fields[2]), std::string(fields[3]), std::string(fields[4]), {}, "" });
+					continue;
+				}
+
+				auto index = indices.find(id);
+				if (index == indices.end()) continue;
+
+				Pending& transaction = pending[index->second];
+
+				if ((record == "PLACE" || record == "REMOVE") && fields.size() == 5) {
+					transaction.plan.push_back({ record == "PLACE" ? Action::Place : Action::Remove, fields[2] == "1", std::string(fields[3]), std::string(fields[4]) });
+				} else if (record == "CONFIG" && fields.size() == 3) {
+					transaction.config = std::string(fields[2]);
+				} else if (record == "COMMIT" || record == "ABORT") {
+					transaction.id = 0;
+					indices.erase(index);
+				}
+			}
+
+			// Finished transactions were marked with an id of 0, and plans that were cut off never did anything
+			pending.erase(std::remove_if(pending.begin(), pending.end(), [&](const Pending& transaction) {
+				return transaction.id == 0 || transaction.plan.size() != expected[transaction.id];
+			}), pending.end());
+
+			return pending;
+		}
+
+		bool Reset() {
+			std::unique_lock lock(m_Lock);
+			m_Abandoned = false;
+
+			if (m_Fd >= 0) return ftruncate(m_Fd, 0) == 0;
+
+			return truncate(Paths::Journal().c_str(), 0) == 0 || errno == ENOENT;
+		}
+	}
+}
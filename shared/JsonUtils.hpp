@@ -0,0 +1,309 @@
+#pragma once
+
+#include "qmod-utils/shared/Types/CoreModInfo.hpp"
+
+#include "beatsaber-hook/shared/rapidjson/include/rapidjson/document.h"
+#include "beatsaber-hook/shared/rapidjson/include/rapidjson/reader.h"
+#include "beatsaber-hook/shared/rapidjson/include/rapidjson/error/error.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace QModUtils {
+	namespace JsonUtils {
+		/**
+		 * @brief Reads a whole file into a buffer, and null terminates it so it can be parsed in-situ
+		 * @details The buffer's capacity is kept between calls, so reusing the same buffer avoids reallocating for every file
+		 *
+		 * @param path The file to read
+		 * @param buffer The buffer to read into. Anything already in it is overwritten
+		 * @return Returns false if the file couldn't be read
+		 */
+		inline bool ReadFile(const std::string& path, std::vector<char>& buffer) {
+			int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+			if (fd < 0) return false;
+
+			struct stat st;
+			if (fstat(fd, &st) != 0) {
+				close(fd);
+				return false;
+			}
+
+			buffer.resize(st.st_size + 1);
+
+			size_t total = 0;
+			while (total < (size_t)st.st_size) {
+				ssize_t len = read(fd, buffer.data() + total, st.st_size - total);
+
+				if (len < 0 && errno == EINTR) continue;
+				if (len <= 0) break;
+
+				total += len;
+			}
+
+			close(fd);
+
+			buffer.resize(total + 1);
+			buffer[total] = '\0';
+
+			return true;
+		}
+
+		/**
+		 * @brief Reads a file and parses it in-situ into a DOM
+		 * @details The document's strings point into the buffer, so the buffer must outlive the document and must not be reused while it's in use
+		 *
+		 * @return Returns false if the file couldn't be read or parsed
+		 */
+		inline bool ParseFileInsitu(const std::string& path, rapidjson::Document& document, std::vector<char>& buffer) {
+			if (!ReadFile(path, buffer)) return false;
+
+			return !document.ParseInsitu(buffer.data()).HasParseError();
+		}
+
+		// The parts of a BMBF "config.json" mod entry that QModUtils reads
+		struct BMBFModData {
+			bool installed = false;
+			bool uninstallable = true;
+			std::string coverImageFilename;
+		};
+
+		/**
+		 * @brief SAX handler that finds a single mod's entry in BMBF's "config.json", and stops parsing as soon as it has been found
+		 * @details Only the fields we need from the matching entry are ever copied out of the buffer
+		 */
+		struct BMBFModDataHandler : public rapidjson::BaseReaderHandler<rapidjson::UTF8<>, BMBFModDataHandler> {
+			std::string_view targetId;
+			std::optional<BMBFModData> result;
+
+			bool foundModsArray = false;
+
+			// Depth 1 is the root object, 2 is the "Mods" array, 3 is a mod entry
+			int depth = 0;
+			bool inModsArray = false;
+			bool nextIsModsArray = false;
+			std::string_view currentKey;
+
+			// Values of the entry currently being parsed, as "Id" doesn't have to be the first member
+			std::string_view id;
+			std::string_view coverImageFilename;
+			bool installed = false;
+			bool uninstallable = true;
+
+			BMBFModDataHandler(std::string_view targetId) : targetId(targetId) {}
+
+			bool Default() { return true; }
+
+			bool Bool(bool b) {
+				if (inModsArray && depth == 3) {
+					if (currentKey == "Installed") installed = b;
+					else if (currentKey == "Uninstallable") uninstallable = b;
+				}
+
+				return true;
+			}
+
+			bool String(const char* str, rapidjson::SizeType length, bool) {
+				if (inModsArray && depth == 3) {
+					if (currentKey == "Id") id = std::string_view(str, length);
+					else if (currentKey == "CoverImageFilename") coverImageFilename = std::string_view(str, length);
+				}
+
+				return true;
+			}
+
+			bool Key(const char* str, rapidjson::SizeType length, bool) {
+				currentKey = std::string_view(str, length);
+				nextIsModsArray = depth == 1 && currentKey == "Mods";
+
+				return true;
+			}
+
+			bool StartObject() {
+				depth++;
+
+				if (inModsArray && depth == 3) {
+					id = coverImageFilename = std::string_view();
+					installed = false;
+					uninstallable = true;
+				}
+
+				nextIsModsArray = false;
+				return true;
+			}
+
+			bool EndObject(rapidjson::SizeType) {
+				if (inModsArray && depth == 3 && id == targetId) {
+					result = BMBFModData{ installed, uninstallable, std::string(coverImageFilename) };
+
+					// Stops the parse, we have everything we came for
+					return false;
+				}
+
+				depth--;
+				return true;
+			}
+
+			bool StartArray() {
+				depth++;
+
+				if (nextIsModsArray && depth == 2) inModsArray = foundModsArray = true;
+
+				nextIsModsArray = false;
+				return true;
+			}
+
+			bool EndArray(rapidjson::SizeType) {
+				if (inModsArray && depth == 2) inModsArray = false;
+
+				depth--;
+				return true;
+			}
+		};
+
+		enum class FindResult {
+			Found,
+			NotFound,
+			Invalid // The file couldn't be read, parsed, or has no "Mods" array
+		};
+
+		/**
+		 * @brief Finds a mod's entry in BMBF's "config.json" without building a DOM
+		 *
+		 * @param path The path to the "config.json"
+		 * @param id The id of the mod to find
+		 * @param buffer A reusable buffer to read the file into
+		 * @param data Filled in with the entry's data if it was found
+		 */
+		inline FindResult FindBMBFModDataInsitu(std::vector<char>& buffer, std::string_view id, BMBFModData& data);
+
+		inline FindResult FindBMBFModData(const std::string& path, std::string_view id, std::vector<char>& buffer, BMBFModData& data) {
+			if (!ReadFile(path, buffer)) return FindResult::Invalid;
+
+			return FindBMBFModDataInsitu(buffer, id, data);
+		}
+
+		/**
+		 * @brief Same as FindBMBFModData, but for a "config.json" that has already been read into a null terminated buffer. The buffer is modified by the parse
+		 */
+		inline FindResult FindBMBFModDataInsitu(std::vector<char>& buffer, std::string_view id, BMBFModData& data) {
+			BMBFModDataHandler handler(id);
+			rapidjson::Reader reader;
+			rapidjson::InsituStringStream stream(buffer.data());
+
+			reader.Parse<rapidjson::kParseInsituFlag>(stream, handler);
+
+			if (handler.result.has_value()) {
+				data = std::move(handler.result.value());
+				return FindResult::Found;
+			}
+
+			if (reader.HasParseError() || !handler.foundModsArray) return FindResult::Invalid;
+			return FindResult::NotFound;
+		}
+
+		/**
+		 * @brief SAX handler that reads the core mods for a single game version out of "core-mods.json", and stops once that version has been read
+		 */
+		struct CoreModsHandler : public rapidjson::BaseReaderHandler<rapidjson::UTF8<>, CoreModsHandler> {
+			std::string_view gameVersion;
+			std::vector<CoreModInfo>& coreMods;
+
+			bool foundVersion = false;
+			bool foundModsList = false;
+
+			// Depth 1 is the root object, 2 is our version's object, 3 is the "mods" array, 4 is a core mod
+			int depth = 0;
+			bool inVersion = false;
+			bool inModsList = false;
+			bool nextIsVersion = false;
+			bool nextIsModsList = false;
+
+			// Copied, as without in-situ parsing the reader reuses the key's bytes for the value that follows it
+			std::string currentKey;
+
+			CoreModsHandler(std::string_view gameVersion, std::vector<CoreModInfo>& coreMods) : gameVersion(gameVersion), coreMods(coreMods) {}
+
+			bool Default() { return true; }
+
+			bool String(const char* str, rapidjson::SizeType length, bool) {
+				if (inModsList && depth == 4) coreMods.back().SetField(currentKey, std::string_view(str, length));
+
+				return true;
+			}
+
+			bool Key(const char* str, rapidjson::SizeType length, bool) {
+				currentKey.assign(str, length);
+
+				nextIsVersion = depth == 1 && currentKey == gameVersion;
+				nextIsModsList = inVersion && depth == 2 && currentKey == "mods";
+
+				return true;
+			}
+
+			bool StartObject() {
+				depth++;
+
+				if (nextIsVersion && depth == 2) inVersion = foundVersion = true;
+				if (inModsList && depth == 4) coreMods.emplace_back();
+
+				nextIsVersion = nextIsModsList = false;
+				return true;
+			}
+
+			bool EndObject(rapidjson::SizeType) {
+				// Once our version has been read there's no need to look at the rest of the file
+				if (inVersion && depth == 2) return false;
+
+				depth--;
+				return true;
+			}
+
+			bool StartArray() {
+				depth++;
+
+				if (nextIsModsList && depth == 3) inModsList = foundModsList = true;
+
+				nextIsVersion = nextIsModsList = false;
+				return true;
+			}
+
+			bool EndArray(rapidjson::SizeType) {
+				if (inModsList && depth == 3) inModsList = false;
+
+				depth--;
+				return true;
+			}
+		};
+
+		/**
+		 * @brief Reads the core mods for a game version out of "core-mods.json" without building a DOM
+		 *
+		 * @param json The contents of "core-mods.json"
+		 * @param gameVersion The game version to get the core mods of
+		 * @param coreMods Filled with the core mods for the game version
+		 * @return Returns Invalid if the json couldn't be parsed, and NotFound if it has no core mods list for the game version
+		 */
+		inline FindResult ReadCoreMods(const char* json, std::string_view gameVersion, std::vector<CoreModInfo>& coreMods) {
+			coreMods.clear();
+
+			CoreModsHandler handler(gameVersion, coreMods);
+			rapidjson::Reader reader;
+			rapidjson::StringStream stream(json);
+
+			reader.Parse(stream, handler);
+
+			// The handler stopping the parse is how it says it's done, so only other errors count
+			if (reader.HasParseError() && reader.GetParseErrorCode() != rapidjson::kParseErrorTermination) return FindResult::Invalid;
+			if (!handler.foundVersion || !handler.foundModsList) return FindResult::NotFound;
+
+			return FindResult::Found;
+		}
+	}
+}
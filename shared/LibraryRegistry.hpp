@@ -0,0 +1,213 @@
+#pragma once
+
+#include "qmod-utils/shared/ZipUtils.hpp"
+#include "qmod-utils/shared/Paths.hpp"
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace QModUtils {
+	/**
+	 * @brief Which installed mods use each file in the libs folder, and what's in it
+	 * @details Libraries all go to the same folder, so mods that bundle the same library share a single file. Each library keeps a refcount (the mods holding it),
+	 * and the size and CRC-32 of the file in place. A mod whose copy has the same size and CRC-32 (from its .qmod's central directory) just takes a reference,
+	 * without extracting or writing anything. A copy with different content is a conflict: it's still put in place, as before, but it's recorded so it can be shown.
+	 * The CRC-32 of a file on disk is only worked out once, and kept for as long as the file's inode, size and modification time stay the same
+	 */
+	namespace LibraryRegistry {
+		enum class Claim : uint8_t {
+			Place, // Nobody else holds it, put it in place as usual
+			Shared, // Already in place with the same content
+			Conflict // Held by another mod, with different content
+		};
+
+		struct Conflict {
+			std::string library;
+			std::string heldBy; // The mod whose copy was in place
+			std::string wantedBy; // The mod that put its own copy in place over it
+		};
+
+		// Declerations
+
+		/**
+		 * @brief Adds a reference from a mod to a library it's about to install
+		 *
+		 * @param entry The library in the mod's .qmod, or null if it couldn't be read, in which case it's never treated as shared
+		 */
+		inline Claim Acquire(std::string_view library, std::string_view owner, const ZipUtils::ZipEntry* entry);
+
+		/**
+		 * @brief Records what was just put in place, so it doesn't have to be read back to be compared
+		 */
+		inline void Placed(std::string_view library, const ZipUtils::ZipEntry& entry);
+
+		/**
+		 * @brief Drops a mod's reference to a library
+		 *
+		 * @return Returns true if no other mod holds it, and the file should be removed
+		 */
+		inline bool Release(std::string_view library, std::string_view owner);
+
+		inline bool IsHeldElsewhere(std::string_view library, std::string_view owner);
+
+		/**
+		 * @brief Returns true if another mod holds the library, and the file in place has the same content as the entry, so the entry doesn't need extracting
+		 */
+		inline bool IsSharedWith(std::string_view library, std::string_view owner, const ZipUtils::ZipEntry& entry);
+
+		/**
+		 * @brief Replaces every reference, like after a rescan. What's known about the content of each file is kept
+		 *
+		 * @param owners Each installed mod's id, and the libraries it ships
+		 */
+		inline void Rebuild(const std::vector<std::pair<std::string_view, std::vector<std::string_view>>>& owners);
+
+		inline std::vector<Conflict> GetConflicts();
+
+		// Definitions
+
+		struct Record {
+			std::vector<std::string> owners;
+
+			// The file in place when the CRC-32 was worked out, the CRC is stale once any of these change
+			bool known = false;
+			uint64_t inode = 0;
+			uint64_t size = 0;
+			int64_t mtime = 0;
+			uint32_t crc32 = 0;
+		};
+
+		inline std::mutex m_Lock;
+		inline std::unordered_map<std::string, Record> m_Records;
+		inline std::vector<Conflict> m_Conflicts;
+
+		inline bool StatLibrary(std::string_view library, struct stat& st) {
+			// Follows links, as it's the content that matters
+			return stat((Paths::GameLibs() + std::string(library)).c_str(), &st) == 0 && S_ISREG(st.st_mode);
+		}
+
+		inline int64_t MTime(const struct stat& st) {
+			return (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+		}
+
+		/**
+		 * @brief Checks the file in place against an entry. Call with m_Lock held
+		 */
+		inline bool Matches(std::string_view library, Record& record, const ZipUtils::ZipEntry& entry) {
+			struct stat st;
+			if (!StatLibrary(library, st) || (uint64_t)st.st_size != entry.uncompressedSize) return false;
+
+			bool unchanged = record.known && record.inode == (uint64_t)st.st_ino && record.size == (uint64_t)st.st_size && record.mtime == MTime(st);
+
+			if (!unchanged) {
+				record.known = ZipUtils::FileCrc32(Paths::GameLibs() + std::string(library), record.crc32);
+				record.inode = st.st_ino;
+				record.size = st.st_size;
+				record.mtime = MTime(st);
+			}
+
+			return record.known && record.crc32 == entry.crc32;
+		}
+
+		inline bool HasOtherOwner(const Record& record, std::string_view owner) {
+			return std::any_of(record.owners.begin(), record.owners.end(), [&](const std::string& other) { return other != owner; });
+		}
+
+		Claim Acquire(std::string_view library, std::string_view owner, const ZipUtils::ZipEntry* entry) {
+			std::unique_lock lock(m_Lock);
+			Record& record = m_Records[std::string(library)];
+
+			auto other = std::find_if(record.owners.begin(), record.owners.end(), [&](const std::string& holder) { return holder != owner; });
+			std::string heldBy = other != record.owners.end() ? *other : "";
+
+			if (std::find(record.owners.begin(), record.owners.end(), owner) == record.owners.end()) record.owners.emplace_back(owner);
+
+			if (heldBy.empty() || entry == nullptr) return Claim::Place;
+			if (Matches(library, record, *entry)) return Claim::Shared;
+
+			bool known = std::any_of(m_Conflicts.begin(), m_Conflicts.end(), [&](const Conflict& conflict) { return conflict.library == library && conflict.wantedBy == owner; });
+			if (!known) m_Conflicts.push_back({ std::string(library), heldBy, std::string(owner) });
+
+			return Claim::Conflict;
+		}
+
+		void Placed(std::string_view library, const ZipUtils::ZipEntry& entry) {
+			std::unique_lock lock(m_Lock);
+			Record& record = m_Records[std::string(library)];
+
+			struct stat st;
+			record.known = StatLibrary(library, st) && (uint64_t)st.st_size == entry.uncompressedSize;
+			if (!record.known) return;
+
+			record.inode = st.st_ino;
+			record.size = st.st_size;
+			record.mtime = MTime(st);
+			record.crc32 = entry.crc32;
+		}
+
+		bool Release(std::string_view library, std::string_view owner) {
+			std::unique_lock lock(m_Lock);
+
+			std::erase_if(m_Conflicts, [&](const Conflict& conflict) { return conflict.library == library && (conflict.heldBy == owner || conflict.wantedBy == owner); });
+
+			auto record = m_Records.find(std::string(library));
+			if (record == m_Records.end()) return true;
+
+			std::erase(record->second.owners, owner);
+			if (!record->second.owners.empty()) return false;
+
+			m_Records.erase(record);
+			return true;
+		}
+
+		bool IsHeldElsewhere(std::string_view library, std::string_view owner) {
+			std::unique_lock lock(m_Lock);
+
+			auto record = m_Records.find(std::string(library));
+			return record != m_Records.end() && HasOtherOwner(record->second, owner);
+		}
+
+		bool IsSharedWith(std::string_view library, std::string_view owner, const ZipUtils::ZipEntry& entry) {
+			std::unique_lock lock(m_Lock);
+
+			auto record = m_Records.find(std::string(library));
+			return record != m_Records.end() && HasOtherOwner(record->second, owner) && Matches(library, record->second, entry);
+		}
+
+		void Rebuild(const std::vector<std::pair<std::string_view, std::vector<std::string_view>>>& owners) {
+			std::unique_lock lock(m_Lock);
+
+			for (auto& [library, record] : m_Records) record.owners.clear();
+
+			for (auto& [owner, libraries] : owners) {
+				for (std::string_view library : libraries) {
+					std::vector<std::string>& holders = m_Records[std::string(library)].owners;
+					if (std::find(holders.begin(), holders.end(), owner) == holders.end()) holders.emplace_back(owner);
+				}
+			}
+
+			std::erase_if(m_Records, [](const auto& pair) { return pair.second.owners.empty(); });
+
+			// A conflict only stands while both mods still hold the library
+			std::erase_if(m_Conflicts, [](const Conflict& conflict) {
+				auto record = m_Records.find(conflict.library);
+				if (record == m_Records.end()) return true;
+
+				const std::vector<std::string>& holders = record->second.owners;
+				return std::find(holders.begin(), holders.end(), conflict.heldBy) == holders.end() || std::find(holders.begin(), holders.end(), conflict.wantedBy) == holders.end();
+			});
+		}
+
+		std::vector<Conflict> GetConflicts() {
+			std::unique_lock lock(m_Lock);
+			return m_Conflicts;
+		}
+	}
+}
@@ -0,0 +1,141 @@
+#pragma once
+
+#include "modloader/shared/modloader.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+Logger& getLogger();
+
+/**
+ * @brief The lowest level that's compiled in. 0 is debug, 1 info, 2 warning, 3 error and 4 critical
+ * @details Anything below it compiles to nothing, arguments included
+ */
+#ifndef QMODUTILS_MIN_LOG_LEVEL
+#define QMODUTILS_MIN_LOG_LEVEL 0
+#endif
+
+// The arguments are only evaluated if the level is compiled in and enabled at runtime, so building strings for a log line costs nothing when it's filtered out
+#define QLOG_AT(level, method, ...)                                                                  \
+	do {                                                                                             \
+		if constexpr (QModUtils::Log::IsCompiledIn(level)) {                                         \
+			if (QModUtils::Log::IsEnabled(level)) getLogger().method(__VA_ARGS__);                   \
+		}                                                                                            \
+	} while (0)
+
+#define QLOG_DEBUG(...) QLOG_AT(QModUtils::Log::Level::Debug, debug, __VA_ARGS__)
+#define QLOG_INFO(...) QLOG_AT(QModUtils::Log::Level::Info, info, __VA_ARGS__)
+#define QLOG_WARNING(...) QLOG_AT(QModUtils::Log::Level::Warning, warning, __VA_ARGS__)
+#define QLOG_ERROR(...) QLOG_AT(QModUtils::Log::Level::Error, error, __VA_ARGS__)
+#define QLOG_CRITICAL(...) QLOG_AT(QModUtils::Log::Level::Critical, critical, __VA_ARGS__)
+
+// A line per file / dependency inside of an operation. In summary mode it's only counted, and the operation logs a single line at the end instead
+#define QLOG_DETAIL(...)                                                                             \
+	do {                                                                                             \
+		if (!QModUtils::Log::FoldDetail()) QLOG_INFO(__VA_ARGS__);                                   \
+	} while (0)
+
+namespace QModUtils {
+	namespace Log {
+		enum class Level : uint8_t {
+			Debug,
+			Info,
+			Warning,
+			Error,
+			Critical
+		};
+
+		// Compared through a constant rather than the macro, as a level of 0 would make every comparison trivially true and warn
+		constexpr int c_MinLogLevel = QMODUTILS_MIN_LOG_LEVEL;
+
+		/**
+		 * @brief Returns true if a level is at or above QMODUTILS_MIN_LOG_LEVEL, so its log lines are compiled in
+		 */
+		constexpr bool IsCompiledIn(Level level) {
+			return (int)level >= c_MinLogLevel;
+		}
+
+		inline std::atomic<Level> m_Level = Level::Debug;
+		inline std::atomic<bool> m_SummaryMode = false;
+
+		/**
+		 * @brief Sets the lowest level that's logged at runtime. Levels below QMODUTILS_MIN_LOG_LEVEL are never logged, whatever this is set to
+		 */
+		inline void SetLevel(Level level) {
+			m_Level.store(level, std::memory_order_relaxed);
+		}
+
+		inline bool IsEnabled(Level level) {
+			return level >= m_Level.load(std::memory_order_relaxed);
+		}
+
+		/**
+		 * @brief When on, the per file lines of an operation are folded into one line per mod
+		 */
+		inline void SetSummaryMode(bool summaryMode) {
+			m_SummaryMode.store(summaryMode, std::memory_order_relaxed);
+		}
+
+		class OperationSummary;
+
+		inline OperationSummary*& CurrentSummary() {
+			thread_local OperationSummary* summary = nullptr;
+			return summary;
+		}
+
+		/**
+		 * @brief Covers a single operation on a mod (like an install). In summary mode, its detail lines are counted instead of logged, and it logs one line when it ends
+		 */
+		class OperationSummary {
+		public:
+			OperationSummary(const char* operation, std::string_view id) : m_Operation(operation), m_Id(id), m_Start(std::chrono::steady_clock::now()) {
+				m_Parent = CurrentSummary();
+				CurrentSummary() = this;
+			}
+
+			~OperationSummary() {
+				CurrentSummary() = m_Parent;
+
+				// A nested operation (like the config update at the end of an install) is part of its parent's line
+				if (m_Parent != nullptr) {
+					m_Parent->m_Details += m_Details;
+					return;
+				}
+
+				if (!m_SummaryMode.load(std::memory_order_relaxed)) return;
+
+				double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_Start).count();
+				QLOG_INFO("%s \"%s\" took %.1fms (%i details folded)", m_Operation, m_Id.c_str(), ms, m_Details);
+			}
+
+			OperationSummary(const OperationSummary&) = delete;
+			OperationSummary& operator=(const OperationSummary&) = delete;
+
+			void CountDetail() { m_Details++; }
+
+		private:
+			const char* m_Operation;
+			std::string m_Id;
+			std::chrono::steady_clock::time_point m_Start;
+			int m_Details = 0;
+
+			OperationSummary* m_Parent;
+		};
+
+		/**
+		 * @brief Counts a detail line against the current operation if there's one and summary mode is on
+		 *
+		 * @return Returns true if the line was folded, and shouldn't be logged
+		 */
+		inline bool FoldDetail() {
+			OperationSummary* summary = CurrentSummary();
+			if (summary == nullptr || !m_SummaryMode.load(std::memory_order_relaxed)) return false;
+
+			summary->CountDetail();
+			return true;
+		}
+	}
+}
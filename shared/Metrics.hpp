@@ -0,0 +1,332 @@
+#pragma once
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace QModUtils {
+	/**
+	 * @brief Counters and latency histograms for everything QModUtils spends time on, cheap enough to always be on
+	 * @details Every value is spread over a handful of cache line sized shards, and each thread adds to the one its thread id picks, so threads rarely fight over a counter.
+	 * A snapshot adds the shards back up. Histograms use power of two buckets of nanoseconds, so bucket i holds values below 2^i ns
+	 */
+	namespace Metrics {
+		enum class Counter : uint8_t {
+			BytesDownloaded,
+			BytesReused, // Bytes of files that were already in place and didn't need to be written again
+			ArchivesOpened,
+			EntriesExtracted,
+			ConfigReads,
+			ConfigWrites,
+			ProcessesSpawned,
+			DlopenProbes,
+
+			Count
+		};
+
+		enum class Histogram : uint8_t {
+			InstallLockWait,
+			InstallLockHold,
+			ConfigLockWait,
+			ConfigLockHold,
+			Download,
+
+			Count
+		};
+
+		inline const char* CounterToString(Counter counter) {
+			switch (counter) {
+				case Counter::BytesDownloaded: return "BytesDownloaded";
+				case Counter::BytesReused: return "BytesReused";
+				case Counter::ArchivesOpened: return "ArchivesOpened";
+				case Counter::EntriesExtracted: return "EntriesExtracted";
+				case Counter::ConfigReads: return "ConfigReads";
+				case Counter::ConfigWrites: return "ConfigWrites";
+				case Counter::ProcessesSpawned: return "ProcessesSpawned";
+				case Counter::DlopenProbes: return "DlopenProbes";
+				default: return "Unknown";
+			}
+		}
+
+		inline const char* HistogramToString(Histogram histogram) {
+			switch (histogram) {
+				case Histogram::InstallLockWait: return "InstallLockWait";
+				case Histogram::InstallLockHold: return "InstallLockHold";
+				case Histogram::ConfigLockWait: return "ConfigLockWait";
+				case Histogram::ConfigLockHold: return "ConfigLockHold";
+				case Histogram::Download: return "Download";
+				default: return "Unknown";
+			}
+		}
+
+		constexpr size_t c_ShardCount = 8;
+		constexpr size_t c_CounterCount = (size_t)Counter::Count;
+		constexpr size_t c_HistogramCount = (size_t)Histogram::Count;
+		constexpr size_t c_BucketCount = 40; // The last bucket holds everything from 2^38 ns (about 4.5 minutes) up
+
+		struct HistogramShard {
+			std::array<std::atomic<uint64_t>, c_BucketCount> buckets = {};
+			std::atomic<uint64_t> count = 0;
+			std::atomic<uint64_t> sum = 0;
+		};
+
+		struct alignas(64) Shard {
+			std::array<std::atomic<uint64_t>, c_CounterCount> counters = {};
+			std::array<HistogramShard, c_HistogramCount> histograms = {};
+		};
+
+		struct HistogramSnapshot {
+			std::array<uint64_t, c_BucketCount> buckets = {};
+			uint64_t count = 0;
+			uint64_t sum = 0; // Nanoseconds
+
+			/**
+			 * @brief Estimates a percentile, as the upper bound of the bucket it falls in
+			 *
+			 * @param percentile From 0 to 1
+			 * @return The estimate in nanoseconds, 0 if nothing has been recorded
+			 */
+			uint64_t Percentile(double percentile) const {
+				if (count == 0) return 0;
+
+				uint64_t target = (uint64_t)(percentile * count);
+				uint64_t seen = 0;
+
+				for (size_t i = 0; i < c_BucketCount; i++) {
+					seen += buckets[i];
+					if (seen > target) return (uint64_t)1 << i;
+				}
+
+				return (uint64_t)1 << (c_BucketCount - 1);
+			}
+		};
+
+		struct Snapshot {
+			std::array<uint64_t, c_CounterCount> counters = {};
+			std::array<HistogramSnapshot, c_HistogramCount> histograms = {};
+
+			uint64_t operator[](Counter counter) const { return counters[(size_t)counter]; }
+			const HistogramSnapshot& operator[](Histogram histogram) const { return histograms[(size_t)histogram]; }
+		};
+
+		inline std::array<Shard, c_ShardCount>* m_Shards = new std::array<Shard, c_ShardCount>();
+
+		// Declerations
+
+		/**
+		 * @brief Adds to a counter
+		 */
+		inline void Add(Counter counter, uint64_t value = 1);
+
+		/**
+		 * @brief Records a duration into a histogram
+		 */
+		inline void Record(Histogram histogram, std::chrono::nanoseconds duration);
+
+		/**
+		 * @brief Sums every shard into a single set of values. Values added while this runs may or may not be included
+		 */
+		inline Snapshot TakeSnapshot();
+
+		/**
+		 * @brief Converts a snapshot to JSON, with each histogram's count, sum, p50, p90, p99 and non empty buckets
+		 */
+		inline std::string ToJson(const Snapshot& snapshot);
+
+		/**
+		 * @brief Writes a snapshot to a file every interval, replacing the file each time, until StopPeriodicDump is called
+		 * @details Calling this again while a dump is running just changes the file and interval
+		 */
+		inline void StartPeriodicDump(const std::string& path, std::chrono::seconds interval);
+		inline void StopPeriodicDump();
+
+		/**
+		 * @brief Runs a command like std::system, counting it as a spawned process
+		 */
+		inline int System(const std::string& command);
+
+		// Definitions
+
+		inline Shard& GetShard() {
+			thread_local Shard* shard = &(*m_Shards)[(size_t)syscall(SYS_gettid) % c_ShardCount];
+			return *shard;
+		}
+
+		void Add(Counter counter, uint64_t value) {
+			GetShard().counters[(size_t)counter].fetch_add(value, std::memory_order_relaxed);
+		}
+
+		void Record(Histogram histogram, std::chrono::nanoseconds duration) {
+			uint64_t ns = duration.count() > 0 ? duration.count() : 0;
+			size_t bucket = std::min((size_t)std::bit_width(ns), c_BucketCount - 1);
+
+			HistogramShard& shard = GetShard().histograms[(size_t)histogram];
+			shard.buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+			shard.count.fetch_add(1, std::memory_order_relaxed);
+			shard.sum.fetch_add(ns, std::memory_order_relaxed);
+		}
+
+		Snapshot TakeSnapshot() {
+			Snapshot snapshot;
+
+			for (Shard& shard : *m_Shards) {
+				for (size_t i = 0; i < c_CounterCount; i++) snapshot.counters[i] += shard.counters[i].load(std::memory_order_relaxed);
+
+				for (size_t h = 0; h < c_HistogramCount; h++) {
+					HistogramSnapshot& histogram = snapshot.histograms[h];
+
+					for (size_t b = 0; b < c_BucketCount; b++) histogram.buckets[b] += shard.histograms[h].buckets[b].load(std::memory_order_relaxed);
+					histogram.count += shard.histograms[h].count.load(std::memory_order_relaxed);
+					histogram.sum += shard.histograms[h].sum.load(std::memory_order_relaxed);
+				}
+			}
+
+			return snapshot;
+		}
+
+		std::string ToJson(const Snapshot& snapshot) {
+			std::string json = "{\"counters\":{";
+			char buffer[192];
+
+			for (size_t i = 0; i < c_CounterCount; i++) {
+				snprintf(buffer, sizeof(buffer), "%s\"%s\":%llu", i == 0 ? "" : ",", CounterToString((Counter)i), (unsigned long long)snapshot.counters[i]);
+				json += buffer;
+			}
+
+			json += "},\"histograms\":{";
+
+			for (size_t h = 0; h < c_HistogramCount; h++) {
+				const HistogramSnapshot& histogram = snapshot.histograms[h];
+
+				snprintf(buffer, sizeof(buffer), "%s\"%s\":{\"count\":%llu,\"sumNs\":%llu,\"p50Ns\":%llu,\"p90Ns\":%llu,\"p99Ns\":%llu,\"buckets\":{", h == 0 ? "" : ",", HistogramToString((Histogram)h),
+					(unsigned long long)histogram.count, (unsigned long long)histogram.sum,
+					(unsigned long long)histogram.Percentile(0.5), (unsigned long long)histogram.Percentile(0.9), (unsigned long long)histogram.Percentile(0.99));
+				json += buffer;
+
+				// Keyed by the bucket's upper bound in nanoseconds
+				bool first = true;
+				for (size_t b = 0; b < c_BucketCount; b++) {
+					if (histogram.buckets[b] == 0) continue;
+
+					snprintf(buffer, sizeof(buffer), "%s\"%llu\":%llu", first ? "" : ",", (unsigned long long)1 << b, (unsigned long long)histogram.buckets[b]);
+					json += buffer;
+					first = false;
+				}
+
+				json += "}}";
+			}
+
+			json += "}}";
+			return json;
+		}
+
+		inline std::mutex m_DumpLock;
+		inline std::condition_variable m_DumpWake;
+		inline std::string m_DumpPath;
+		inline std::chrono::seconds m_DumpInterval;
+		inline uint64_t m_DumpGeneration = 0; // Bumped on every start and stop, so an older dump thread knows to exit
+
+		inline bool WriteSnapshot(const std::string& path) {
+			std::string json = ToJson(TakeSnapshot());
+			std::string tmpPath = path + ".tmp";
+
+			FILE* file = fopen(tmpPath.c_str(), "wb");
+			if (file == nullptr) return false;
+
+			bool written = fwrite(json.data(), 1, json.size(), file) == json.size();
+			if (fclose(file) != 0 || !written) {
+				unlink(tmpPath.c_str());
+				return false;
+			}
+
+			return rename(tmpPath.c_str(), path.c_str()) == 0;
+		}
+
+		void StartPeriodicDump(const std::string& path, std::chrono::seconds interval) {
+			std::unique_lock lock(m_DumpLock);
+
+			m_DumpPath = path;
+			m_DumpInterval = interval;
+
+			uint64_t generation = ++m_DumpGeneration;
+			m_DumpWake.notify_all();
+
+			std::thread([generation] {
+				std::unique_lock lock(m_DumpLock);
+
+				while (true) {
+					m_DumpWake.wait_for(lock, m_DumpInterval, [generation] { return m_DumpGeneration != generation; });
+					if (m_DumpGeneration != generation) return;
+
+					std::string path = m_DumpPath;
+					lock.unlock();
+					WriteSnapshot(path);
+					lock.lock();
+				}
+			}).detach();
+		}
+
+		void StopPeriodicDump() {
+			std::unique_lock lock(m_DumpLock);
+
+			m_DumpGeneration++;
+			m_DumpWake.notify_all();
+		}
+
+		int System(const std::string& command) {
+			Add(Counter::ProcessesSpawned);
+			return std::system(command.c_str());
+		}
+
+		/**
+		 * @brief A std::unique_lock that records how long it waited for the mutex, and how long it held it
+		 */
+		class TimedLock {
+		public:
+			TimedLock(std::mutex& mutex, Histogram wait, Histogram hold) : TimedLock(mutex, wait, hold, std::defer_lock) {
+				lock();
+			}
+
+			TimedLock(std::mutex& mutex, Histogram wait, Histogram hold, std::defer_lock_t) : m_Lock(mutex, std::defer_lock), m_Wait(wait), m_Hold(hold) {}
+
+			~TimedLock() {
+				if (m_Lock.owns_lock()) unlock();
+			}
+
+			TimedLock(const TimedLock&) = delete;
+			TimedLock& operator=(const TimedLock&) = delete;
+
+			void lock() {
+				auto start = std::chrono::steady_clock::now();
+				m_Lock.lock();
+
+				m_Acquired = std::chrono::steady_clock::now();
+				Record(m_Wait, m_Acquired - start);
+			}
+
+			void unlock() {
+				Record(m_Hold, std::chrono::steady_clock::now() - m_Acquired);
+				m_Lock.unlock();
+			}
+
+		private:
+			std::unique_lock<std::mutex> m_Lock;
+			Histogram m_Wait;
+			Histogram m_Hold;
+			std::chrono::steady_clock::time_point m_Acquired;
+		};
+	}
+}
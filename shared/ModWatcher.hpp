@@ -0,0 +1,274 @@
+#pragma once
+
+#include "qmod-utils/shared/QModUtils.hpp"
+
+#include <sys/inotify.h>
+#include <sys/eventfd.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+namespace QModUtils {
+	namespace ModWatcher {
+		enum class WatchedDir {
+			QMods,
+			Mods,
+			Libs
+		};
+
+		// What happened to a file once all of the events in a batch have been collapsed
+		enum class FileChange {
+			Added,
+			Removed
+		};
+
+		inline std::atomic<bool> m_Running;
+		inline std::thread m_Thread;
+		inline std::mutex m_StartStopLock;
+
+		inline int m_InotifyFd = -1;
+		inline int m_StopFd = -1;
+
+		inline std::unordered_map<int, WatchedDir> m_Watches;
+
+		/**
+		 * @brief Starts watching the QMod directory and the mods / libs folders for changes made outside of QModUtils
+		 * @details Events are debounced, so a bulk copy of many QMods is applied as a single batch
+		 *
+		 * @param onChange Ran on the watcher thread after a batch has been applied to the mod lists
+		 * @param debounceMs How long the folders have to be quiet before a batch is applied
+		 * @param maxBatchMs The longest a batch will be held back for, even if events keep coming in
+		 * @return Returns false if the watcher is already running or inotify couldn't be set up
+		 */
+		inline bool Start(std::function<void()> onChange = nullptr, int debounceMs = 500, int maxBatchMs = 5000);
+
+		/**
+		 * @brief Stops the watcher and waits for its thread to exit
+		 */
+		inline void Stop();
+
+		/**
+		 * @brief Returns true if the watcher is currently running
+		 */
+		inline bool IsRunning();
+
+		// Private shit dont use >:(
+
+		inline void WatcherLoop(std::function<void()> onChange, int debounceMs, int maxBatchMs);
+		inline void ReadEvents(std::unordered_map<std::string, std::pair<WatchedDir, FileChange>>& pending);
+		inline void ApplyChanges(const std::unordered_map<std::string, std::pair<WatchedDir, FileChange>>& changes);
+
+		// Definitions
+
+		bool Start(std::function<void()> onChange, int debounceMs, int maxBatchMs) {
+			std::unique_lock guard(m_StartStopLock);
+			if (m_Running) return false;
+
+			Init();
+
+			m_InotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+			if (m_InotifyFd < 0) {
+				QLOG_ERROR("Failed to start the mod watcher, inotify_init1 failed! (errno %i)", errno);
+				return false;
+			}
+
+			m_StopFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+			if (m_StopFd < 0) {
+				QLOG_ERROR("Failed to start the mod watcher, eventfd failed! (errno %i)", errno);
+
+				close(m_InotifyFd);
+				m_InotifyFd = -1;
+				return false;
+			}
+
+			constexpr uint32_t mask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE;
+
+			m_Watches.clear();
+			m_Watches.emplace(inotify_add_watch(m_InotifyFd, m_QModPath, mask), WatchedDir::QMods);
+			m_Watches.emplace(inotify_add_watch(m_InotifyFd, Paths::GameMods().c_str(), mask), WatchedDir::Mods);
+			m_Watches.emplace(inotify_add_watch(m_InotifyFd, Paths::GameLibs().c_str(), mask), WatchedDir::Libs);
+			m_Watches.erase(-1);
+
+			if (m_Watches.empty()) {
+				QLOG_ERROR("Failed to start the mod watcher, none of the folders could be watched!");
+
+				close(m_InotifyFd);
+				close(m_StopFd);
+				m_InotifyFd = m_StopFd = -1;
+				return false;
+			}
+
+			m_Running = true;
+			m_Thread = std::thread(WatcherLoop, onChange, debounceMs, maxBatchMs);
+
+			QLOG_INFO("Started the mod watcher! (Watching %lu folders)", m_Watches.size());
+			return true;
+		}
+
+		void Stop() {
+			std::unique_lock guard(m_StartStopLock);
+			if (!m_Running) return;
+
+			uint64_t one = 1;
+			write(m_StopFd, &one, sizeof(one));
+
+			if (m_Thread.joinable()) m_Thread.join();
+
+			close(m_InotifyFd);
+			close(m_StopFd);
+			m_InotifyFd = m_StopFd = -1;
+
+			m_Running = false;
+			QLOG_INFO("Stopped the mod watcher!");
+		}
+
+		bool IsRunning() {
+			return m_Running;
+		}
+
+		void WatcherLoop(std::function<void()> onChange, int debounceMs, int maxBatchMs) {
+			std::unordered_map<std::string, std::pair<WatchedDir, FileChange>> pending;
+			std::chrono::steady_clock::time_point batchStart;
+
+			pollfd fds[2] = {
+				{ m_InotifyFd, POLLIN, 0 },
+				{ m_StopFd, POLLIN, 0 }
+			};
+
+			while (true) {
+				// Wait forever when there's nothing pending, else only wait until the folders have been quiet for long enough
+				int timeout = -1;
+
+				if (!pending.empty()) {
+					int elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - batchStart).count();
+					timeout = std::max(0, std::min(debounceMs, maxBatchMs - elapsed));
+				}
+
+				int res = poll(fds, 2, timeout);
+
+				if (res < 0) {
+					if (errno == EINTR) continue;
+
+					QLOG_ERROR("Mod watcher poll failed! (errno %i)", errno);
+					return;
+				}
+
+				if (fds[1].revents & POLLIN) return;
+
+				if (res > 0 && (fds[0].revents & POLLIN)) {
+					if (pending.empty()) batchStart = std::chrono::steady_clock::now();
+					ReadEvents(pending);
+
+					int elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - batchStart).count();
+					if (elapsed < maxBatchMs) continue;
+				}
+
+				if (pending.empty()) continue;
+
+				QLOG_INFO("Mod watcher applying %lu changes", pending.size());
+
+				ApplyChanges(pending);
+				pending.clear();
+
+				if (onChange) onChange();
+			}
+		}
+
+		void ReadEvents(std::unordered_map<std::string, std::pair<WatchedDir, FileChange>>& pending) {
+			alignas(inotify_event) char buffer[16 * 1024];
+
+			while (true) {
+				ssize_t len = read(m_InotifyFd, buffer, sizeof(buffer));
+				if (len <= 0) return;
+
+				for (char* ptr = buffer; ptr < buffer + len; ptr += sizeof(inotify_event) + ((inotify_event*)ptr)->len) {
+					inotify_event* event = (inotify_event*)ptr;
+
+					if (event->len == 0 || (event->mask & IN_ISDIR)) continue;
+
+					auto watch = m_Watches.find(event->wd);
+					if (watch == m_Watches.end()) continue;
+
+					std::string name = event->name;
+
+					// Cover images and the like live next to the QMods, we only care about the QMods themselves
+					if (watch->second == WatchedDir::QMods && (name.size() < 5 || name.compare(name.size() - 5, 5, ".qmod") != 0)) continue;
+
+					FileChange change = (event->mask & (IN_DELETE | IN_MOVED_FROM)) ? FileChange::Removed : FileChange::Added;
+
+					// Later events replace earlier ones, so a file that is written and then deleted within the same batch is only seen as removed
+					pending.insert_or_assign(name, std::make_pair(watch->second, change));
+				}
+			}
+		}
+
+		void ApplyChanges(const std::unordered_map<std::string, std::pair<WatchedDir, FileChange>>& changes) {
+			bool modFilesRemoved = false;
+
+			for (auto& [name, change] : changes) {
+				auto [dir, fileChange] = change;
+
+				if (dir != WatchedDir::QMods) {
+					if (fileChange == FileChange::Removed) modFilesRemoved = true;
+					continue;
+				}
+
+				std::string filePath = m_QModPath + name;
+
+				QMod* existing = nullptr;
+				for (QMod* qmod : QMod::DownloadedQMods()) {
+					if (qmod->Path() == filePath) {
+						existing = qmod;
+						break;
+					}
+				}
+
+				if (fileChange == FileChange::Added) {
+					if (existing != nullptr) {
+						// Installs move their QMod into this folder too, so those will already be known. Only a QMod that was overwritten is loaded again
+						if (!existing->FileChanged()) continue;
+
+						ModState state = existing->State();
+						if (state == ModState::Installing || state == ModState::Uninstalling) continue;
+
+						QLOG_INFO("Mod watcher found that QMod File \"%s\" was overwritten, loading it again", name.c_str());
+						QMod::ForgetVersion(existing);
+					}
+
+					QMod* qmod = new QMod(filePath, false);
+
+					if (qmod->Valid()) {
+						QLOG_INFO("Mod watcher found new QMod File \"%s\"", name.c_str());
+					} else {
+						delete qmod;
+					}
+				} else if (existing != nullptr) {
+					ModState state = existing->State();
+					if (state == ModState::Installing || state == ModState::Uninstalling) continue;
+
+					// Something on another thread may still be holding it, so it's only freed on the next rescan
+					QLOG_INFO("Mod watcher found that QMod File \"%s\" was removed", name.c_str());
+					QMod::ForgetVersion(existing);
+				}
+			}
+
+			// Something else removed files from the mods / libs folders, so check which installed mods were affected
+			if (modFilesRemoved) {
+				for (QMod* qmod : QMod::DownloadedQMods()) {
+					qmod->VerifyInstalledFiles();
+				}
+			}
+
+			// Mods may have been added, forgotten or found to be broken, and each changes who holds the libraries
+			QMod::RebuildLibraryRegistry();
+
+			RefreshModLists();
+		}
+	}
+}
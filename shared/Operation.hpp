@@ -0,0 +1,154 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+namespace QModUtils {
+	/**
+	 * @brief The priority and cancellation token of whatever mod operation the current thread is doing
+	 * @details Every async method on QMod captures the caller's context and carries it into its thread (and on into the threads it starts, like dependency installs).
+	 * Background operations give way to interactive ones at each checkpoint, meaning between download chunks and before taking the install lock.
+	 * Once an operation's token is cancelled, its next checkpoint fails, and it stops, removing anything it had already put in place
+	 */
+	namespace Operation {
+		enum class Priority : uint8_t {
+			Background, // Gives way to any interactive operation that's running
+			Interactive
+		};
+
+		class CancellationToken {
+		public:
+			CancellationToken() : m_Cancelled(std::make_shared<std::atomic<bool>>(false)) {}
+
+			inline void Cancel();
+
+			bool IsCancelled() const {
+				return m_Cancelled->load(std::memory_order_relaxed);
+			}
+
+		private:
+			std::shared_ptr<std::atomic<bool>> m_Cancelled; // Shared by every copy, so cancelling one cancels them all
+		};
+
+		struct Context {
+			CancellationToken token;
+			Priority priority = Priority::Interactive;
+		};
+
+		inline std::mutex m_YieldLock;
+		inline std::condition_variable m_YieldWake;
+		inline int m_InteractiveCount = 0; // Interactive operations running right now, guarded by m_YieldLock
+		inline bool m_Paused = false; // Guarded by m_YieldLock
+
+		inline Context& Current() {
+			thread_local Context context;
+			return context;
+		}
+
+		void CancellationToken::Cancel() {
+			m_Cancelled->store(true, std::memory_order_relaxed);
+
+			// Wake anything waiting on an interactive operation, so it can see it's been cancelled
+			std::unique_lock lock(m_YieldLock);
+			m_YieldWake.notify_all();
+		}
+
+		/**
+		 * @brief Makes a context current on this thread, until it goes out of scope
+		 */
+		class Scope {
+		public:
+			explicit Scope(Context context) : m_Previous(Current()) {
+				Current() = std::move(context);
+
+				if (Current().priority == Priority::Interactive) {
+					std::unique_lock lock(m_YieldLock);
+					m_InteractiveCount++;
+				}
+			}
+
+			Scope(CancellationToken token, Priority priority) : Scope(Context { std::move(token), priority }) {}
+
+			~Scope() {
+				if (Current().priority == Priority::Interactive) {
+					std::unique_lock lock(m_YieldLock);
+
+					if (--m_InteractiveCount == 0) m_YieldWake.notify_all();
+				}
+
+				Current() = std::move(m_Previous);
+			}
+
+			Scope(const Scope&) = delete;
+			Scope& operator=(const Scope&) = delete;
+
+		private:
+			Context m_Previous;
+		};
+
+		/**
+		 * @brief Checks if the current operation has been cancelled, without giving way to anything
+		 * @details Use this where a lock is held, as waiting there could hold up the interactive operation being waited on
+		 */
+		inline bool IsCancelled() {
+			return Current().token.IsCancelled();
+		}
+
+		/**
+		 * @brief Holds every operation at its next checkpoint (and throttled write) until Resume is called, like while a song is being played
+		 */
+		inline void Pause() {
+			std::unique_lock lock(m_YieldLock);
+			m_Paused = true;
+		}
+
+		inline void Resume() {
+			std::unique_lock lock(m_YieldLock);
+
+			m_Paused = false;
+			m_YieldWake.notify_all();
+		}
+
+		inline bool IsPaused() {
+			std::unique_lock lock(m_YieldLock);
+			return m_Paused;
+		}
+
+		/**
+		 * @brief Waits while operations are paused. Unlike Checkpoint this never gives way to interactive operations, so it's safe to call with a lock held
+		 *
+		 * @return Returns false if the operation has been cancelled, and should stop
+		 */
+		inline bool WaitWhilePaused() {
+			const Context& context = Current();
+
+			std::unique_lock lock(m_YieldLock);
+			m_YieldWake.wait(lock, [&] { return !m_Paused || context.token.IsCancelled(); });
+
+			return !context.token.IsCancelled();
+		}
+
+		/**
+		 * @brief A point where the current operation can stop or give way. Every operation waits here while paused, and background ones also wait for every interactive operation to finish
+		 *
+		 * @return Returns false if the operation has been cancelled, and should stop
+		 */
+		inline bool Checkpoint() {
+			const Context& context = Current();
+			if (context.token.IsCancelled()) return false;
+
+			std::unique_lock lock(m_YieldLock);
+			m_YieldWake.wait(lock, [&] {
+				if (context.token.IsCancelled()) return true;
+
+				return !m_Paused && (context.priority == Priority::Interactive || m_InteractiveCount == 0);
+			});
+
+			return !context.token.IsCancelled();
+		}
+	}
+}
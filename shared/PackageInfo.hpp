@@ -0,0 +1,88 @@
+#pragma once
+
+#ifndef QMODUTILS_NO_JNI
+#include "jni-utils/shared/JNIUtils.hpp"
+#endif
+
+#include <functional>
+#include <mutex>
+#include <string>
+
+namespace QModUtils {
+	/**
+	 * @brief Where the package id and version of the game, and a way to restart it, come from
+	 * @details On the Quest these come from JNI. Anywhere else (like the host benchmarks) define QMODUTILS_NO_JNI and set a provider before Init
+	 */
+	namespace PackageInfo {
+		struct Info {
+			std::string packageId;
+			std::string version;
+		};
+
+		using Provider = std::function<Info()>;
+		using RestartHandler = std::function<void()>;
+
+		inline Provider& CurrentProvider() {
+#ifndef QMODUTILS_NO_JNI
+			static Provider provider = []() {
+				JNIEnv* env = JNIUtils::GetJNIEnv();
+
+				return Info { JNIUtils::ToString(JNIUtils::GetPackageName(env), env), JNIUtils::ToString(JNIUtils::GetGameVersion(env), env) };
+			};
+#else
+			static Provider provider = []() { return Info { "com.beatgames.beatsaber", "0.0.0" }; };
+#endif
+			return provider;
+		}
+
+		inline RestartHandler& CurrentRestartHandler() {
+#ifndef QMODUTILS_NO_JNI
+			static RestartHandler handler = []() { JNIUtils::RestartApp(); };
+#else
+			static RestartHandler handler = []() {};
+#endif
+			return handler;
+		}
+
+		inline std::mutex& CacheLock() {
+			static std::mutex lock;
+			return lock;
+		}
+
+		inline Info*& Cached() {
+			static Info* cached = nullptr;
+			return cached;
+		}
+
+		/**
+		 * @brief Replaces where the package info comes from, and drops anything cached from the old provider
+		 */
+		inline void SetProvider(Provider provider) {
+			std::unique_lock lock(CacheLock());
+
+			CurrentProvider() = std::move(provider);
+
+			delete Cached();
+			Cached() = nullptr;
+		}
+
+		inline void SetRestartHandler(RestartHandler handler) {
+			CurrentRestartHandler() = std::move(handler);
+		}
+
+		/**
+		 * @brief Gets the package info, only asking the provider the first time
+		 */
+		inline const Info& Get() {
+			std::unique_lock lock(CacheLock());
+
+			if (Cached() == nullptr) Cached() = new Info(CurrentProvider()());
+
+			return *Cached();
+		}
+
+		inline void RestartApp() {
+			CurrentRestartHandler()();
+		}
+	}
+}
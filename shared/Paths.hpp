@@ -0,0 +1,87 @@
+#pragma once
+
+#include <string>
+
+namespace QModUtils {
+	/**
+	 * @brief Every folder and file QModUtils touches, relative to a root that defaults to "/sdcard"
+	 * @details The root can be moved (for example to run against a scratch folder on a desktop), but only before Init, and before any QMod is created.
+	 * Every path to a folder ends in a slash
+	 */
+	namespace Paths {
+		struct Layout {
+			std::string root;
+
+			std::string bmbfData;
+			std::string config;
+			std::string coreMods;
+			std::string journal;
+			std::string profiles;
+
+			std::string mods;
+			std::string temp;
+			std::string downloads;
+			std::string store;
+			std::string unpacked;
+			std::string coverCache;
+
+			std::string gameMods;
+			std::string gameLibs;
+		};
+
+		inline Layout MakeLayout(const std::string& root) {
+			Layout layout;
+			layout.root = root;
+
+			layout.bmbfData = root + "/BMBFData/";
+			layout.config = layout.bmbfData + "config.json";
+			layout.coreMods = layout.bmbfData + "core-mods.json";
+			layout.journal = layout.bmbfData + "qmod-utils.journal";
+			layout.profiles = layout.bmbfData + "qmod-profiles.json";
+
+			layout.mods = layout.bmbfData + "Mods/";
+			layout.temp = layout.mods + "Temp/";
+			layout.downloads = layout.temp + "Downloads/";
+			layout.store = layout.mods + "Store/";
+			layout.unpacked = layout.mods + "Unpacked/";
+			layout.coverCache = layout.mods + "Covers.pack";
+
+			layout.gameMods = root + "/Android/data/com.beatgames.beatsaber/files/mods/";
+			layout.gameLibs = root + "/Android/data/com.beatgames.beatsaber/files/libs/";
+
+			return layout;
+		}
+
+		inline Layout& Current() {
+			static Layout layout = MakeLayout("/sdcard");
+			return layout;
+		}
+
+		/**
+		 * @brief Moves every path under a different root
+		 *
+		 * @param root The folder that takes the place of "/sdcard", without a trailing slash
+		 */
+		inline void SetRoot(const std::string& root) {
+			Current() = MakeLayout(root);
+		}
+
+		inline const std::string& Root() { return Current().root; }
+
+		inline const std::string& BMBFData() { return Current().bmbfData; }
+		inline const std::string& Config() { return Current().config; }
+		inline const std::string& CoreMods() { return Current().coreMods; }
+		inline const std::string& Journal() { return Current().journal; }
+		inline const std::string& Profiles() { return Current().profiles; }
+
+		inline const std::string& Mods() { return Current().mods; }
+		inline const std::string& Temp() { return Current().temp; }
+		inline const std::string& Downloads() { return Current().downloads; }
+		inline const std::string& Store() { return Current().store; }
+		inline const std::string& Unpacked() { return Current().unpacked; }
+		inline const std::string& CoverCache() { return Current().coverCache; }
+
+		inline const std::string& GameMods() { return Current().gameMods; }
+		inline const std::string& GameLibs() { return Current().gameLibs; }
+	}
+}
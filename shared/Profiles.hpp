@@ -0,0 +1,334 @@
+#pragma once
+
+#include "qmod-utils/shared/QModUtils.hpp"
+#include "qmod-utils/shared/Journal.hpp"
+
+#include "beatsaber-hook/shared/rapidjson/include/rapidjson/document.h"
+#include "beatsaber-hook/shared/rapidjson/include/rapidjson/writer.h"
+#include "beatsaber-hook/shared/rapidjson/include/rapidjson/stringbuffer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace QModUtils {
+	/**
+	 * @brief Named sets of mods, each with the version it should be at and if it should be enabled, saved to "BMBFData/qmod-profiles.json"
+	 * @details Switching to a profile only touches the mods whose state differs from it, and does it as one operation:
+	 * every disable is done first, then everything the enables need is extracted in parallel, then they're installed as a single plan.
+	 * config.json is written once at the end, instead of once per mod
+	 */
+	namespace Profiles {
+		struct ProfileEntry {
+			std::string id;
+			std::string version;
+			bool enabled;
+		};
+
+		struct Profile {
+			std::string name;
+			std::vector<ProfileEntry> mods;
+		};
+
+		// Declerations
+
+		/**
+		 * @brief Reads every saved profile
+		 */
+		inline std::vector<Profile> GetProfiles();
+
+		inline std::optional<Profile> GetProfile(const std::string& name);
+
+		/**
+		 * @brief Saves a profile, replacing any saved profile with the same name
+		 *
+		 * @return Returns false if the profiles couldn't be written, in which case the saved ones are untouched
+		 */
+		inline bool SaveProfile(const Profile& profile);
+
+		/**
+		 * @return Returns false if there was no profile with that name, or the profiles couldn't be written
+		 */
+		inline bool DeleteProfile(const std::string& name);
+
+		/**
+		 * @brief Makes a profile out of the active version of every downloaded mod, and if it's installed. It isn't saved
+		 */
+		inline Profile CaptureProfile(const std::string& name);
+
+		/**
+		 * @brief Brings every mod in a profile to the version and state it has there. Mods that aren't in the profile are left alone
+		 * @details Versions that aren't downloaded are logged and skipped. Mods are disabled without cleaning their dependents, as the profile says what those should be
+		 *
+		 * @return Returns false if there's no profile with that name, part of the switch failed, or config.json couldn't be written
+		 */
+		inline bool SwitchProfile(const std::string& name);
+
+		// Definitions
+
+		inline std::mutex m_Lock; // Guards the profiles file
+
+		inline std::vector<Profile> ReadProfiles() {
+			std::vector<char> buffer;
+			rapidjson::Document document;
+
+			if (!JsonUtils::ReadFile(Paths::Profiles(), buffer) || document.ParseInsitu(buffer.data()).HasParseError() || !document.IsObject()) return {};
+
+			auto profiles = document.FindMember("Profiles");
+			if (profiles == document.MemberEnd() || !profiles->value.IsArray()) return {};
+
+			std::vector<Profile> result;
+
+			for (const rapidjson::Value& profileValue : profiles->value.GetArray()) {
+				if (!profileValue.IsObject() || !profileValue.HasMember("Name") || !profileValue["Name"].IsString()) continue;
+
+				Profile& profile = result.emplace_back();
+				profile.name = profileValue["Name"].GetString();
+
+				if (!profileValue.HasMember("Mods") || !profileValue["Mods"].IsArray()) continue;
+
+				for (const rapidjson::Value& mod : profileValue["Mods"].GetArray()) {
+					if (!mod.IsObject() || !mod.HasMember("Id") || !mod["Id"].IsString() || !mod.HasMember("Version") || !mod["Version"].IsString()) continue;
+
+					bool enabled = mod.HasMember("Enabled") && mod["Enabled"].IsBool() && mod["Enabled"].GetBool();
+					profile.mods.push_back({ mod["Id"].GetString(), mod["Version"].GetString(), enabled });
+				}
+			}
+
+			return result;
+		}
+
+		inline bool WriteProfiles(const std::vector<Profile>& profiles) {
+			rapidjson::StringBuffer buffer;
+			rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+
+			writer.StartObject();
+			writer.Key("Profiles");
+			writer.StartArray();
+
+			for (const Profile& profile : profiles) {
+				writer.StartObject();
+				writer.Key("Name");
+				writer.String(profile.name.c_str(), profile.name.size());
+
+				writer.Key("Mods");
+				writer.StartArray();
+
+				for (const ProfileEntry& mod : profile.mods) {
+					writer.StartObject();
+					writer.Key("Id");
+					writer.String(mod.id.c_str(), mod.id.size());
+					writer.Key("Version");
+					writer.String(mod.version.c_str(), mod.version.size());
+					writer.Key("Enabled");
+					writer.Bool(mod.enabled);
+					writer.EndObject();
+				}
+
+				writer.EndArray();
+				writer.EndObject();
+			}
+
+			writer.EndArray();
+			writer.EndObject();
+
+			FileUtils::MakeDirs(Paths::BMBFData());
+			return FileUtils::WriteFileAtomic(Paths::Profiles(), buffer.GetString(), buffer.GetSize());
+		}
+
+		std::vector<Profile> GetProfiles() {
+			std::unique_lock lock(m_Lock);
+			return ReadProfiles();
+		}
+
+		std::optional<Profile> GetProfile(const std::string& name) {
+			for (Profile& profile : GetProfiles()) {
+				if (profile.name == name) return std::move(profile);
+			}
+
+			return std::nullopt;
+		}
+
+		bool SaveProfile(const Profile& profile) {
+			std::unique_lock lock(m_Lock);
+			std::vector<Profile> profiles = ReadProfiles();
+
+			auto existing = std::find_if(profiles.begin(), profiles.end(), [&](const Profile& saved) { return saved.name == profile.name; });
+			if (existing != profiles.end()) {
+				*existing = profile;
+			} else {
+				profiles.push_back(profile);
+			}
+
+			if (!WriteProfiles(profiles)) {
+				QLOG_ERROR("Failed to save profile \"%s\" (errno %i)", profile.name.c_str(), errno);
+				return false;
+			}
+
+			return true;
+		}
+
+		bool DeleteProfile(const std::string& name) {
+			std::unique_lock lock(m_Lock);
+			std::vector<Profile> profiles = ReadProfiles();
+
+			auto existing = std::find_if(profiles.begin(), profiles.end(), [&](const Profile& saved) { return saved.name == name; });
+			if (existing == profiles.end()) return false;
+
+			profiles.erase(existing);
+			return WriteProfiles(profiles);
+		}
+
+		Profile CaptureProfile(const std::string& name) {
+			Profile profile { name, {} };
+
+			for (QMod* qmod : QMod::DownloadedQMods()) {
+				profile.mods.push_back({ std::string(qmod->Id()), std::string(qmod->Version()), qmod->IsInstalled() });
+			}
+
+			// The downloaded QMods are unordered, so this keeps saved profiles stable
+			std::sort(profile.mods.begin(), profile.mods.end(), [](const ProfileEntry& a, const ProfileEntry& b) { return a.id < b.id; });
+
+			return profile;
+		}
+
+		/**
+		 * @brief Prefetches QMods on up to 4 threads at once
+		 */
+		inline void PrefetchAll(const std::vector<QMod*>& qmods) {
+			TRACE_SCOPE("Profiles", "PrefetchAll");
+
+			unsigned int cores = std::max(std::thread::hardware_concurrency(), 1u);
+			size_t workers = std::min<size_t>(qmods.size(), std::min(cores, 4u));
+
+			std::atomic<size_t> next = 0;
+			std::vector<std::thread> threads;
+
+			for (size_t i = 0; i < workers; i++) {
+				threads.emplace_back([&qmods, &next, context = Operation::Current()] {
+					Operation::Scope operation(context);
+					Background::ApplyToCurrentThread();
+
+					for (size_t index = next++; index < qmods.size() && Operation::Checkpoint(); index = next++) {
+						qmods[index]->Prefetch();
+					}
+				});
+			}
+
+			for (std::thread& thread : threads) thread.join();
+		}
+
+		bool SwitchProfile(const std::string& name) {
+			TRACE_SCOPE("Profiles", "SwitchProfile");
+
+			std::optional<Profile> profile = GetProfile(name);
+			if (!profile.has_value()) {
+				QLOG_ERROR("There's no profile called \"%s\"", name.c_str());
+				return false;
+			}
+
+			struct VersionSwitch {
+				QMod* target;
+				bool enabled;
+			};
+
+			std::vector<QMod*> disables;
+			std::vector<QMod*> enables;
+			std::vector<VersionSwitch> versionSwitches;
+
+			// Only the mods that differ from the profile are touched
+			for (const ProfileEntry& entry : profile->mods) {
+				QMod* target = nullptr;
+				for (QMod* version : QMod::GetVersions(entry.id)) {
+					if (version->Version() == entry.version) target = version;
+				}
+
+				if (target == nullptr) {
+					QLOG_WARNING("Profile \"%s\" has \"%s\" v%s, which isn't downloaded, skipping it", name.c_str(), entry.id.c_str(), entry.version.c_str());
+					continue;
+				}
+
+				if (!target->IsActive()) {
+					versionSwitches.push_back({ target, entry.enabled });
+				} else if (entry.enabled && !target->IsInstalled()) {
+					enables.push_back(target);
+				} else if (!entry.enabled && target->IsInstalled()) {
+					disables.push_back(target);
+				}
+			}
+
+			if (disables.empty() && enables.empty() && versionSwitches.empty()) {
+				QLOG_INFO("Already on profile \"%s\"", name.c_str());
+				return true;
+			}
+
+			QLOG_INFO("Switching to profile \"%s\": disabling %zu, enabling %zu and switching the version of %zu mods", name.c_str(), disables.size(), enables.size(), versionSwitches.size());
+
+			bool success = true;
+
+			{
+				// Every transaction's COMMIT is held back until the single config.json write at the end
+				Journal::Batch journal;
+				QMod::ConfigBatch config;
+
+				// Disables go first, so libraries the profile no longer uses are out of the way. Each takes the install lock, so they queue up on it instead of on each other
+				std::vector<std::thread> threads;
+				for (QMod* qmod : disables) {
+					std::optional<std::thread> thread = qmod->UninstallAsync(true, false);
+
+					if (thread.has_value()) {
+						threads.push_back(std::move(thread.value()));
+					} else {
+						QLOG_WARNING("Failed to disable QMod \"%s\", thread was invalid!", qmod->Id().data());
+						success = false;
+					}
+				}
+
+				for (std::thread& thread : threads) thread.join();
+
+				// A mod that stays enabled is installed over the old version's files, anything else is just swapped
+				for (const VersionSwitch& versionSwitch : versionSwitches) {
+					if (!Operation::Checkpoint()) break;
+
+					if (!versionSwitch.target->Activate(versionSwitch.enabled)) {
+						QLOG_WARNING("Failed to switch \"%s\" to v%s", versionSwitch.target->Id().data(), versionSwitch.target->Version().data());
+						success = false;
+						continue;
+					}
+
+					if (versionSwitch.enabled && !versionSwitch.target->IsInstalled()) enables.push_back(versionSwitch.target);
+				}
+
+				if (!enables.empty() && Operation::Checkpoint()) {
+					PrefetchAll(enables);
+
+					if (!DependencyResolver::ExecutePlan(enables)) {
+						QLOG_WARNING("Failed to enable every mod in profile \"%s\"", name.c_str());
+						success = false;
+					}
+				}
+
+				// If config.json couldn't be written, the transactions are left unfinished, so recovery brings config.json in line on the next start
+				if (!config.Close()) {
+					QLOG_ERROR("Failed to write config.json for profile \"%s\", it will be fixed up on the next start", name.c_str());
+
+					journal.Abandon();
+					success = false;
+				}
+			}
+
+			if (Operation::IsCancelled()) {
+				QLOG_INFO("Switching to profile \"%s\" was cancelled", name.c_str());
+				success = false;
+			}
+
+			RefreshModLists();
+
+			return success;
+		}
+	}
+}
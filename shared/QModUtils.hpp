@@ -1,23 +1,32 @@
 #pragma once
 
-#include "cpp-semver/shared/cpp-semver.hpp"
-
 #include "qmod-utils/shared/Types/QMod.hpp"
 #include "qmod-utils/shared/Types/CoreModInfo.hpp"
+#include "qmod-utils/shared/Types/ModListSnapshot.hpp"
 #include "qmod-utils/shared/WebUtils.hpp"
+#include "qmod-utils/shared/FileUtils.hpp"
+#include "qmod-utils/shared/JsonUtils.hpp"
+#include "qmod-utils/shared/Semver.hpp"
+#include "qmod-utils/shared/DependencyResolver.hpp"
+#include "qmod-utils/shared/Paths.hpp"
+#include "qmod-utils/shared/Trace.hpp"
+#include "qmod-utils/shared/Metrics.hpp"
+#include "qmod-utils/shared/Operation.hpp"
+#include "qmod-utils/shared/Background.hpp"
 
 #include "modloader/shared/modloader.hpp"
+#include "qmod-utils/shared/Log.hpp"
 
 #include "beatsaber-hook/shared/rapidjson/include/rapidjson/rapidjson.h"
 
-#include "jni-utils/shared/JNIUtils.hpp"
+#include "qmod-utils/shared/PackageInfo.hpp"
 
 #include <list>
 #include <dirent.h>
-#include <jni.h>
 #include <unordered_map>
 #include <sstream>
 #include <fstream>
+#include <mutex>
 
 Logger& getLogger();
 
@@ -38,6 +47,9 @@ namespace QModUtils {
 	inline std::unordered_map<std::string, QMod*>* m_UninstalledQMods;
 	inline std::unordered_map<std::string, QMod*>* m_FailedToLoadMods;
 
+	// Guards the installed / uninstalled / failed lists, as the ModWatcher can rebuild them from its own thread
+	inline std::mutex m_ModListsLock;
+
 	/**
 	 * @brief Get all the files that are contained in a specified directory
 	 * 
@@ -67,6 +79,14 @@ namespace QModUtils {
 	 */
 	inline std::unordered_map<std::string, QModUtils::QMod *> GetFailedToLoadMods();
 
+	/**
+	 * @brief Fills a snapshot with the ids, names, versions, states and flags of every downloaded QMod in one pass
+	 * @details The snapshot only allocates when it needs to grow, so refilling the same one every frame doesn't allocate
+	 * 
+	 * @param snapshot The snapshot to fill. Anything already in it is overwritten
+	 */
+	inline void GetModListSnapshot(ModListSnapshot& snapshot);
+
 	/**
 	 * @brief Sets the activity of a specific QMod
 	 * 
@@ -101,6 +121,7 @@ namespace QModUtils {
 
 	/**
 	 * @brief Reloads a specific QMod
+	 * @details Installed QMods are reinstalled over their own files, so only the files that don't match the .qmod are rewritten
 	 * 
 	 * @param qmod The QMod to reload
 	 */
@@ -169,15 +190,23 @@ namespace QModUtils {
 
 	/**
 	 * @brief Attempts to download and install missing core mods
+	 * @details Runs as a background operation, so it gives way to anything the user starts while it's going. It can still be cancelled through the caller's token
 	 * 
 	 * @param restart Weather to restart the game after install or not
 	 */
 	inline void InstallMissingCoreMods(bool restart = true);
 
+	/**
+	 * @brief Rebuilds the installed, uninstalled and failed to load lists from the currently downloaded QMods
+	 */
+	inline void RefreshModLists();
+
 	/**
 	 * @brief Should be called on Load
+	 *
+	 * @param fetchCoreMods If false, the list of core mods isn't downloaded, so none are reported as missing. For hosts without a network, like the benchmark
 	 */
-	inline void Init();
+	inline void Init(bool fetchCoreMods = true);
 
 	// Private shit dont use >:(
 
@@ -208,40 +237,85 @@ namespace QModUtils {
 			}
 		}
 
+		closedir(dir);
 		return files;
 	}
 
 	std::unordered_map<std::string, QModUtils::QMod *> GetInstalledMods() {
 		Init();
 
+		std::unique_lock guard(m_ModListsLock);
 		return *m_InstalledQMods;
 	}
 
 	std::unordered_map<std::string, QModUtils::QMod *> GetUninstalledMods() {
 		Init();
 
+		std::unique_lock guard(m_ModListsLock);
 		return *m_UninstalledQMods;
 	}
 
 	std::unordered_map<std::string, QModUtils::QMod *> GetFailedToLoadMods() {
 		Init();
 		
+		std::unique_lock guard(m_ModListsLock);
 		return *m_FailedToLoadMods;
 	}
 
+	void GetModListSnapshot(ModListSnapshot& snapshot) {
+		Init();
+
+		// Read straight out of the registry instead of copying it, and looked up by the same key, so a core mod is found without locking per row
+		auto registry = QMod::LockRegistry();
+		std::unordered_map<std::string, QMod*>* downloaded = QMod::GetDownloadedQMods();
+		std::unordered_map<std::string, QMod*>* coreMods = QMod::GetCoreMods();
+
+		snapshot.Reserve(downloaded->size());
+		snapshot.count = 0;
+
+		for (auto& [id, qmod] : *downloaded) {
+			size_t i = snapshot.count++;
+
+			snapshot.mods[i] = qmod;
+			snapshot.ids[i] = qmod->Id();
+			snapshot.names[i] = qmod->Name();
+			snapshot.versions[i] = qmod->Version();
+			snapshot.states[i] = qmod->State();
+
+			uint8_t flags = ModListSnapshot::None;
+			if (qmod->Uninstallable()) flags |= ModListSnapshot::Uninstallable;
+			if (qmod->IsLibrary()) flags |= ModListSnapshot::Library;
+			if (coreMods->contains(id)) flags |= ModListSnapshot::CoreMod;
+			if (ModHasError(qmod)) flags |= ModListSnapshot::HasError;
+
+			snapshot.flags[i] = flags;
+		}
+	}
+
 	void SetModActive(QMod* qmod, bool active) {
-		getLogger().info("%s QMod \"%s\"", active ? "Enabling" : "Disabling", qmod->Name().c_str());
+		QLOG_INFO("%s QMod \"%s\"", active ? "Enabling" : "Disabling", qmod->Name().data());
+
+		// Enabling resolves the whole dependency tree first, so conflicting version ranges are reported instead of fought over
+		if (active) {
+			std::thread([qmod, context = Operation::Current()] {
+				Operation::Scope operation(context);
+				Background::ApplyToCurrentThread();
 
-		if (active) qmod->Install();
-		else qmod->Uninstall();
+				DependencyResolver::ExecutePlan({ qmod });
+			}).detach();
+		} else {
+			qmod->Uninstall();
+		}
 	}
 
 	inline bool qmodSortFunction(QMod* a, QMod* b) { return a->IsInstalled(); }
 	inline bool boolSortFunction(bool a, bool b) { return !a; }
 
 	void SetModsActive(std::vector<QMod*>* qmods, std::vector<bool> actives, std::function<void(QMod*, bool)> onSetActiveStart) {
+		TRACE_SCOPE("QModUtils", "SetModsActive");
+
 		if (qmods->size() != actives.size()) {
-			getLogger().error("Failed to set the activity of a list of QMods, Vector size mismatch!");
+			QLOG_ERROR("Failed to set the activity of a list of QMods, Vector size mismatch!");
 			return;
 		}
 
@@ -251,15 +325,17 @@ namespace QModUtils {
 		for (int i = 0; i < qmods->size(); i++) {
 			if (onSetActiveStart) onSetActiveStart(qmods->at(i), actives[i]);
 
-			std::optional<std::thread> t;
+			if (actives[i]) {
+				if (!DependencyResolver::ExecutePlan({ qmods->at(i) })) QLOG_WARNING("Failed to enable QMod \"%s\"!", qmods->at(i)->Id().data());
+				continue;
+			}
 
-			if (actives[i]) t = qmods->at(i)->InstallAsync();
-			else t = qmods->at(i)->UninstallAsync();
+			std::optional<std::thread> t = qmods->at(i)->UninstallAsync();
 
 			if (t.has_value()) {
 				t.value().join();
 			} else {
-				getLogger().warning("Skipping QMod \"%s\", thread  was invalid!", qmods->at(i)->Id().c_str());
+				QLOG_WARNING("Skipping QMod \"%s\", thread  was invalid!", qmods->at(i)->Id().data());
 			}
 		}
 	}
@@ -269,7 +345,7 @@ namespace QModUtils {
 	}
 
 	void ToggleMods(std::vector<QMod*>* qmods, std::function<void(QMod*, bool)> onToggleStart) {
-		getLogger().info("Toggling a list of QMods");
+		QLOG_INFO("Toggling a list of QMods");
 
 		std::vector<bool> actives;
 
@@ -281,33 +357,27 @@ namespace QModUtils {
 	}
 
 	void ReloadMod(QMod* qmod) {
-		getLogger().info("Reloading QMod \"%s\"", qmod->Id().c_str());
+		QLOG_INFO("Reloading QMod \"%s\"", qmod->Id().data());
 
-		qmod->Uninstall();
-		qmod->Install();
+		// Only the files that differ from the .qmod are rewritten
+		if (qmod->IsInstalled()) qmod->Reinstall();
+		else qmod->Install();
 	}
 
 	void ReloadMods(std::vector<QMod*>* qmods, std::function<void(QMod*)> onReloadStart) {
-		getLogger().info("Reloading A list of QMods");
+		TRACE_SCOPE("QModUtils", "ReloadMods");
+
+		QLOG_INFO("Reloading A list of QMods");
 
 		for (int i = 0; i < qmods->size(); i++) {
 			if (onReloadStart) onReloadStart(qmods->at(i));
 
-			std::optional<std::thread> tUninstall = qmods->at(i)->UninstallAsync();
-
-			if (tUninstall.has_value()) {
-				tUninstall.value().join();
-			} else {
-				getLogger().warning("Skipping QMod \"%s\", Uninstall thread  was invalid!", qmods->at(i)->Id().c_str());
-				continue;
-			}
-
-			std::optional<std::thread> tInstall = qmods->at(i)->InstallAsync();
+			std::optional<std::thread> tInstall = qmods->at(i)->IsInstalled() ? qmods->at(i)->ReinstallAsync() : qmods->at(i)->InstallAsync();
 
 			if (tInstall.has_value()) {
 				tInstall.value().join();
 			} else {
-				getLogger().warning("Skipping QMod \"%s\", Install thread  was invalid!", qmods->at(i)->Id().c_str());
+				QLOG_WARNING("Skipping QMod \"%s\", Install thread  was invalid!", qmods->at(i)->Id().data());
 				continue;
 			}
 		}
@@ -348,19 +418,27 @@ namespace QModUtils {
 	}
 
 	void InstallMissingCoreMods(bool restart) {
+		TRACE_SCOPE("QModUtils", "InstallMissingCoreMods");
+		Operation::Scope operation(Operation::Current().token, Operation::Priority::Background);
+
 		Init();
 		
-		getLogger().info("Installing missing/outdated core mods...");
+		QLOG_INFO("Installing missing/outdated core mods...");
 		int installCount = 0;
 
 		for (auto modInfo : *m_MissingCoreMods) {
+			if (!Operation::Checkpoint()) {
+				QLOG_INFO("Installing the missing core mods was cancelled");
+				break;
+			}
+
 			std::string id = modInfo.first;
 			CoreModInfo coreModInfo = modInfo.second;
 
 			// Sanity Check
 			if (coreModInfo.filename == "" || coreModInfo.downloadLink == "")
 			{
-				getLogger().warning("Failed to download Core Mod \"%s\", invalid data!", id.c_str());
+				QLOG_WARNING("Failed to download Core Mod \"%s\", invalid data!", id.c_str());
 				continue;
 			}
 
@@ -381,16 +459,16 @@ namespace QModUtils {
 				coreMod->SetUninstallable(false);
 				coreMod->UpdateBMBFData();
 
-				getLogger().info("Installed Core Mod \"%s\"", coreMod->Id().c_str());
-				QMod::GetCoreMods()->emplace(coreMod->Id(), coreMod);
+				QLOG_INFO("Installed Core Mod \"%s\"", coreMod->Id().data());
+				QMod::AddCoreMod(coreMod);
 
 				installCount++;
 			}
 		}
 
-		getLogger().info("Installed %i missing/outaded Core Mods!", installCount);
+		QLOG_INFO("Installed %i missing/outaded Core Mods!", installCount);
 
-		if (restart && installCount != 0) JNIUtils::RestartApp();
+		if (restart && installCount != 0) PackageInfo::RestartApp();
 	}
 
 	void CacheLoadedLibs() {
@@ -400,162 +478,158 @@ namespace QModUtils {
 	}
 
 	void CacheCoreMods() {
-		getLogger().info("Downloading the latest list of core mods...");
+		TRACE_SCOPE("QModUtils", "CacheCoreMods");
+
+		QLOG_INFO("Downloading the latest list of core mods...");
 		
 		std::string coreModsData = WebUtils::GetData("https://raw.githubusercontent.com/BMBF/resources/master/com.beatgames.beatsaber/core-mods.json");
 		bool useLocalCopy = false;
 
 		if (coreModsData == "") {
-			getLogger().warning("Failed to get the list of core mods from online, reverting to local copy...");
+			QLOG_WARNING("Failed to get the list of core mods from online, reverting to local copy...");
 			useLocalCopy = true;
 		}
 
-		rapidjson::Document coreModsDoc;
+		// Only the core mods for our game version are read, the rest of the file is skipped
+		std::vector<CoreModInfo> coreMods;
+		JsonUtils::FindResult result = JsonUtils::FindResult::Invalid;
 
-		if (!useLocalCopy && coreModsDoc.Parse(coreModsData.c_str()).HasParseError()) {
-			getLogger().warning("Failed to parse the downloaded list of core mods, reverting to local copy...");
-			useLocalCopy = true;
+		if (!useLocalCopy) {
+			result = JsonUtils::ReadCoreMods(coreModsData.c_str(), m_GameVersion, coreMods);
+
+			if (result == JsonUtils::FindResult::Invalid) {
+				QLOG_WARNING("Failed to parse the downloaded list of core mods, reverting to local copy...");
+				useLocalCopy = true;
+			}
 		}
 
 		if (useLocalCopy) {
 			// Revert to local copy of core mods
 
-			std::ifstream coreModsFile("/sdcard/BMBFData/core-mods.json");
-			std::stringstream coreModsSS;
-			coreModsSS << coreModsFile.rdbuf();
+			std::vector<char> buffer;
+			if (JsonUtils::ReadFile(Paths::CoreMods(), buffer)) result = JsonUtils::ReadCoreMods(buffer.data(), m_GameVersion, coreMods);
 
-			if (coreModsDoc.Parse(coreModsSS.str().c_str()).HasParseError()) {
-				getLogger().error("Failed to parse local list of core mods!");
+			if (result == JsonUtils::FindResult::Invalid) {
+				QLOG_ERROR("Failed to parse local list of core mods!");
 				return;
 			}
 		} else {
 			// Downloaded File looks good, lets save it as a local copy
 
-			std::ofstream localFile = std::ofstream("/sdcard/BMBFData/core-mods.json");
+			std::ofstream localFile = std::ofstream(Paths::CoreMods());
 			localFile << coreModsData;
 			localFile.close();
 		}
 
-		getLogger().info("Caching Core Mods...");
-
-		if (coreModsDoc.HasMember(m_GameVersion) && coreModsDoc[m_GameVersion].IsObject()) {
-			auto& versionInfo = coreModsDoc[m_GameVersion];
+		QLOG_INFO("Caching Core Mods...");
 
-			if (!versionInfo.HasMember("mods") || !versionInfo["mods"].IsArray()) {
-				getLogger().error("Failed to find the list of core mods");
-				return;
-			}
-
-			auto& coreModsList = versionInfo["mods"];
-
-			for (rapidjson::SizeType i = 0; i < coreModsList.Size(); i++) { // rapidjson uses SizeType instead of size_t.
-				auto& coreModInfo = coreModsList[i];
-
-				if (!coreModInfo.HasMember("id") || !coreModInfo["id"].IsString()) {
-					getLogger().warning("Error found when reading mod info, skipping...");
+		if (result == JsonUtils::FindResult::Found) {
+			for (CoreModInfo& coreModInfo : coreMods) {
+				if (coreModInfo.id == "") {
+					QLOG_WARNING("Error found when reading mod info, skipping...");
 					continue;
 				}
 
-				std::string id = coreModInfo["id"].GetString();
+				std::string id = coreModInfo.id;
 
-				QMod* coreMod = nullptr;
-				for (std::pair<std::string, QMod*> qmodPair : *QMod::GetDownloadedQMods()) {
-					if (qmodPair.first == id) {
-						coreMod = qmodPair.second;
-						break;
-					}
-				}
+				QMod* coreMod = QMod::GetDownloadedQMod(id).value_or(nullptr);
 
 				if (coreMod != nullptr) {
-					QMod::GetCoreMods()->emplace(coreMod->Id(), coreMod);
-					getLogger().info("Found Core mod \"%s\"!", id.c_str());
+					QMod::AddCoreMod(coreMod);
+					QLOG_INFO("Found Core mod \"%s\"!", id.c_str());
 
-					if (!coreModInfo.HasMember("version") || !coreModInfo["version"].IsString()) {
-						getLogger().warning("Error found when reading mod info, unable to check for update!");
+					if (coreModInfo.version == "") {
+						QLOG_WARNING("Error found when reading mod info, unable to check for update!");
 						continue;
 					}
 					
-					std::string latestVersion = coreModInfo["version"].GetString();
+					std::string latestVersion = coreModInfo.version;
 
-					if (semver::satisfies(coreMod->Version(), "<" + latestVersion)) {
-						getLogger().warning("Warning! Core mod \"%s\" is outdated! (CurrentVer: \"%s\", LatestVer: \"%s\")", id.c_str(), coreMod->Version().c_str(), latestVersion.c_str());
+					if (Semver::Satisfies(coreMod->VersionId(), Semver::InternRange("<" + latestVersion))) {
+						QLOG_WARNING("Warning! Core mod \"%s\" is outdated! (CurrentVer: \"%s\", LatestVer: \"%s\")", id.c_str(), coreMod->Version().data(), latestVersion.c_str());
 
 						m_MissingCoreMods->emplace(id, coreModInfo);
 					}
 				} else {
-					getLogger().warning("Warning! Core mod \"%s\" not found!", id.c_str());
+					QLOG_WARNING("Warning! Core mod \"%s\" not found!", id.c_str());
 
 					m_MissingCoreMods->emplace(id, coreModInfo);
 				}
 			}
 		} else {
-			getLogger().error("No Core Mods Found For This Version!");
+			QLOG_ERROR("No Core Mods Found For This Version!");
 		}
 
-		getLogger().info("Finished Caching Core Mods!");
+		QLOG_INFO("Finished Caching Core Mods!");
 	}
 
 	void CachePackageName() {
-		getLogger().info("Caching Package Name...");
-		JNIEnv* env = JNIUtils::GetJNIEnv();
-
-		jstring packageName = JNIUtils::GetPackageName(env);
-		m_PackageName = JNIUtils::ToString(packageName, env);
+		QLOG_INFO("Caching Package Name...");
+		m_PackageName = PackageInfo::Get().packageId;
 
-		getLogger().info("Got Package Name \"%s\"!", m_PackageName.c_str());
+		QLOG_INFO("Got Package Name \"%s\"!", m_PackageName.c_str());
 	}
 
 	void CacheGameVersion() {
-		getLogger().info("Caching Game Version...");
-		JNIEnv* env = JNIUtils::GetJNIEnv();
+		QLOG_INFO("Caching Game Version...");
+		m_GameVersion = PackageInfo::Get().version;
 
-		jstring gameVersion = JNIUtils::GetGameVersion(env);
-		m_GameVersion = JNIUtils::ToString(gameVersion, env);
-
-		getLogger().info("Got Game Version \"%s\"!", m_GameVersion.c_str());
+		QLOG_INFO("Got Game Version \"%s\"!", m_GameVersion.c_str());
 	}
 
 	void CacheDownloadedMods() {
-		getLogger().info("Caching Downloaded QMods...");
+		TRACE_SCOPE("QModUtils", "CacheDownloadedMods");
+
+		QLOG_INFO("Caching Downloaded QMods...");
 
-		QMod::GetDownloadedQMods()->clear();
-		std::list<std::string> fileNames = GetDirContents(m_QModPath);
+		// Frees the QMods from any previous scan, and lets this one reuse the same metadata arena
+		QMod::ClearDownloadedQMods();
 
-		for (std::string file : fileNames) {
-			std::string filePath = m_QModPath + file;
-			QMod* qmod = new QMod(filePath, false, false);
+		// The mods folder is scanned first, so the versions in it are the active ones and the store only adds inactive versions
+		for (std::string dirPath : { std::string(m_QModPath), QMod::GetStorePath() }) {
+			std::vector<FileUtils::DirEntry> qmodFiles = FileUtils::ScanDir(dirPath, ".qmod");
 
-			if (qmod->Valid()) {
-				getLogger().info("Found QMod File \"%s\"", file.c_str());
-				QMod::GetDownloadedQMods()->insert({qmod->Id(), qmod});
+			for (const FileUtils::DirEntry& file : qmodFiles) {
+				std::string filePath = dirPath + file.name;
+				QMod* qmod = new QMod(filePath, false);
+
+				if (qmod->Valid()) {
+					QLOG_INFO("Found QMod File \"%s\"", file.name.c_str());
+				} else {
+					delete qmod;
+				}
 			}
 		}
 
 		QMod::DeleteTempDir();
+		QMod::RebuildLibraryRegistry();
 
-		getLogger().info("Finished Caching Downloaded QMods!");
+		QLOG_INFO("Finished Caching Downloaded QMods! (Metadata is using %lu bytes)", QMod::GetMetadataArena()->BytesUsed());
 	}
 
 	void CacheErrorMessages() {
-		getLogger().info("Caching Error Messages...");
+		TRACE_SCOPE("QModUtils", "CacheErrorMessages");
+
+		QLOG_INFO("Caching Error Messages...");
 
 		int errorCount = 0;
-		for (std::pair<const std::string, QModUtils::QMod *> modPair : *QMod::GetDownloadedQMods()) {
-			if (!modPair.second->IsInstalled()) continue;
+		for (QMod* qmod : QMod::DownloadedQMods()) {
+			if (!qmod->IsInstalled()) continue;
 
-			for (std::string mod : modPair.second->ModFiles()) {
+			for (std::string_view mod : qmod->ModFiles()) {
 				// Thanks for Laurie for the original code snippet: https://github.com/Lauriethefish/ModList/blob/main/src/library_utils.cpp#L8-L15
-				std::string filePath = Modloader::getDestinationPath() + mod;
+				std::string filePath = Modloader::getDestinationPath() + std::string(mod);
 				
 				dlerror(); // Clear Existing Errors
+				Metrics::Add(Metrics::Counter::DlopenProbes);
 				dlopen(filePath.c_str(), RTLD_LOCAL | RTLD_NOW);
 
 				char* error = dlerror();
 
 				if (error) {
-					m_ErrorMessages->emplace(modPair.second, std::string(error).substr(15));
+					m_ErrorMessages->emplace(qmod, std::string(error).substr(15));
 
-					getLogger().warning("dlerror when dlopening \"%s\" in mod \"%s\": %s", mod.c_str(), modPair.second->Id().c_str(), error);
+					QLOG_WARNING("dlerror when dlopening \"%s\" in mod \"%s\": %s", mod.data(), qmod->Id().data(), error);
 					errorCount++;
 
 					break;
@@ -563,34 +637,50 @@ namespace QModUtils {
 			}
 		}
 
-		getLogger().info("Finished Caching Error Messages! (Found %i errors)", errorCount);
+		QLOG_INFO("Finished Caching Error Messages! (Found %i errors)", errorCount);
 	}
 
 	void CacheInstalledMods() {
-		for (std::pair<std::string, QMod*> qmodPair : *QMod::GetDownloadedQMods()) {
-			if (qmodPair.second->IsInstalled()) m_InstalledQMods->insert(qmodPair);
+		for (QMod* qmod : QMod::DownloadedQMods()) {
+			if (qmod->IsInstalled()) m_InstalledQMods->emplace(std::string(qmod->Id()), qmod);
 		}
 	}
 
 	void CacheUninstalledMods() {
-		for (std::pair<std::string, QMod*> qmodPair : *QMod::GetDownloadedQMods()) {
-			if (!qmodPair.second->IsInstalled()) m_UninstalledQMods->insert(qmodPair);
+		for (QMod* qmod : QMod::DownloadedQMods()) {
+			if (!qmod->IsInstalled()) m_UninstalledQMods->emplace(std::string(qmod->Id()), qmod);
 		}
 	}
 
 	void CacheFailedToLoadMods() {
-		for (std::pair<std::string, QMod*> qmodPair : *QMod::GetDownloadedQMods()) {
-			if (ModHasError(qmodPair.second)) m_FailedToLoadMods->insert(qmodPair);
+		for (QMod* qmod : QMod::DownloadedQMods()) {
+			if (ModHasError(qmod)) m_FailedToLoadMods->emplace(std::string(qmod->Id()), qmod);
 		}
 	}
 
-	void Init() {
+	void RefreshModLists() {
+		TRACE_SCOPE("QModUtils", "RefreshModLists");
+
+		std::unique_lock guard(m_ModListsLock);
+
+		m_InstalledQMods->clear();
+		m_UninstalledQMods->clear();
+		m_FailedToLoadMods->clear();
+
+		CacheInstalledMods();
+		CacheUninstalledMods();
+		CacheFailedToLoadMods();
+	}
+
+	void Init(bool fetchCoreMods) {
+		TRACE_SCOPE("QModUtils", "Init");
+
 		// ORDER MATTERS! DONT FUCK WITH IT!
 
 		if (m_HasInitialized) return;
 		m_HasInitialized = true;
 		
-		m_QModPath = "/sdcard/BMBFData/Mods/";
+		m_QModPath = Paths::Mods().c_str();
 
 		m_LoadedLibs = new std::vector<std::string>();
 		m_MissingCoreMods = new std::unordered_map<std::string, CoreModInfo>();
@@ -604,7 +694,8 @@ namespace QModUtils {
 
 		CacheLoadedLibs();
 		CacheDownloadedMods();
-		CacheCoreMods();
+		QMod::RecoverFromJournal();
+		if (fetchCoreMods) CacheCoreMods();
 		CacheErrorMessages();
 
 		CacheInstalledMods();
@@ -0,0 +1,490 @@
+#pragma once
+
+#include "cpp-semver/shared/cpp-semver.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace QModUtils {
+	/**
+	 * @brief Versions and ranges that are parsed once, then checked against each other by id
+	 * @details Every distinct version / range string is parsed the first time it's seen, and every (version, range) result is remembered.
+	 * After that, checking a dependency is a single hash map lookup with no string parsing.
+	 * Anything our parser doesn't understand is handed to cpp-semver instead (and the result is still remembered).
+	 */
+	namespace Semver {
+		using VersionId = uint32_t;
+		using RangeId = uint32_t;
+
+		struct Version {
+			uint64_t major = 0;
+			uint64_t minor = 0;
+			uint64_t patch = 0;
+			std::vector<std::string> prerelease;
+		};
+
+		enum class Op : uint8_t {
+			Less,
+			LessEqual,
+			Greater,
+			GreaterEqual,
+			Equal
+		};
+
+		struct Comparator {
+			Op op;
+			Version version;
+		};
+
+		// A version is in a set if it satisfies every comparator in it, and in a range if it's in any of its sets
+		using ComparatorSet = std::vector<Comparator>;
+
+		struct Range {
+			std::vector<ComparatorSet> sets;
+		};
+
+		// Declerations
+
+		/**
+		 * @brief Parses a version (if it hasn't been seen before) and returns its id
+		 */
+		inline VersionId InternVersion(std::string_view version);
+
+		/**
+		 * @brief Compiles a range (if it hasn't been seen before) and returns its id
+		 */
+		inline RangeId InternRange(std::string_view range);
+
+		/**
+		 * @brief Checks if a version is in a range. Both must have been interned first
+		 * @details The result is cached, so only the first check of each pair does any work
+		 */
+		inline bool Satisfies(VersionId version, RangeId range);
+
+		/**
+		 * @brief Parses and checks a version against a range, for one off checks
+		 */
+		inline bool Satisfies(std::string_view version, std::string_view range);
+
+		/**
+		 * @brief Parses a full version (major.minor.patch, with an optional prerelease and build)
+		 *
+		 * @return Returns false if the version isn't valid
+		 */
+		inline bool ParseVersion(std::string_view str, Version& version);
+
+		/**
+		 * @brief Compiles a range into comparator sets. Supports ||, hyphen ranges, x-ranges, ~, ^ and the comparison operators
+		 *
+		 * @return Returns false if the range uses syntax we don't support
+		 */
+		inline bool CompileRange(std::string_view str, Range& range);
+
+		inline int Compare(const Version& lhs, const Version& rhs);
+
+		/**
+		 * @brief Compares two interned versions. Versions that couldn't be parsed are compared as strings, and sort below valid ones
+		 */
+		inline int Compare(VersionId lhs, VersionId rhs);
+
+		inline bool Test(const Range& range, const Version& version);
+
+		// Internal state
+
+		struct VersionEntry {
+			std::string str;
+			Version version;
+			bool valid;
+		};
+
+		struct RangeEntry {
+			std::string str;
+			Range range;
+			bool valid;
+		};
+
+		inline std::mutex m_Lock;
+
+		inline std::vector<VersionEntry> m_Versions;
+		inline std::vector<RangeEntry> m_Ranges;
+		inline std::unordered_map<std::string, VersionId> m_VersionIds;
+		inline std::unordered_map<std::string, RangeId> m_RangeIds;
+
+		// Keyed by (version id << 32 | range id)
+		inline std::unordered_map<uint64_t, bool> m_Results;
+
+		// Definitions
+
+		inline bool IsDigit(char c) { return c >= '0' && c <= '9'; }
+		inline bool IsSpace(char c) { return c == ' ' || c == '\t' || c == '\n' || c == '\r'; }
+
+		inline std::string_view Trim(std::string_view str) {
+			while (!str.empty() && IsSpace(str.front())) str.remove_prefix(1);
+			while (!str.empty() && IsSpace(str.back())) str.remove_suffix(1);
+
+			return str;
+		}
+
+		inline bool ParseNumber(std::string_view& str, uint64_t& value) {
+			if (str.empty() || !IsDigit(str.front())) return false;
+
+			// Like node-semver, "01" isn't a number
+			if (str.front() == '0' && str.size() > 1 && IsDigit(str[1])) return false;
+
+			value = 0;
+			while (!str.empty() && IsDigit(str.front())) {
+				value = value * 10 + (str.front() - '0');
+				str.remove_prefix(1);
+			}
+
+			return true;
+		}
+
+		/**
+		 * @brief Parses dot seperated identifiers, for the prerelease and build parts of a version
+		 */
+		inline bool ParseIdentifiers(std::string_view& str, std::vector<std::string>* identifiers) {
+			while (true) {
+				size_t length = 0;
+				while (length < str.size() && (IsDigit(str[length]) || (str[length] >= 'a' && str[length] <= 'z') || (str[length] >= 'A' && str[length] <= 'Z') || str[length] == '-')) length++;
+
+				if (length == 0) return false;
+
+				// Numeric prerelease identifiers can't have leading zeros, build metadata can
+				std::string_view identifier = str.substr(0, length);
+				if (identifiers != nullptr && length > 1 && identifier.front() == '0' && std::all_of(identifier.begin(), identifier.end(), IsDigit)) return false;
+
+				if (identifiers != nullptr) identifiers->emplace_back(identifier);
+
+				str.remove_prefix(length);
+
+				if (str.empty() || str.front() != '.') return true;
+				str.remove_prefix(1);
+			}
+		}
+
+		/**
+		 * @brief A version that may be missing parts, like "1.2", "1.x" or "*"
+		 */
+		struct Partial {
+			Version version;
+			int count = 0; // How many of major / minor / patch were given
+		};
+
+		inline bool ParsePartial(std::string_view str, Partial& partial) {
+			str = Trim(str);
+
+			if (!str.empty() && (str.front() == 'v' || str.front() == 'V')) str.remove_prefix(1);
+
+			uint64_t* parts[3] = { &partial.version.major, &partial.version.minor, &partial.version.patch };
+			bool wildcard = false;
+
+			for (int i = 0; i < 3 && !str.empty(); i++) {
+				if (str.front() == 'x' || str.front() == 'X' || str.front() == '*') {
+					wildcard = true;
+					str.remove_prefix(1);
+				} else if (wildcard || !ParseNumber(str, *parts[i])) {
+					return false;
+				} else {
+					partial.count++;
+				}
+
+				if (i < 2 && !str.empty() && str.front() == '.') str.remove_prefix(1);
+				else break;
+			}
+
+			if (!str.empty() && str.front() == '-') {
+				// A prerelease only makes sense on a full version
+				str.remove_prefix(1);
+				if (partial.count != 3 || !ParseIdentifiers(str, &partial.version.prerelease)) return false;
+			}
+
+			if (!str.empty() && str.front() == '+') {
+				str.remove_prefix(1);
+				if (!ParseIdentifiers(str, nullptr)) return false;
+			}
+
+			return str.empty();
+		}
+
+		inline bool ParseVersion(std::string_view str, Version& version) {
+			Partial partial;
+			if (!ParsePartial(str, partial) || partial.count != 3) return false;
+
+			version = std::move(partial.version);
+			return true;
+		}
+
+		inline int CompareIdentifiers(const std::string& lhs, const std::string& rhs) {
+			bool lhsNumeric = !lhs.empty() && std::all_of(lhs.begin(), lhs.end(), IsDigit);
+			bool rhsNumeric = !rhs.empty() && std::all_of(rhs.begin(), rhs.end(), IsDigit);
+
+			// Numeric identifiers always have lower precedence than alphanumeric ones
+			if (lhsNumeric != rhsNumeric) return lhsNumeric ? -1 : 1;
+
+			if (lhsNumeric && lhs.size() != rhs.size()) return lhs.size() < rhs.size() ? -1 : 1;
+
+			int result = lhs.compare(rhs);
+			return result < 0 ? -1 : (result > 0 ? 1 : 0);
+		}
+
+		inline int Compare(const Version& lhs, const Version& rhs) {
+			if (lhs.major != rhs.major) return lhs.major < rhs.major ? -1 : 1;
+			if (lhs.minor != rhs.minor) return lhs.minor < rhs.minor ? -1 : 1;
+			if (lhs.patch != rhs.patch) return lhs.patch < rhs.patch ? -1 : 1;
+
+			// A version with a prerelease is lower than the same version without one
+			if (lhs.prerelease.empty() || rhs.prerelease.empty()) return (int)lhs.prerelease.empty() - (int)rhs.prerelease.empty();
+
+			for (size_t i = 0; i < lhs.prerelease.size() && i < rhs.prerelease.size(); i++) {
+				int result = CompareIdentifiers(lhs.prerelease[i], rhs.prerelease[i]);
+				if (result != 0) return result;
+			}
+
+			if (lhs.prerelease.size() == rhs.prerelease.size()) return 0;
+			return lhs.prerelease.size() < rhs.prerelease.size() ? -1 : 1;
+		}
+
+		inline Version MakeVersion(uint64_t major, uint64_t minor, uint64_t patch, bool lowestPrerelease = false) {
+			Version version { major, minor, patch, {} };
+
+			// "-0" is the lowest possible prerelease, so "<1.0.0-0" excludes every 1.0.0 prerelease
+			if (lowestPrerelease) version.prerelease.emplace_back("0");
+
+			return version;
+		}
+
+		/**
+		 * @brief Turns a single operator and (partial) version into comparators, the same way node-semver desugars them
+		 */
+		inline bool AddComparators(std::string_view op, const Partial& partial, ComparatorSet& set) {
+			const Version& v = partial.version;
+			int count = partial.count;
+
+			// Nothing satisfies this, used for things like "<*"
+			auto none = [&]() { set.push_back({ Op::Less, MakeVersion(0, 0, 0, true) }); };
+
+			// The upper bound of an x-range, ie "1.2" is "<1.3.0-0"
+			auto xRangeUpper = [&]() { return count == 1 ? MakeVersion(v.major + 1, 0, 0, true) : MakeVersion(v.major, v.minor + 1, 0, true); };
+
+			if (op == "~" || op == "~>") {
+				if (count == 0) return true;
+
+				set.push_back({ Op::GreaterEqual, v });
+				set.push_back({ Op::Less, count == 1 ? MakeVersion(v.major + 1, 0, 0, true) : MakeVersion(v.major, v.minor + 1, 0, true) });
+			} else if (op == "^") {
+				if (count == 0) return true;
+
+				set.push_back({ Op::GreaterEqual, v });
+
+				if (v.major > 0 || count == 1) set.push_back({ Op::Less, MakeVersion(v.major + 1, 0, 0, true) });
+				else if (v.minor > 0 || count == 2) set.push_back({ Op::Less, MakeVersion(0, v.minor + 1, 0, true) });
+				else set.push_back({ Op::Less, MakeVersion(0, 0, v.patch + 1, true) });
+			} else if (op == "" || op == "=") {
+				if (count == 0) return true;
+
+				if (count == 3) {
+					set.push_back({ Op::Equal, v });
+				} else {
+					set.push_back({ Op::GreaterEqual, v });
+					set.push_back({ Op::Less, xRangeUpper() });
+				}
+			} else if (op == ">") {
+				if (count == 0) none();
+				else if (count == 3) set.push_back({ Op::Greater, v });
+				else set.push_back({ Op::GreaterEqual, count == 1 ? MakeVersion(v.major + 1, 0, 0) : MakeVersion(v.major, v.minor + 1, 0) });
+			} else if (op == ">=") {
+				if (count != 0) set.push_back({ Op::GreaterEqual, v });
+			} else if (op == "<") {
+				if (count == 0) none();
+				else if (count == 3) set.push_back({ Op::Less, v });
+				else set.push_back({ Op::Less, MakeVersion(v.major, v.minor, 0, true) });
+			} else if (op == "<=") {
+				if (count == 3) set.push_back({ Op::LessEqual, v });
+				else if (count != 0) set.push_back({ Op::Less, xRangeUpper() });
+			} else {
+				return false;
+			}
+
+			return true;
+		}
+
+		inline bool IsOperatorChar(char c) {
+			return c == '<' || c == '>' || c == '=' || c == '~' || c == '^';
+		}
+
+		inline bool CompileSet(std::string_view str, ComparatorSet& set) {
+			str = Trim(str);
+
+			// Hyphen ranges, "1.2.3 - 2.3.4"
+			size_t hyphen = str.find(" - ");
+			if (hyphen != std::string_view::npos) {
+				Partial low, high;
+				if (!ParsePartial(str.substr(0, hyphen), low) || !ParsePartial(str.substr(hyphen + 3), high)) return false;
+
+				if (low.count != 0) set.push_back({ Op::GreaterEqual, low.version });
+
+				if (high.count == 3) set.push_back({ Op::LessEqual, high.version });
+				else if (high.count == 2) set.push_back({ Op::Less, MakeVersion(high.version.major, high.version.minor + 1, 0, true) });
+				else if (high.count == 1) set.push_back({ Op::Less, MakeVersion(high.version.major + 1, 0, 0, true) });
+
+				return true;
+			}
+
+			while (!str.empty()) {
+				size_t opLength = 0;
+				while (opLength < str.size() && IsOperatorChar(str[opLength])) opLength++;
+
+				std::string_view op = str.substr(0, opLength);
+				str = Trim(str.substr(opLength));
+
+				// Operators are allowed to have spaces between them and the version, like ">= 1.2.3"
+				size_t versionLength = 0;
+				while (versionLength < str.size() && !IsSpace(str[versionLength])) versionLength++;
+
+				Partial partial;
+				if (!ParsePartial(str.substr(0, versionLength), partial) || !AddComparators(op, partial, set)) return false;
+
+				str = Trim(str.substr(versionLength));
+			}
+
+			return true;
+		}
+
+		inline bool CompileRange(std::string_view str, Range& range) {
+			range.sets.clear();
+
+			while (true) {
+				size_t split = str.find("||");
+
+				if (!CompileSet(str.substr(0, split), range.sets.emplace_back())) return false;
+				if (split == std::string_view::npos) return true;
+
+				str.remove_prefix(split + 2);
+			}
+		}
+
+		inline bool TestComparator(const Comparator& comparator, const Version& version) {
+			int result = Compare(version, comparator.version);
+
+			switch (comparator.op) {
+				case Op::Less: return result < 0;
+				case Op::LessEqual: return result <= 0;
+				case Op::Greater: return result > 0;
+				case Op::GreaterEqual: return result >= 0;
+				case Op::Equal: return result == 0;
+			}
+
+			return false;
+		}
+
+		inline bool TestSet(const ComparatorSet& set, const Version& version) {
+			for (const Comparator& comparator : set) {
+				if (!TestComparator(comparator, version)) return false;
+			}
+
+			if (version.prerelease.empty()) return true;
+
+			// Prereleases only match if a comparator in the set opts in to prereleases of the same major.minor.patch
+			for (const Comparator& comparator : set) {
+				const Version& other = comparator.version;
+				if (!other.prerelease.empty() && other.major == version.major && other.minor == version.minor && other.patch == version.patch) return true;
+			}
+
+			return false;
+		}
+
+		inline bool Test(const Range& range, const Version& version) {
+			for (const ComparatorSet& set : range.sets) {
+				if (TestSet(set, version)) return true;
+			}
+
+			return false;
+		}
+
+		inline VersionId InternVersion(std::string_view version) {
+			std::unique_lock guard(m_Lock);
+
+			std::string key(version);
+
+			auto search = m_VersionIds.find(key);
+			if (search != m_VersionIds.end()) return search->second;
+
+			VersionEntry& entry = m_Versions.emplace_back();
+			entry.str = key;
+			entry.valid = ParseVersion(version, entry.version);
+
+			VersionId id = m_Versions.size() - 1;
+			m_VersionIds.emplace(std::move(key), id);
+
+			return id;
+		}
+
+		inline RangeId InternRange(std::string_view range) {
+			std::unique_lock guard(m_Lock);
+
+			std::string key(range);
+
+			auto search = m_RangeIds.find(key);
+			if (search != m_RangeIds.end()) return search->second;
+
+			RangeEntry& entry = m_Ranges.emplace_back();
+			entry.str = key;
+			entry.valid = CompileRange(range, entry.range);
+
+			RangeId id = m_Ranges.size() - 1;
+			m_RangeIds.emplace(std::move(key), id);
+
+			return id;
+		}
+
+		inline bool Satisfies(VersionId version, RangeId range) {
+			std::unique_lock guard(m_Lock);
+
+			uint64_t key = ((uint64_t)version << 32) | range;
+
+			auto search = m_Results.find(key);
+			if (search != m_Results.end()) return search->second;
+
+			const VersionEntry& versionEntry = m_Versions[version];
+			const RangeEntry& rangeEntry = m_Ranges[range];
+
+			bool result;
+			if (versionEntry.valid && rangeEntry.valid) {
+				result = Test(rangeEntry.range, versionEntry.version);
+			} else {
+				// Something we couldn't parse, let cpp-semver have a go at it
+				try {
+					result = semver::satisfies(versionEntry.str, rangeEntry.str);
+				} catch (...) {
+					result = false;
+				}
+			}
+
+			m_Results.emplace(key, result);
+			return result;
+		}
+
+		inline int Compare(VersionId lhs, VersionId rhs) {
+			std::unique_lock guard(m_Lock);
+
+			const VersionEntry& lhsEntry = m_Versions[lhs];
+			const VersionEntry& rhsEntry = m_Versions[rhs];
+
+			if (lhsEntry.valid && rhsEntry.valid) return Compare(lhsEntry.version, rhsEntry.version);
+			if (lhsEntry.valid != rhsEntry.valid) return lhsEntry.valid ? 1 : -1;
+
+			int result = lhsEntry.str.compare(rhsEntry.str);
+			return result < 0 ? -1 : (result > 0 ? 1 : 0);
+		}
+
+		inline bool Satisfies(std::string_view version, std::string_view range) {
+			return Satisfies(InternVersion(version), InternRange(range));
+		}
+	}
+}
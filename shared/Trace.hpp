@@ -0,0 +1,246 @@
+#pragma once
+
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief Traces the scope it's in as a span, like "TRACE_SCOPE("QMod", "Install");"
+ * @details Does nothing unless tracing has been turned on with Trace::SetEnabled, and TRACE_SCOPE_ARG's arg isn't even evaluated. Define QMODUTILS_NO_TRACE to compile every span out
+ */
+#ifndef QMODUTILS_NO_TRACE
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_SCOPE(category, name) QModUtils::Trace::Scope TRACE_CONCAT(t_TraceScope, __LINE__)(category, name)
+#define TRACE_SCOPE_ARG(category, name, arg) QModUtils::Trace::Scope TRACE_CONCAT(t_TraceScope, __LINE__)(category, name, QModUtils::Trace::IsEnabled() ? std::string_view(arg) : std::string_view())
+#else
+#define TRACE_SCOPE(category, name)
+#define TRACE_SCOPE_ARG(category, name, arg)
+#endif
+
+namespace QModUtils {
+	/**
+	 * @brief Spans of time spent in each part of an operation, that can be exported as a Chrome / Perfetto trace
+	 * @details Each thread writes into its own ring buffer, so recording a span only ever waits on an export that is reading it. When a buffer is full the oldest spans are overwritten.
+	 * Buffers outlive their threads, so the spans of a detached install thread are still around for the export
+	 */
+	namespace Trace {
+		struct Event {
+			const char* category; // Always a literal, so only the pointer is kept
+			const char* name;
+			char arg[56]; // A mod id or file path. Long ones lose their start, so a path keeps its file name
+
+			uint64_t start; // Nanoseconds on the steady clock
+			uint64_t duration;
+		};
+
+		struct ThreadBuffer {
+			static constexpr size_t c_Capacity = 4096;
+
+			std::mutex lock; // Only ever contended by an export
+			std::array<Event, c_Capacity> events;
+			size_t count = 0; // Every event ever written, the newest is at (count - 1) % c_Capacity
+
+			uint32_t tid;
+		};
+
+		inline std::atomic<bool> m_Enabled = false;
+
+		inline std::mutex m_BuffersLock;
+		inline std::vector<ThreadBuffer*>* m_Buffers = new std::vector<ThreadBuffer*>();
+
+		// Declerations
+
+		/**
+		 * @brief Turns recording on or off. It's off by default, in which case a span costs a single atomic load
+		 */
+		inline void SetEnabled(bool enabled);
+		inline bool IsEnabled();
+
+		/**
+		 * @brief Drops every recorded span
+		 */
+		inline void Clear();
+
+		/**
+		 * @brief Writes every recorded span to a file, in the Chrome trace event format
+		 * @details The file can be opened in chrome://tracing or ui.perfetto.dev
+		 *
+		 * @return Returns false if the file couldn't be written
+		 */
+		inline bool ExportChrome(const std::string& path);
+
+		/**
+		 * @brief Same as ExportChrome, but returns the JSON instead of writing it out
+		 */
+		inline std::string ToChromeJson();
+
+		// Definitions
+
+		inline uint64_t Now() {
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+		}
+
+		inline ThreadBuffer& GetThreadBuffer() {
+			thread_local ThreadBuffer* buffer = nullptr;
+
+			if (buffer == nullptr) {
+				buffer = new ThreadBuffer();
+				buffer->tid = (uint32_t)syscall(SYS_gettid);
+
+				std::unique_lock lock(m_BuffersLock);
+				m_Buffers->push_back(buffer);
+			}
+
+			return *buffer;
+		}
+
+		inline void Record(const char* category, const char* name, const char* arg, uint64_t start, uint64_t end) {
+			ThreadBuffer& buffer = GetThreadBuffer();
+			std::unique_lock lock(buffer.lock);
+
+			Event& event = buffer.events[buffer.count % ThreadBuffer::c_Capacity];
+			event.category = category;
+			event.name = name;
+			event.start = start;
+			event.duration = end - start;
+			memcpy(event.arg, arg, sizeof(event.arg));
+
+			buffer.count++;
+		}
+
+		/**
+		 * @brief Records the time between its construction and destruction as a span. Use TRACE_SCOPE instead of making these directly
+		 */
+		class Scope {
+		public:
+			Scope(const char* category, const char* name, std::string_view arg = "") {
+				if (!m_Enabled.load(std::memory_order_relaxed)) return;
+
+				m_Category = category;
+				m_Name = name;
+
+				// Copied now, as the arg is often a temporary
+				size_t length = std::min(arg.size(), sizeof(m_Arg) - 1);
+				memcpy(m_Arg, arg.data() + arg.size() - length, length);
+				m_Arg[length] = '\0';
+
+				m_Start = Now();
+			}
+
+			~Scope() {
+				if (m_Category != nullptr) Record(m_Category, m_Name, m_Arg, m_Start, Now());
+			}
+
+			Scope(const Scope&) = delete;
+			Scope& operator=(const Scope&) = delete;
+
+		private:
+			const char* m_Category = nullptr;
+			const char* m_Name = nullptr;
+			char m_Arg[sizeof(Event::arg)];
+			uint64_t m_Start = 0;
+		};
+
+		void SetEnabled(bool enabled) {
+			m_Enabled.store(enabled, std::memory_order_relaxed);
+		}
+
+		bool IsEnabled() {
+			return m_Enabled.load(std::memory_order_relaxed);
+		}
+
+		void Clear() {
+			std::unique_lock lock(m_BuffersLock);
+
+			for (ThreadBuffer* buffer : *m_Buffers) {
+				std::unique_lock bufferLock(buffer->lock);
+				buffer->count = 0;
+			}
+		}
+
+		inline void AppendJsonString(std::string& out, const char* str) {
+			out += '"';
+
+			for (; *str != '\0'; str++) {
+				char c = *str;
+
+				if (c == '"' || c == '\\') {
+					out += '\\';
+					out += c;
+				} else if ((unsigned char)c < 0x20) {
+					char escaped[8];
+					snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+					out += escaped;
+				} else {
+					out += c;
+				}
+			}
+
+			out += '"';
+		}
+
+		std::string ToChromeJson() {
+			std::string out = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+			bool first = true;
+			char number[96];
+
+			std::unique_lock lock(m_BuffersLock);
+
+			for (ThreadBuffer* buffer : *m_Buffers) {
+				std::unique_lock bufferLock(buffer->lock);
+
+				size_t count = std::min(buffer->count, ThreadBuffer::c_Capacity);
+				size_t begin = buffer->count - count;
+
+				for (size_t i = begin; i < buffer->count; i++) {
+					const Event& event = buffer->events[i % ThreadBuffer::c_Capacity];
+
+					if (!first) out += ',';
+					first = false;
+
+					// Chrome wants microseconds, the fraction keeps nanosecond precision
+					out += "{\"ph\":\"X\",\"cat\":";
+					AppendJsonString(out, event.category);
+					out += ",\"name\":";
+					AppendJsonString(out, event.name);
+
+					snprintf(number, sizeof(number), ",\"pid\":%i,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f", (int)getpid(), buffer->tid, event.start / 1000.0, event.duration / 1000.0);
+					out += number;
+
+					if (event.arg[0] != '\0') {
+						out += ",\"args\":{\"arg\":";
+						AppendJsonString(out, event.arg);
+						out += '}';
+					}
+
+					out += '}';
+				}
+			}
+
+			out += "]}";
+			return out;
+		}
+
+		bool ExportChrome(const std::string& path) {
+			std::string json = ToChromeJson();
+
+			FILE* file = fopen(path.c_str(), "wb");
+			if (file == nullptr) return false;
+
+			bool written = fwrite(json.data(), 1, json.size(), file) == json.size();
+			return fclose(file) == 0 && written;
+		}
+	}
+}
@@ -1,8 +1,11 @@
 #pragma once
 
+#include "qmod-utils/shared/Types/FieldDescriptors.hpp"
+
 #include "beatsaber-hook/shared/rapidjson/include/rapidjson/document.h"
 
 #include <string>
+#include <string_view>
 #include <optional>
 
 namespace QModUtils {
@@ -12,20 +15,31 @@ namespace QModUtils {
 		std::string downloadLink;
 		std::string filename;
 
-		CoreModInfo(const rapidjson::Value& info) {
-			if (!info.IsObject()) return;
+		CoreModInfo() = default;
+		CoreModInfo(const rapidjson::Value& info);
 
-			if (info.HasMember("id") && info["id"].IsString()) id = info["id"].GetString();
-			else id = "";
+		/**
+		 * @brief Sets a field by its name in "core-mods.json", used when reading the file with a SAX handler
+		 */
+		void SetField(std::string_view name, std::string_view value);
+	};
 
-			if (info.HasMember("version") && info["version"].IsString()) version = info["version"].GetString();
-			else version = "";
+	template<>
+	struct Fields::FieldTable<CoreModInfo> {
+		static constexpr std::array<FieldDescriptor<CoreModInfo>, 4> fields = {
+			String<CoreModInfo, &CoreModInfo::id>("id"),
+			String<CoreModInfo, &CoreModInfo::version>("version"),
+			String<CoreModInfo, &CoreModInfo::downloadLink>("downloadLink"),
+			String<CoreModInfo, &CoreModInfo::filename>("filename")
+		};
+	};
 
-			if (info.HasMember("downloadLink") && info["downloadLink"].IsString()) downloadLink = info["downloadLink"].GetString();
-			else downloadLink = "";
+	inline CoreModInfo::CoreModInfo(const rapidjson::Value& info) {
+		Fields::ReadObject<Fields::FieldTable<CoreModInfo>::fields>(*this, info);
+	}
 
-			if (info.HasMember("filename") && info["filename"].IsString()) filename = info["filename"].GetString();
-			else filename = "";
-		}
-	};
-}
\ No newline at end of file
+	inline void CoreModInfo::SetField(std::string_view name, std::string_view value) {
+		// Doesn't copy the string, the value just points at it
+		Fields::ReadField<Fields::FieldTable<CoreModInfo>::fields>(*this, name, rapidjson::Value(value.data(), (rapidjson::SizeType)value.size()));
+	}
+}
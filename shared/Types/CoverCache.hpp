@@ -0,0 +1,280 @@
+#pragma once
+
+#include "qmod-utils/shared/FileUtils.hpp"
+#include "qmod-utils/shared/ZipUtils.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace QModUtils {
+	/**
+	 * @brief Keeps every mod's cover image in a single packed file, keyed by the hash of the QMod it came from
+	 * @details The pack is an append-only list of records, each one a header followed by the image. It's memory mapped as a whole,
+	 * so a mod list can show every cover after a single open and mmap. When a key is written twice, the last record wins.
+	 * Views returned by Get stay valid until the cache is compacted, as mappings are only ever added to when the pack grows.
+	 */
+	class CoverCache {
+	public:
+		explicit CoverCache(std::string path) : m_Path(std::move(path)) {}
+
+		CoverCache(const CoverCache&) = delete;
+		CoverCache& operator=(const CoverCache&) = delete;
+
+		~CoverCache()
+		{
+			UnmapAll();
+		}
+
+		/**
+		 * @brief Gets a cover image from the pack
+		 *
+		 * @return Returns an empty view if there is no cover with this key
+		 */
+		std::string_view Get(uint64_t key)
+		{
+			std::unique_lock guard(m_Lock);
+			LoadUnlocked();
+
+			auto search = m_Index.find(key);
+			if (search == m_Index.end())
+				return "";
+
+			// The record was appended after the pack was mapped
+			if (search->second.first + search->second.second > m_MappedSize && !MapUnlocked())
+				return "";
+
+			return std::string_view((const char *)m_Mappings.back().first + search->second.first, search->second.second);
+		}
+
+		bool Contains(uint64_t key)
+		{
+			std::unique_lock guard(m_Lock);
+			LoadUnlocked();
+
+			return m_Index.contains(key);
+		}
+
+		/**
+		 * @brief Appends a cover image to the pack
+		 *
+		 * @return Returns false if the pack couldn't be written to
+		 */
+		bool Put(uint64_t key, std::string_view data)
+		{
+			std::unique_lock guard(m_Lock);
+			LoadUnlocked();
+
+			FileUtils::ScopedFd fd(open(m_Path.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0666));
+			if (fd < 0)
+				return false;
+
+			RecordHeader header = {c_Magic, (uint32_t)data.size(), key, ZipUtils::Crc32(data.data(), data.size()), 0};
+
+			if (!WriteAt(fd, &header, sizeof(header), m_FileSize) || !WriteAt(fd, data.data(), data.size(), m_FileSize + sizeof(header)))
+			{
+				// Drop the torn record, so the next one goes where it was
+				ftruncate(fd, m_FileSize);
+				return false;
+			}
+
+			m_Index[key] = {m_FileSize + sizeof(header), data.size()};
+			m_FileSize += sizeof(header) + data.size();
+
+			return true;
+		}
+
+		/**
+		 * @brief Rewrites the pack with only the covers that are still used, dropping replaced and orphaned ones
+		 * @details Every view from Get is invalid after this!
+		 *
+		 * @param liveKeys The keys of every QMod that is still around
+		 * @return The number of bytes freed
+		 */
+		size_t Compact(const std::unordered_set<uint64_t> &liveKeys)
+		{
+			std::unique_lock guard(m_Lock);
+			LoadUnlocked();
+
+			if (!MapUnlocked())
+				return 0;
+
+			std::string tmpPath = m_Path + ".tmp";
+			FileUtils::ScopedFd fd(open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666));
+			if (fd < 0)
+				return 0;
+
+			const uint8_t *data = m_Mappings.back().first;
+			std::unordered_map<uint64_t, std::pair<size_t, size_t>> index;
+			size_t size = 0;
+
+			for (auto &pair : m_Index)
+			{
+				if (!liveKeys.contains(pair.first))
+					continue;
+
+				const RecordHeader *header = (const RecordHeader *)(data + pair.second.first - sizeof(RecordHeader));
+				if (!WriteAt(fd, header, sizeof(RecordHeader) + pair.second.second, size))
+				{
+					unlink(tmpPath.c_str());
+					return 0;
+				}
+
+				index[pair.first] = {size + sizeof(RecordHeader), pair.second.second};
+				size += sizeof(RecordHeader) + pair.second.second;
+			}
+
+			if (rename(tmpPath.c_str(), m_Path.c_str()) != 0)
+			{
+				unlink(tmpPath.c_str());
+				return 0;
+			}
+
+			size_t freed = m_FileSize - size;
+
+			UnmapAll();
+			m_Index = std::move(index);
+			m_FileSize = size;
+
+			return freed;
+		}
+
+	private:
+		struct RecordHeader
+		{
+			uint32_t magic;
+			uint32_t size;
+			uint64_t key;
+			uint32_t crc32;
+			uint32_t reserved;
+		};
+
+		static constexpr uint32_t c_Magic = 0x52564351; // "QCVR"
+
+		std::mutex m_Lock;
+		std::string m_Path;
+		bool m_Loaded = false;
+
+		// Key -> offset of the image in the pack, and its size
+		std::unordered_map<uint64_t, std::pair<size_t, size_t>> m_Index;
+		size_t m_FileSize = 0;
+
+		// Every mapping made of the pack, the newest is the largest
+		std::vector<std::pair<const uint8_t *, size_t>> m_Mappings;
+		size_t m_MappedSize = 0;
+
+		static bool WriteAt(int fd, const void *data, size_t size, size_t offset)
+		{
+			const uint8_t *bytes = (const uint8_t *)data;
+
+			while (size > 0)
+			{
+				ssize_t len = pwrite(fd, bytes, size, offset);
+
+				if (len < 0 && errno == EINTR)
+					continue;
+				if (len <= 0)
+					return false;
+
+				bytes += len;
+				size -= len;
+				offset += len;
+			}
+
+			return true;
+		}
+
+		/**
+		 * @brief Maps the whole pack. Older mappings are kept, so views into them stay valid
+		 */
+		bool MapUnlocked()
+		{
+			if (m_FileSize == m_MappedSize && !m_Mappings.empty())
+				return true;
+
+			if (m_FileSize == 0)
+				return false;
+
+			FileUtils::ScopedFd fd(open(m_Path.c_str(), O_RDONLY | O_CLOEXEC));
+			if (fd < 0)
+				return false;
+
+			void *mapping = mmap(nullptr, m_FileSize, PROT_READ, MAP_SHARED, fd, 0);
+			if (mapping == MAP_FAILED)
+				return false;
+
+			m_Mappings.push_back({(const uint8_t *)mapping, m_FileSize});
+			m_MappedSize = m_FileSize;
+
+			return true;
+		}
+
+		void UnmapAll()
+		{
+			for (auto &mapping : m_Mappings)
+				munmap((void *)mapping.first, mapping.second);
+
+			m_Mappings.clear();
+			m_MappedSize = 0;
+		}
+
+		/**
+		 * @brief Builds the index by walking the record headers. Anything after the first bad record (like one torn by a crash) is cut off
+		 * @details Only the last record's CRC-32 is checked, as that's the only one an interrupted append can leave half written. This way loading the index only reads the headers
+		 */
+		void LoadUnlocked()
+		{
+			if (m_Loaded)
+				return;
+
+			m_Loaded = true;
+
+			struct stat st;
+			if (stat(m_Path.c_str(), &st) != 0 || st.st_size == 0)
+				return;
+
+			m_FileSize = st.st_size;
+			if (!MapUnlocked())
+			{
+				m_FileSize = 0;
+				return;
+			}
+
+			const uint8_t *data = m_Mappings.back().first;
+			size_t offset = 0;
+
+			while (offset + sizeof(RecordHeader) <= m_FileSize)
+			{
+				RecordHeader header;
+				memcpy(&header, data + offset, sizeof(header));
+
+				size_t imageOffset = offset + sizeof(RecordHeader);
+				if (header.magic != c_Magic || header.size > m_FileSize - imageOffset)
+					break;
+
+				if (imageOffset + header.size == m_FileSize && ZipUtils::Crc32(data + imageOffset, header.size) != header.crc32)
+					break;
+
+				m_Index[header.key] = {imageOffset, header.size};
+				offset = imageOffset + header.size;
+			}
+
+			if (offset != m_FileSize)
+			{
+				truncate(m_Path.c_str(), offset);
+				m_FileSize = offset;
+			}
+		}
+	};
+}
@@ -1,11 +1,17 @@
 #pragma once
 
-#include <string>
+#include "qmod-utils/shared/Semver.hpp"
+
+#include <string_view>
 
 namespace QModUtils {
+	// The strings point into the QMod metadata arena, and are always null terminated
 	struct Dependency {
-		std::string id;
-		std::string version;
-		std::string downloadIfMissing;
+		std::string_view id = "";
+		std::string_view version = "";
+		std::string_view downloadIfMissing = "";
+
+		// The version range, compiled when the manifest is loaded
+		Semver::RangeId versionRange = 0;
 	};
 }
\ No newline at end of file
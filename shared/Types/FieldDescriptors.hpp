@@ -0,0 +1,300 @@
+#pragma once
+
+#include "qmod-utils/shared/Types/MetadataArena.hpp"
+#include "qmod-utils/shared/Types/Dependency.hpp"
+#include "qmod-utils/shared/Types/FileCopy.hpp"
+
+#include "beatsaber-hook/shared/rapidjson/include/rapidjson/document.h"
+#include "beatsaber-hook/shared/rapidjson/include/rapidjson/writer.h"
+#include "beatsaber-hook/shared/rapidjson/include/rapidjson/stringbuffer.h"
+
+#include <array>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace QModUtils {
+	namespace Fields {
+		using JsonWriter = rapidjson::Writer<rapidjson::StringBuffer>;
+
+		/**
+		 * @brief FNV-1a hash of a JSON key, usable at compile time so every field's hash is a constant
+		 */
+		constexpr uint32_t HashKey(std::string_view key) {
+			uint32_t hash = 2166136261u;
+
+			for (char c : key) {
+				hash ^= (uint8_t)c;
+				hash *= 16777619u;
+			}
+
+			return hash;
+		}
+
+		/**
+		 * @brief Describes how a single JSON member maps onto a C++ object
+		 * @details Either function can be null, if the field is only ever read or only ever written
+		 */
+		template<typename T>
+		struct FieldDescriptor {
+			std::string_view name;
+			uint32_t hash;
+
+			void (*read)(T& object, const rapidjson::Value& value, MetadataArena* arena);
+			void (*write)(const T& object, JsonWriter& writer);
+		};
+
+		/**
+		 * @brief Specialise this with a "static constexpr std::array<FieldDescriptor<T>, N> fields" to give a type its default JSON layout
+		 * @details Types that are written in more than one layout (like QMod's mod.json and BMBF entry) can add more tables to their specialisation
+		 */
+		template<typename T>
+		struct FieldTable;
+
+		// Field helpers, these build descriptors from a member pointer
+
+		inline std::string_view ToView(const rapidjson::Value& value) {
+			return std::string_view(value.GetString(), value.GetStringLength());
+		}
+
+		/**
+		 * @brief A string stored in the metadata arena, optionally interned
+		 */
+		template<typename T, auto Member, bool Intern = false>
+		constexpr FieldDescriptor<T> ArenaString(std::string_view name) {
+			return {
+				name, HashKey(name),
+				[](T& object, const rapidjson::Value& value, MetadataArena* arena) {
+					if (!value.IsString()) return;
+					object.*Member = Intern ? arena->Intern(ToView(value)) : arena->Store(ToView(value));
+				},
+				nullptr
+			};
+		}
+
+		/**
+		 * @brief A plain std::string
+		 */
+		template<typename T, auto Member>
+		constexpr FieldDescriptor<T> String(std::string_view name) {
+			return {
+				name, HashKey(name),
+				[](T& object, const rapidjson::Value& value, MetadataArena*) {
+					if (value.IsString()) object.*Member = ToView(value);
+				},
+				[](const T& object, JsonWriter& writer) {
+					std::string_view str = object.*Member;
+					writer.String(str.data(), str.size());
+				}
+			};
+		}
+
+		template<typename T, auto Member>
+		constexpr FieldDescriptor<T> Bool(std::string_view name) {
+			return {
+				name, HashKey(name),
+				[](T& object, const rapidjson::Value& value, MetadataArena*) {
+					if (value.IsBool()) object.*Member = value.GetBool();
+				},
+				[](const T& object, JsonWriter& writer) {
+					writer.Bool(object.*Member);
+				}
+			};
+		}
+
+		/**
+		 * @brief A value that is only written, and is computed from the object instead of read from a member
+		 */
+		template<typename T>
+		constexpr FieldDescriptor<T> Computed(std::string_view name, void (*write)(const T& object, JsonWriter& writer)) {
+			return { name, HashKey(name), nullptr, write };
+		}
+
+		/**
+		 * @brief Writes a string, or null if it is empty (which is what BMBF does)
+		 */
+		template<typename T, auto Member>
+		constexpr FieldDescriptor<T> StringOrNull(std::string_view name) {
+			return {
+				name, HashKey(name),
+				nullptr,
+				[](const T& object, JsonWriter& writer) {
+					std::string_view str = object.*Member;
+
+					if (str.empty()) writer.Null();
+					else writer.String(str.data(), str.size());
+				}
+			};
+		}
+
+		/**
+		 * @brief An array of strings, stored as a flat span of interned strings in the metadata arena
+		 */
+		template<typename T, auto Member>
+		constexpr FieldDescriptor<T> ArenaStringArray(std::string_view name) {
+			return {
+				name, HashKey(name),
+				[](T& object, const rapidjson::Value& value, MetadataArena* arena) {
+					if (!value.IsArray()) return;
+
+					size_t count = 0;
+					for (auto it = value.Begin(); it != value.End(); ++it) {
+						if (it->IsString()) count++;
+					}
+
+					std::span<std::string_view> strings = arena->AllocArray<std::string_view>(count);
+
+					count = 0;
+					for (auto it = value.Begin(); it != value.End(); ++it) {
+						if (it->IsString()) strings[count++] = arena->Intern(ToView(*it));
+					}
+
+					object.*Member = strings;
+				},
+				nullptr
+			};
+		}
+
+		template<const auto& Table, typename T>
+		inline void ReadObject(T& object, const rapidjson::Value& value, MetadataArena* arena = nullptr);
+
+		/**
+		 * @brief An array of objects that have their own FieldTable, stored as a flat span in the metadata arena
+		 */
+		template<typename T, auto Member, typename U>
+		constexpr FieldDescriptor<T> ArenaObjectArray(std::string_view name) {
+			return {
+				name, HashKey(name),
+				[](T& object, const rapidjson::Value& value, MetadataArena* arena) {
+					if (!value.IsArray()) return;
+
+					size_t count = 0;
+					for (auto it = value.Begin(); it != value.End(); ++it) {
+						if (it->IsObject()) count++;
+					}
+
+					std::span<U> items = arena->AllocArray<U>(count);
+
+					count = 0;
+					for (auto it = value.Begin(); it != value.End(); ++it) {
+						if (it->IsObject()) ReadObject<FieldTable<U>::fields>(items[count++], *it, arena);
+					}
+
+					object.*Member = items;
+				},
+				nullptr
+			};
+		}
+
+		// Dispatch
+
+		/**
+		 * @brief Reads a single member into an object, by matching its key against the type's field table
+		 * @details The fold expands to one comparison per field against a compile time constant hash, which the compiler lowers like a switch.
+		 * The name is only compared once the hash matches, to rule out collisions
+		 *
+		 * @return Returns false if the key isn't in the field table
+		 */
+		template<const auto& Table, typename T>
+		inline bool ReadField(T& object, std::string_view key, const rapidjson::Value& value, MetadataArena* arena = nullptr) {
+			constexpr auto& fields = Table;
+			uint32_t hash = HashKey(key);
+
+			return [&]<size_t... I>(std::index_sequence<I...>) {
+				return ((fields[I].read != nullptr && hash == fields[I].hash && key == fields[I].name && (fields[I].read(object, value, arena), true)) || ...);
+			}(std::make_index_sequence<fields.size()>());
+		}
+
+		/**
+		 * @brief Reads every known member of a JSON object into a C++ object, in a single pass over the object's members
+		 */
+		template<const auto& Table, typename T>
+		inline void ReadObject(T& object, const rapidjson::Value& value, MetadataArena* arena) {
+			if (!value.IsObject()) return;
+
+			for (auto it = value.MemberBegin(); it != value.MemberEnd(); ++it) {
+				ReadField<Table>(object, ToView(it->name), it->value, arena);
+			}
+		}
+
+		/**
+		 * @brief Writes an object straight to a Writer, without building a DOM first
+		 */
+		template<const auto& Table, typename T>
+		inline void WriteObject(const T& object, JsonWriter& writer) {
+			writer.StartObject();
+
+			for (const FieldDescriptor<T>& field : Table) {
+				if (field.write == nullptr) continue;
+
+				writer.Key(field.name.data(), field.name.size());
+				field.write(object, writer);
+			}
+
+			writer.EndObject();
+		}
+
+		/**
+		 * @brief Writes an object in place of an existing JSON object, keeping the existing members that aren't in the field table
+		 * @details Members keep their order, and the fields the existing object didn't have go at the end. Keys written by something newer than this table are carried through untouched
+		 */
+		template<const auto& Table, typename T>
+		inline void WriteObjectOver(const T& object, const rapidjson::Value& existing, JsonWriter& writer) {
+			constexpr auto& fields = Table;
+			std::array<bool, fields.size()> written = {};
+
+			writer.StartObject();
+
+			for (auto it = existing.MemberBegin(); it != existing.MemberEnd(); ++it) {
+				std::string_view key = ToView(it->name);
+				uint32_t hash = HashKey(key);
+
+				size_t index = 0;
+				while (index < fields.size() && (fields[index].write == nullptr || hash != fields[index].hash || key != fields[index].name)) index++;
+
+				// A duplicate of a field that's already been written would just be overwritten by it
+				if (index < fields.size() && written[index]) continue;
+
+				writer.Key(it->name.GetString(), it->name.GetStringLength());
+
+				if (index == fields.size()) {
+					it->value.Accept(writer);
+					continue;
+				}
+
+				fields[index].write(object, writer);
+				written[index] = true;
+			}
+
+			for (size_t i = 0; i < fields.size(); i++) {
+				if (fields[i].write == nullptr || written[i]) continue;
+
+				writer.Key(fields[i].name.data(), fields[i].name.size());
+				fields[i].write(object, writer);
+			}
+
+			writer.EndObject();
+		}
+
+		// Field tables for the simple types
+
+		template<>
+		struct FieldTable<Dependency> {
+			static constexpr std::array<FieldDescriptor<Dependency>, 3> fields = {
+				ArenaString<Dependency, &Dependency::id, true>("id"),
+				ArenaString<Dependency, &Dependency::version, true>("version"),
+				ArenaString<Dependency, &Dependency::downloadIfMissing, true>("downloadIfMissing")
+			};
+		};
+
+		template<>
+		struct FieldTable<FileCopy> {
+			static constexpr std::array<FieldDescriptor<FileCopy>, 2> fields = {
+				ArenaString<FileCopy, &FileCopy::name>("name"),
+				ArenaString<FileCopy, &FileCopy::destination>("destination")
+			};
+		};
+	}
+}
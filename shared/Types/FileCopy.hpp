@@ -1,10 +1,11 @@
 #pragma once
 
-#include <string>
+#include <string_view>
 
 namespace QModUtils {
+	// The strings point into the QMod metadata arena, and are always null terminated
 	struct FileCopy {
-		std::string name;
-		std::string destination;
+		std::string_view name = "";
+		std::string_view destination = "";
 	};
 }
\ No newline at end of file
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <cstdint>
+
+namespace QModUtils {
+	/**
+	 * @brief How a QMod's files are put in place when it's installed
+	 */
+	enum class InstallMode : uint8_t {
+		Extract,	// Extract the files to a temp folder and move them into place, then delete them again on uninstall
+		Linked		// Keep an unpacked copy of the QMod in a store, and link (or move) the files into place from there
+	};
+}
@@ -0,0 +1,170 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <span>
+#include <string_view>
+#include <type_traits>
+#include <unordered_set>
+#include <vector>
+
+namespace QModUtils {
+	/**
+	 * @brief Bump allocator that holds the manifest data for every QMod in the registry
+	 * @details Strings are stored null terminated, so views into the arena can be passed straight to printf style functions.
+	 * Nothing is freed individually, instead the whole arena is reset when the mods are rescanned and its chunks are reused.
+	 */
+	class MetadataArena {
+	public:
+		static constexpr size_t ChunkSize = 16 * 1024;
+
+		MetadataArena() = default;
+		MetadataArena(const MetadataArena&) = delete;
+		MetadataArena& operator=(const MetadataArena&) = delete;
+
+		/**
+		 * @brief Copies a string into the arena
+		 */
+		std::string_view Store(std::string_view str)
+		{
+			std::unique_lock guard(m_Lock);
+			return StoreUnlocked(str);
+		}
+
+		/**
+		 * @brief Copies a string into the arena, unless an identical string has already been interned
+		 * @details Use this for values that repeat across mods, like package ids, authors and dependency ids
+		 */
+		std::string_view Intern(std::string_view str)
+		{
+			std::unique_lock guard(m_Lock);
+
+			auto search = m_Interned.find(str);
+			if (search != m_Interned.end())
+				return *search;
+
+			std::string_view stored = StoreUnlocked(str);
+			m_Interned.insert(stored);
+
+			return stored;
+		}
+
+		/**
+		 * @brief Allocates a flat, default constructed array in the arena
+		 * @details Only trivially destructible types can be stored, as the arena never runs destructors
+		 */
+		template <typename T>
+		std::span<T> AllocArray(size_t count)
+		{
+			static_assert(std::is_trivially_destructible_v<T>, "The metadata arena never runs destructors");
+
+			if (count == 0)
+				return {};
+
+			std::unique_lock guard(m_Lock);
+
+			T *items = (T *)Allocate(sizeof(T) * count, alignof(T));
+			for (size_t i = 0; i < count; i++)
+				new (&items[i]) T();
+
+			return std::span<T>(items, count);
+		}
+
+		/**
+		 * @brief Throws away everything in the arena, but keeps the memory around for the next scan
+		 * @details Every view into the arena is invalid after this!
+		 */
+		void Reset()
+		{
+			std::unique_lock guard(m_Lock);
+
+			m_Interned.clear();
+			m_ChunkIndex = 0;
+			m_Offset = 0;
+			m_BytesUsed = 0;
+		}
+
+		/**
+		 * @brief Returns the number of bytes handed out since the last reset
+		 */
+		size_t BytesUsed()
+		{
+			std::unique_lock guard(m_Lock);
+			return m_BytesUsed;
+		}
+
+		/**
+		 * @brief Returns the number of bytes the arena has reserved
+		 */
+		size_t BytesReserved()
+		{
+			std::unique_lock guard(m_Lock);
+
+			size_t reserved = 0;
+			for (const Chunk &chunk : m_Chunks)
+				reserved += chunk.capacity;
+
+			return reserved;
+		}
+
+	private:
+		struct Chunk
+		{
+			std::unique_ptr<char[]> data;
+			size_t capacity;
+		};
+
+		std::string_view StoreUnlocked(std::string_view str)
+		{
+			char *data = (char *)Allocate(str.size() + 1, 1);
+
+			memcpy(data, str.data(), str.size());
+			data[str.size()] = '\0';
+
+			return std::string_view(data, str.size());
+		}
+
+		void *Allocate(size_t size, size_t align)
+		{
+			while (m_ChunkIndex < m_Chunks.size())
+			{
+				Chunk &chunk = m_Chunks[m_ChunkIndex];
+				size_t offset = (m_Offset + align - 1) & ~(align - 1);
+
+				if (offset + size <= chunk.capacity)
+				{
+					m_Offset = offset + size;
+					m_BytesUsed += size;
+
+					return chunk.data.get() + offset;
+				}
+
+				// This chunk is full (or too small), move on to the next one we already have before allocating a new one
+				m_ChunkIndex++;
+				m_Offset = 0;
+			}
+
+			size_t capacity = std::max(ChunkSize, size);
+			m_Chunks.push_back({std::make_unique<char[]>(capacity), capacity});
+
+			m_ChunkIndex = m_Chunks.size() - 1;
+			m_Offset = size;
+			m_BytesUsed += size;
+
+			return m_Chunks.back().data.get();
+		}
+
+		std::mutex m_Lock;
+
+		std::vector<Chunk> m_Chunks;
+		size_t m_ChunkIndex = 0;
+		size_t m_Offset = 0;
+		size_t m_BytesUsed = 0;
+
+		std::unordered_set<std::string_view> m_Interned;
+	};
+}
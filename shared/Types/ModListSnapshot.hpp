@@ -0,0 +1,76 @@
+#pragma once
+
+#include "qmod-utils/shared/Types/ModState.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <span>
+#include <string_view>
+
+namespace QModUtils {
+	class QMod;
+
+	/**
+	 * @brief A struct-of-arrays copy of the info a mod list needs to draw its rows
+	 * @details All of the arrays share one allocation, which is only grown when there are more mods than before.
+	 * Keep a snapshot around and refill it every frame to draw the list without allocating.
+	 * The views point into the QMod metadata arena, so they're only valid until the mods are rescanned.
+	 */
+	struct ModListSnapshot {
+		enum Flags : uint8_t {
+			None = 0,
+			Uninstallable = 1 << 0,
+			Library = 1 << 1,
+			CoreMod = 1 << 2,
+			HasError = 1 << 3
+		};
+
+		// Only the first "count" entries of each array are filled, the rest is spare capacity
+		size_t count = 0;
+
+		std::span<QMod*> mods;
+		std::span<std::string_view> ids;
+		std::span<std::string_view> names;
+		std::span<std::string_view> versions;
+		std::span<ModState> states;
+		std::span<uint8_t> flags;
+
+		/**
+		 * @brief Makes sure the snapshot can hold at least this many mods, reallocating only if it can't already
+		 */
+		void Reserve(size_t size) {
+			if (size <= m_Capacity) return;
+
+			// Largest alignment first, so every array after it stays aligned
+			size_t bytes = size * (sizeof(QMod*) + sizeof(std::string_view) * 3 + sizeof(ModState) + sizeof(uint8_t));
+			m_Storage = std::make_unique<std::byte[]>(bytes);
+			m_Capacity = size;
+
+			std::byte* ptr = m_Storage.get();
+
+			mods = Carve<QMod*>(ptr, size);
+			ids = Carve<std::string_view>(ptr, size);
+			names = Carve<std::string_view>(ptr, size);
+			versions = Carve<std::string_view>(ptr, size);
+			states = Carve<ModState>(ptr, size);
+			flags = Carve<uint8_t>(ptr, size);
+		}
+
+		bool HasFlag(size_t index, Flags flag) const { return (flags[index] & flag) != 0; }
+
+	private:
+		template<typename T>
+		static std::span<T> Carve(std::byte*& ptr, size_t size) {
+			T* items = (T*)ptr;
+			std::uninitialized_value_construct_n(items, size);
+
+			ptr += sizeof(T) * size;
+			return std::span<T>(items, size);
+		}
+
+		std::unique_ptr<std::byte[]> m_Storage;
+		size_t m_Capacity = 0;
+	};
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+
+namespace QModUtils {
+	/**
+	 * @brief The lifecycle state of a QMod
+	 * @details Transitions are done with a compare-and-swap, so only one install / uninstall can own a mod at a time
+	 */
+	enum class ModState : uint8_t {
+		Downloaded,		// The .qmod is on disk, but none of its files are in place
+		Installing,		// An install thread owns the mod
+		Installed,		// All of the mod's files are in place
+		Uninstalling,	// An uninstall thread owns the mod
+		Failed			// The last install failed, the mod can be installed again
+	};
+
+	inline const char* ModStateToString(ModState state) {
+		switch (state) {
+			case ModState::Downloaded: return "Downloaded";
+			case ModState::Installing: return "Installing";
+			case ModState::Installed: return "Installed";
+			case ModState::Uninstalling: return "Uninstalling";
+			case ModState::Failed: return "Failed";
+		}
+
+		return "Unknown";
+	}
+}
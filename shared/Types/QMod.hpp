@@ -7,14 +7,34 @@
 #include <fstream>
 #include <memory>
 #include <mutex>
-
-#include "cpp-semver/shared/cpp-semver.hpp"
+#include <atomic>
+#include <span>
+#include <unordered_set>
+#include <string_view>
+#include <unistd.h>
 
 #include "qmod-utils/shared/Types/Dependency.hpp"
 #include "qmod-utils/shared/Types/FileCopy.hpp"
+#include "qmod-utils/shared/Types/ModState.hpp"
+#include "qmod-utils/shared/Types/InstallMode.hpp"
+#include "qmod-utils/shared/Types/CoverCache.hpp"
+#include "qmod-utils/shared/Types/MetadataArena.hpp"
+#include "qmod-utils/shared/Types/FieldDescriptors.hpp"
+#include "qmod-utils/shared/Paths.hpp"
 #include "qmod-utils/shared/WebUtils.hpp"
-
-#include "jni-utils/shared/JNIUtils.hpp"
+#include "qmod-utils/shared/Semver.hpp"
+#include "qmod-utils/shared/FileUtils.hpp"
+#include "qmod-utils/shared/ZipUtils.hpp"
+#include "qmod-utils/shared/JsonUtils.hpp"
+
+#include "qmod-utils/shared/PackageInfo.hpp"
+#include "qmod-utils/shared/Trace.hpp"
+#include "qmod-utils/shared/Metrics.hpp"
+#include "qmod-utils/shared/Log.hpp"
+#include "qmod-utils/shared/Operation.hpp"
+#include "qmod-utils/shared/Background.hpp"
+#include "qmod-utils/shared/Journal.hpp"
+#include "qmod-utils/shared/LibraryRegistry.hpp"
 
 #include "beatsaber-hook/shared/rapidjson/include/rapidjson/document.h"
 #include "beatsaber-hook/shared/rapidjson/include/rapidjson/writer.h"
@@ -27,7 +47,7 @@
 		if (!(condition))                                                                                                                \
 		{                                                                                                                                \
 			if (verbos)                                                                                                                  \
-				getLogger().info("[%s] QMOD ASSERT [%s:%i]: Condition \"%s\" Failed!", name.c_str(), __FILE__, __LINE__, "" #condition); \
+				QLOG_INFO("[%s] QMOD ASSERT [%s:%i]: Condition \"%s\" Failed!", name.c_str(), __FILE__, __LINE__, "" #condition); \
                                                                                                                                          \
 			CleanupTempDir(name);                                                                                                        \
 			CleanupTempDir(string_format("Downloads/%s.qmod", name.c_str()), true);                                                      \
@@ -37,82 +57,6 @@
 		}                                                                                                                                \
 	}
 
-#define GET_STRING(value, parentObject) (parentObject.HasMember(value) && parentObject[value].IsString()) ? parentObject[value].GetString() : ""
-#define GET_BOOL(value, parentObject) (parentObject.HasMember(value) && parentObject[value].IsBool()) ? parentObject[value].GetBool() : false
-
-#define CREATE_STRING_VALUE(string)
-
-#define ADD_MEMBER(name, value, object, allocator) \
-	if (object.HasMember(name))                    \
-	{                                              \
-		object.RemoveMember(name);                 \
-	}                                              \
-	object.AddMember(name, value, allocator)
-
-#define ADD_MEMBER_NULL(name, object, allocator) ADD_MEMBER(name, rapidjson::Value(rapidjson::Type::kNullType), object, allocator);
-
-#define ADD_STRING_MEMBER(name, value, object, allocator)     \
-	if (value == "")                                          \
-	{                                                         \
-		ADD_MEMBER_NULL(name, object, allocator);             \
-	}                                                         \
-	else                                                      \
-	{                                                         \
-		rapidjson::Value str;                                 \
-		str.SetString(value.data(), value.size(), allocator); \
-		ADD_MEMBER(name, str, object, allocator);             \
-	}
-
-#define GET_ARRAY(valueName, array, type, parentObject)                         \
-	if (parentObject.HasMember(valueName) && parentObject[valueName].IsArray()) \
-	{                                                                           \
-		auto &value = parentObject[valueName];                                  \
-                                                                                \
-		for (rapidjson::SizeType i = 0; i < value.Size(); i++)                  \
-		{                                                                       \
-			array->push_back(value[i].Get##type());                             \
-		}                                                                       \
-	}
-
-#define GET_DEPENDENCIES(valueName, dependencies, parentObject)                                   \
-	if (parentObject.HasMember(valueName) && parentObject[valueName].IsArray())                   \
-	{                                                                                             \
-		auto &value = parentObject[valueName];                                                    \
-                                                                                                  \
-		for (rapidjson::SizeType i = 0; i < value.Size(); i++)                                    \
-		{                                                                                         \
-			if (value[i].IsObject())                                                              \
-			{                                                                                     \
-				const rapidjson::Value &dependencyValue = value[i];                               \
-                                                                                                  \
-				std::string id = GET_STRING("id", dependencyValue);                               \
-				std::string version = GET_STRING("version", dependencyValue);                     \
-				std::string downloadIfMissing = GET_STRING("downloadIfMissing", dependencyValue); \
-                                                                                                  \
-				dependencies->push_back({id, version, downloadIfMissing});                        \
-			}                                                                                     \
-		}                                                                                         \
-	}
-
-#define GET_FILE_COPIES(valueName, fileCopies, parentObject)                        \
-	if (parentObject.HasMember(valueName) && parentObject[valueName].IsArray())     \
-	{                                                                               \
-		auto &value = parentObject[valueName];                                      \
-                                                                                    \
-		for (rapidjson::SizeType i = 0; i < value.Size(); i++)                      \
-		{                                                                           \
-			if (value[i].IsObject())                                                \
-			{                                                                       \
-				const rapidjson::Value &fileCopyValue = value[i];                   \
-                                                                                    \
-				std::string name = GET_STRING("name", fileCopyValue);               \
-				std::string destination = GET_STRING("destination", fileCopyValue); \
-                                                                                    \
-				fileCopies->push_back({name, destination});                         \
-			}                                                                       \
-		}                                                                           \
-	}
-
 namespace QModUtils
 {
 	class QMod
@@ -123,70 +67,41 @@ namespace QModUtils
 		 * 
 		 * @param fileDir The path to the QMod
 		 * @param verbos Weather or not to print logs
-		 * @param cleanUpTempDir If True, the temperary dir that is used when extracting files from the QMod will be deleted after use
 		 */
-		QMod(std::string fileDir, bool verbos = true, bool cleanUpTempDir = true)
+		QMod(std::string fileDir, bool verbos = true)
 		{
-			std::string tmpDir = GetTempDir(fileDir);
-
-			// Create Temp Dir To Read the mod.json
-
-			std::system(string_format("mkdir -p \"%s\"", tmpDir.c_str()).c_str());
-			std::system(string_format("unzip \"%s\" mod.json -d \"%s\"", fileDir.c_str(), tmpDir.c_str()).c_str());
+			// Read the mod.json straight out of the mapped QMod, then parse it in place so the strings are only copied once (into the metadata arena)
+			TRACE_SCOPE_ARG("QMod", "Load", fileDir);
 
-			// Read the mod.json
+			ZipUtils::ZipReader zip;
+			const ZipUtils::ZipEntry *manifest = nullptr;
 
-			std::ifstream qmodFile(string_format("%smod.json", tmpDir.c_str()).c_str());
+			ASSERT(zip.Open(fileDir) && (manifest = zip.Find("mod.json")) != nullptr, GetFileName(fileDir), verbos);
+			ASSERT(zip.Read(*manifest, t_ManifestBuffer), GetFileName(fileDir), verbos);
 
-			std::stringstream qmodJson;
-			qmodJson << qmodFile.rdbuf();
+			zip.Close();
 
 			rapidjson::Document document;
-			ASSERT(!document.Parse(qmodJson.str().c_str()).HasParseError(), GetFileName(fileDir), verbos);
-
-			// Clean Up Temp Dirs
-			if (cleanUpTempDir)
-				CleanupTempDir(GetFileName(fileDir));
-
-			// Get Values
-
-			m_Name = GET_STRING("name", document);
-			m_Id = GET_STRING("id", document);
-			m_Description = GET_STRING("description", document);
-			m_Author = GET_STRING("author", document);
-			m_Porter = GET_STRING("porter", document);
-			m_Version = GET_STRING("version", document);
-			m_CoverImage = GET_STRING("coverImage", document);
-			m_PackageId = GET_STRING("packageId", document);
-			m_PackageVersion = GET_STRING("packageVersion", document);
-
-			m_ModFiles = new std::vector<std::string>();
-			GET_ARRAY("modFiles", m_ModFiles, String, document);
-
-			m_LibraryFiles = new std::vector<std::string>();
-			GET_ARRAY("libraryFiles", m_LibraryFiles, String, document);
-
-			m_Dependencies = new std::vector<Dependency>();
-			GET_DEPENDENCIES("dependencies", m_Dependencies, document);
-
-			m_FileCopies = new std::vector<FileCopy>();
-			GET_FILE_COPIES("fileCopies", m_FileCopies, document);
+			ASSERT(!document.ParseInsitu(t_ManifestBuffer.data()).HasParseError(), GetFileName(fileDir), verbos);
 
 			m_Path = fileDir;
+			FileUtils::StatAt(AT_FDCWD, m_Path.c_str(), m_FileIdentity);
+
+			// Get Values, in a single pass over the mod.json's members
 
-			m_IsLibrary = GET_BOOL("isLibrary", document);
+			ReadManifest(document);
 
 			CachePackageInfo();
 
 			if (m_PackageId != m_AppPackageId) {
-				getLogger().error("QMod \"%s\" is made for package \"%s\", but the current package is \"%s\"", m_Id.c_str(), m_PackageId.c_str(), m_AppPackageId.c_str());
+				QLOG_ERROR("QMod \"%s\" is made for package \"%s\", but the current package is \"%s\"", m_Id.data(), m_PackageId.data(), m_AppPackageId.c_str());
 
 				m_Valid = false;
 				return;
 			}
 
 			if (m_PackageVersion != m_AppPackageVersion) {
-				getLogger().error("QMod \"%s\" is made for package version \"%s\", but the current package version is \"%s\"", m_Id.c_str(), m_PackageVersion.c_str(), m_AppPackageVersion.c_str());
+				QLOG_ERROR("QMod \"%s\" is made for package version \"%s\", but the current package version is \"%s\"", m_Id.data(), m_PackageVersion.data(), m_AppPackageVersion.c_str());
 
 				m_Valid = false;
 				return;
@@ -195,8 +110,8 @@ namespace QModUtils
 			// Attempt to load BMBF Specific Data
 			GetBMBFData(verbos);
 
-			m_DownloadedQMods->insert({this->m_Id, this});
 			m_Valid = true;
+			RegisterVersion();
 		}
 
 		/**
@@ -204,10 +119,11 @@ namespace QModUtils
 		 * 
 		 * @param blocking If true, the Install will join before the end of this method
 		 * @param installedInBranch Used to stop recursive dependencies. Leave blank unless you know what you're doing
+		 * @param prepareDependencies If false, dependencies are assumed to already be installed. Used when installing a plan from the DependencyResolver
 		 */
-		void Install(bool blocking = false, std::vector<std::string> *installedInBranch = new std::vector<std::string>())
+		void Install(bool blocking = false, std::vector<std::string> *installedInBranch = new std::vector<std::string>(), bool prepareDependencies = true)
 		{
-			std::optional<std::thread> thread = InstallAsync(installedInBranch);
+			std::optional<std::thread> thread = InstallAsync(installedInBranch, prepareDependencies);
 			if (thread.has_value())
 			{
 				if (blocking)
@@ -241,179 +157,319 @@ namespace QModUtils
 		 * @brief Returns a thread that can be used to insatll this QMod
 		 * 
 		 * @param installedInBranch Used to stop recursive dependencies. Leave blank unless you know what you're doing
+		 * @param prepareDependencies If false, dependencies are assumed to already be installed. Used when installing a plan from the DependencyResolver
+		 * @param replacing An installed version of this mod whose files are still in place. Only the files that differ are rewritten, see ReinstallAsync
 		 */
-		std::optional<std::thread> InstallAsync(std::vector<std::string> *installedInBranch = new std::vector<std::string>())
+		std::optional<std::thread> InstallAsync(std::vector<std::string> *installedInBranch = new std::vector<std::string>(), bool prepareDependencies = true, QMod *replacing = nullptr)
 		{
 			if (!m_Valid)
 			{
-				getLogger().info("Mod \"%s\" Is an invalid QMod!", m_Id.c_str());
+				QLOG_INFO("Mod \"%s\" Is an invalid QMod!", m_Id.data());
 				return std::nullopt;
 			}
 
 			CachePackageInfo();
 			if (m_PackageId != m_AppPackageId)
 			{
-				getLogger().info("Mod \"%s\" Is not built for the package \"%s\", but instead is built for \"%s\"!", m_Id.c_str(), m_AppPackageId.c_str(), m_PackageId.c_str());
+				QLOG_INFO("Mod \"%s\" Is not built for the package \"%s\", but instead is built for \"%s\"!", m_Id.data(), m_AppPackageId.c_str(), m_PackageId.data());
 				return std::nullopt;
 			}
 
 			return std::thread(
-				[this, installedInBranch]
+				[this, installedInBranch, prepareDependencies, replacing, context = Operation::Current()]() mutable
 				{
-					if (m_Installed)
+					Operation::Scope operation(context);
+					Background::ApplyToCurrentThread();
+					TRACE_SCOPE_ARG("QMod", "Install", m_Id);
+					Log::OperationSummary summary("Install", m_Id);
+
+					if (!Operation::Checkpoint())
+					{
+						QLOG_INFO("Install of \"%s\" was cancelled", m_Id.data());
+						return;
+					}
+
+					// Installing an inactive version switches to it first. The files of the version it replaces are left in place, and updated with a delta
+					if (!IsActive() && !SwitchActiveVersion(true, &replacing))
+						return;
+
+					// Claiming the mod first means a second install request for the same mod is dropped instead of racing this one
+					if (!TryTransition(ModState::Downloaded, ModState::Installing) && !TryTransition(ModState::Failed, ModState::Installing))
 					{
-						getLogger().info("Mod \"%s\" Already Installed!", m_Id.c_str());
+						QLOG_INFO("Mod \"%s\" Already %s!", m_Id.data(), ModStateToString(State()));
 						return;
 					}
 
-					getLogger().info("Installing mod \"%s\"", m_Id.c_str());
+					QLOG_INFO("Installing mod \"%s\"", m_Id.data());
 
-					// Add to the installed tree so that dependencies further down on us will trigger a recursive install error
-					installedInBranch->push_back(m_Id);
+					// Add to the installed tree so that dependencies further down on us will trigger a recursive install error. Every way out takes it back off
+					installedInBranch->push_back(std::string(m_Id));
 
-					// We say that the mod is installed now to prevent multiple installs of the same mod If the install fails we can then can say its uninstalled later
-					m_Installed = true;
+					auto LeaveBranch = [&]()
+					{ installedInBranch->erase(std::remove(installedInBranch->begin(), installedInBranch->end(), m_Id), installedInBranch->end()); };
 
-					for (Dependency dependency : *m_Dependencies)
+					for (Dependency dependency : m_Dependencies)
 					{
-						if (!PrepareDependency(dependency, installedInBranch))
+						if (prepareDependencies && !PrepareDependency(dependency, installedInBranch))
 						{
-							getLogger().error("Failed to install \"%s\" as one of its dependencies (%s) also failed to install", m_Id.c_str(), dependency.id.c_str());
+							QLOG_ERROR("Failed to install \"%s\" as one of its dependencies (%s) also failed to install", m_Id.data(), dependency.id.data());
 
-							m_Installed = false;
+							LeaveBranch();
+							m_State.store(ModState::Failed, std::memory_order_release);
 							return;
 						}
 					}
 
+					// Last chance to stop before anything is touched. Once the active version has been switched, the old version's files have to be reconciled either way
+					if (!Operation::Checkpoint() && replacing == nullptr)
+					{
+						QLOG_INFO("Install of \"%s\" was cancelled", m_Id.data());
+
+						LeaveBranch();
+						m_State.store(ModState::Downloaded, std::memory_order_release);
+						return;
+					}
+
 					// We only lock now so that the dependencies can install first without issues
-					std::unique_lock guard(m_InstallLock);
+					Metrics::TimedLock guard(m_InstallLock, Metrics::Histogram::InstallLockWait, Metrics::Histogram::InstallLockHold, std::defer_lock);
+					{
+						TRACE_SCOPE_ARG("QMod", "WaitInstallLock", m_Id);
+						guard.lock();
+					}
+
+					// Switching versions rewrites the old version's files, so it's journaled like a reinstall
+					Journal::Transaction transaction(replacing != nullptr ? "Reconcile" : "Install", m_Id, m_Version);
+
+					FilesResult placed = FilesResult::Done;
 
-					// Extract QMod so we can move the files
-					ExtractQMod();
+					if (replacing != nullptr)
+						placed = ReconcileFiles(replacing, transaction);
+					else
+						placed = PlaceAllFiles(transaction);
 
-					std::string tmpDir = GetTempDir(m_Path);
-					std::string modsExtractionPath = tmpDir + "Mods/";
-					std::string libsExtractionPath = tmpDir + "Libs/";
-					std::string fileCopiesExtractionPath = tmpDir + "FileCopies/";
+					LeaveBranch();
 
-					// Copy the Mods files to the Mods folder
-					for (std::string mod : *m_ModFiles)
+					if (placed == FilesResult::Cancelled)
 					{
-						std::system(string_format("mv -f \"%s%s\" \"/sdcard/Android/data/com.beatgames.beatsaber/files/mods/\"", modsExtractionPath.c_str(), mod.c_str()).c_str());
+						QLOG_INFO("Install of \"%s\" was cancelled, removed the files that were already in place", m_Id.data());
+
+						m_State.store(ModState::Downloaded, std::memory_order_release);
+						CleanupTempDir(GetFileName(m_Path));
+						return;
 					}
 
-					// Copy the Libs files to the Libs folder
-					for (std::string lib : *m_LibraryFiles)
+					if (placed == FilesResult::Failed)
 					{
-						std::system(string_format("mv -f \"%s%s\" \"/sdcard/Android/data/com.beatgames.beatsaber/files/libs/\"", libsExtractionPath.c_str(), lib.c_str()).c_str());
+						QLOG_ERROR("Failed to install \"%s\", its files couldn't be put in place from \"%s\"", m_Id.data(), m_Path.c_str());
+
+						m_State.store(ModState::Failed, std::memory_order_release);
+						CleanupTempDir(GetFileName(m_Path));
+						return;
 					}
 
-					// Copy the File Copies to their respective destination folders
-					for (FileCopy fileCopy : *m_FileCopies)
+					// All the files are in place, so the BMBF Data can now say the mod is installed
+					m_State.store(ModState::Installed, std::memory_order_release);
+
+					// If QMod is for Beat Saber, then Update its BMBF Data
+					if (m_PackageId == "com.beatgames.beatsaber")
 					{
-						std::string desPath = fileCopy.destination.substr(0, fileCopy.destination.find_last_of("/\\"));
+						transaction.Config("Installed");
+						UpdateBMBFData();
+					}
+
+					transaction.Commit();
+
+					QLOG_INFO("Successfully Installed \"%s\"!", m_Id.data());
+					CleanupTempDir(GetFileName(m_Path));
+				});
+		}
+
+		/**
+		 * @brief Returns a thread that can be used to reinstall this QMod over its own files, rewriting only the ones that don't match the .qmod
+		 * @details Each file is compared by size first, then by the CRC-32 in the .qmod's central directory, so an unchanged file costs a stat and a read.
+		 * Files that the QMod no longer ships are removed
+		 */
+		std::optional<std::thread> ReinstallAsync()
+		{
+			if (!m_Valid)
+			{
+				QLOG_INFO("Mod \"%s\" Is an invalid QMod!", m_Id.data());
+				return std::nullopt;
+			}
+
+			return std::thread(
+				[this, context = Operation::Current()]
+				{
+					Operation::Scope operation(context);
+					Background::ApplyToCurrentThread();
+					TRACE_SCOPE_ARG("QMod", "Reinstall", m_Id);
+					Log::OperationSummary summary("Reinstall", m_Id);
 
-						std::system(string_format("mkdir -p \"%s\"", desPath.c_str()).c_str());
-						std::remove(fileCopy.destination.c_str());
+					if (!Operation::Checkpoint())
+					{
+						QLOG_INFO("Reinstall of \"%s\" was cancelled", m_Id.data());
+						return;
+					}
 
-						std::system(string_format("mv -f \"%s%s\" \"%s\"", fileCopiesExtractionPath.c_str(), fileCopy.name.c_str(), fileCopy.destination.c_str()).c_str());
+					if (!TryTransition(ModState::Installed, ModState::Installing))
+					{
+						QLOG_INFO("Mod \"%s\" is %s, not reinstalling it!", m_Id.data(), ModStateToString(State()));
+						return;
 					}
 
-					installedInBranch->erase(std::remove(installedInBranch->begin(), installedInBranch->end(), m_Id), installedInBranch->end());
+					Metrics::TimedLock guard(m_InstallLock, Metrics::Histogram::InstallLockWait, Metrics::Histogram::InstallLockHold);
 
-					// If QMod is for Beat Saber, then Update its BMBF Data
-					if (!strcmp(m_PackageId.c_str(), "com.beatgames.beatsaber"))
+					Journal::Transaction transaction("Reconcile", m_Id, m_Version);
+					FilesResult reconciled = ReconcileFiles(this, transaction);
+
+					// The transaction is left to abort, as every file that was rewritten is whole
+					if (reconciled == FilesResult::Cancelled)
 					{
-						UpdateBMBFData();
+						QLOG_INFO("Reinstall of \"%s\" was cancelled, some of its files may not have been rewritten", m_Id.data());
+
+						m_State.store(ModState::Downloaded, std::memory_order_release);
+						CleanupTempDir(GetFileName(m_Path));
+						return;
+					}
+
+					if (reconciled == FilesResult::Failed)
+					{
+						QLOG_ERROR("Failed to reinstall \"%s\", its files couldn't be extracted from \"%s\"", m_Id.data(), m_Path.c_str());
+
+						m_State.store(ModState::Failed, std::memory_order_release);
+						CleanupTempDir(GetFileName(m_Path));
+						return;
 					}
 
-					getLogger().info("Successfully Installed \"%s\"!", m_Id.c_str());
+					m_State.store(ModState::Installed, std::memory_order_release);
+					transaction.Commit();
+
+					QLOG_INFO("Successfully Reinstalled \"%s\"!", m_Id.data());
 					CleanupTempDir(GetFileName(m_Path));
 				});
 		}
 
+		/**
+		 * @brief Reinstalls this QMod over its own files, see ReinstallAsync
+		 * 
+		 * @param blocking If true, the Reinstall will join before the end of this method
+		 */
+		void Reinstall(bool blocking = false)
+		{
+			std::optional<std::thread> thread = ReinstallAsync();
+			if (thread.has_value())
+			{
+				if (blocking)
+					thread.value().join();
+				else
+					thread.value().detach();
+			}
+		}
+
 		/**
 		 * @brief Returns a thread that can be used to Uninstall the current QMod
 		 * 
 		 * @param onlyDisable If False, the .qmod file will be deleted from the system
+		 * @param cleanDependents If False, mods depending on this one (and libraries only it used) are left alone. Used when switching versions
 		 */
-		std::optional<std::thread> UninstallAsync(bool onlyDisable = true)
+		std::optional<std::thread> UninstallAsync(bool onlyDisable = true, bool cleanDependents = true)
 		{
 			if (!m_Valid)
 			{
-				getLogger().info("Failed to uninstall \"%s\", Mod Is an invalid QMod!", m_Id.c_str());
+				QLOG_INFO("Failed to uninstall \"%s\", Mod Is an invalid QMod!", m_Id.data());
 				return std::nullopt;
 			}
 
 			if (!m_Uninstallable)
 			{
-				getLogger().warning("\"%s\" is marked as not being Uninstallable, this probably means you are uninstalling a core mod. Be careful!", m_Id.c_str());
+				QLOG_WARNING("\"%s\" is marked as not being Uninstallable, this probably means you are uninstalling a core mod. Be careful!", m_Id.data());
 			}
 
 			return std::thread(
-				[this, onlyDisable]
+				[this, onlyDisable, cleanDependents, context = Operation::Current()]
 				{
-					std::unique_lock guard(m_InstallLock);
+					Operation::Scope operation(context);
+					Background::ApplyToCurrentThread();
+					TRACE_SCOPE_ARG("QMod", "Uninstall", m_Id);
+					Log::OperationSummary summary("Uninstall", m_Id);
 
-					if (!m_Installed && onlyDisable)
+					if (!Operation::Checkpoint())
 					{
-						// We only wanna return if we are only tryna disable the mod.
-						// If were tryna remove it, it doesnt matter if its installed or not
-
-						getLogger().info("Mod \"%s\" is already uninstalled!", m_Id.c_str());
+						QLOG_INFO("Uninstall of \"%s\" was cancelled", m_Id.data());
 						return;
 					}
 
-					getLogger().info("Uninstalling \"%s\"", m_Id.c_str());
+					// Kept so the mod can be put back in its state if the uninstall can't start
+					ModState previous = ModState::Installed;
 
-					// Remove mod SOs so that the mod will not load
-					for (std::string modFile : *m_ModFiles)
+					if (!TryTransition(previous, ModState::Uninstalling))
 					{
-						getLogger().info("Removing Mod file \"%s\" from mod \"%s\"", modFile.c_str(), m_Id.c_str());
+						// We only wanna return if we are only tryna disable the mod.
+						// If were tryna remove it, it doesnt matter if its installed or not, as long as nothing else owns it
 
-						std::system(string_format("rm -f \"/sdcard/Android/data/com.beatgames.beatsaber/files/mods/%s\"", modFile.c_str()).c_str());
+						if (onlyDisable || (!TryTransition(previous = ModState::Downloaded, ModState::Uninstalling) && !TryTransition(previous = ModState::Failed, ModState::Uninstalling)))
+						{
+							QLOG_INFO("Mod \"%s\" is already %s!", m_Id.data(), ModStateToString(State()));
+							return;
+						}
 					}
 
-					// Only Remove Libs if they are not needed elsewhere
-					for (std::string libFile : *m_LibraryFiles)
+					Metrics::TimedLock guard(m_InstallLock, Metrics::Histogram::InstallLockWait, Metrics::Histogram::InstallLockHold);
+
+					QLOG_INFO("Uninstalling \"%s\"", m_Id.data());
+
+					// Linked installs hand the files back to the unpacked copy, so enabling the mod again doesn't have to extract anything
+					bool linked = m_InstallMode.load() == InstallMode::Linked;
+					std::string unpackedDir = linked ? GetUnpackedDir() : "";
+
+					// Every file is planned first, so an uninstall that gets cut short can be finished on the next start
+					Journal::Transaction transaction(onlyDisable ? "Disable" : "Remove", m_Id, m_Version);
+
+					std::vector<PayloadFile> removals;
+
+					for (PayloadFile &file : GetPayload())
 					{
-						bool isUsedElsewhere = false;
-						for (std::pair<std::string, QMod *> modPair : *m_DownloadedQMods)
+						// Only Remove Libs if they are not needed elsewhere
+						if (file.library && !LibraryRegistry::Release(file.entry, m_Id))
 						{
-							QMod *otherMod = modPair.second;
-							if (otherMod == this || !otherMod->m_Installed)
-								continue;
+							QLOG_DETAIL("Lib File \"%s\" is used elsewhere, not removing", file.entry.data());
+							continue;
+						}
 
-							if (std::count(otherMod->m_LibraryFiles->begin(), otherMod->m_LibraryFiles->end(), libFile))
-							{
-								getLogger().info("Lib File \"%s\" is used elsewhere, not removing", libFile.c_str());
+						transaction.Remove(linked, linked ? unpackedDir + file.folder + std::string(file.entry) : "", file.destination);
+						removals.push_back(std::move(file));
+					}
 
-								isUsedElsewhere = true;
-								break;
-							}
-						}
+					if (!transaction.Begin())
+					{
+						QLOG_ERROR("Failed to uninstall \"%s\", the journal couldn't be written (errno %i)", m_Id.data(), errno);
 
-						if (!isUsedElsewhere)
+						// Nothing was removed, so an installed mod still holds every library it ships
+						if (previous == ModState::Installed)
 						{
-							getLogger().info("Removing Library file \"%s\" from mod \"%s\"", libFile.c_str(), m_Id.c_str());
-
-							std::system(string_format("rm -f \"/sdcard/Android/data/com.beatgames.beatsaber/files/libs/%s\"", libFile.c_str()).c_str());
+							for (std::string_view library : m_LibraryFiles)
+								LibraryRegistry::Acquire(library, m_Id, nullptr);
 						}
+
+						m_State.store(previous, std::memory_order_release);
+						return;
 					}
 
-					// Remove file copies
-					for (FileCopy fileCopy : *m_FileCopies)
+					// The mod SOs come first, so the mod will not load even if this is cut short
+					for (const PayloadFile &file : removals)
 					{
-						getLogger().info("Removing copied file \"%s\" from mod \"%s\"", fileCopy.destination.c_str(), m_Id.c_str());
+						QLOG_DETAIL("Removing \"%s\" from mod \"%s\"", file.destination.c_str(), m_Id.data());
 
-						std::system(string_format("rm -f \"%s\"", fileCopy.destination.c_str()).c_str());
+						RemovePayloadFile(unpackedDir + file.folder + std::string(file.entry), file.destination, linked);
 					}
 
-					m_Installed = false;
+					m_State.store(ModState::Downloaded, std::memory_order_release);
 
 					// If QMod is for Beat Saber, then Remove its BMBF Data
-					if (!strcmp(m_PackageId.c_str(), "com.beatgames.beatsaber"))
+					if (m_PackageId == "com.beatgames.beatsaber")
 					{
+						transaction.Config(onlyDisable ? "Downloaded" : "Removed");
+
 						if (onlyDisable)
 							UpdateBMBFData();
 						else
@@ -423,20 +479,28 @@ namespace QModUtils
 					// This is for actually removing the qmod, not just disabling it
 					if (!onlyDisable)
 					{
-						m_DownloadedQMods->erase(m_Id);
+						ForgetVersion(this);
 
-						std::system(string_format("rm -f \"sdcard/BMBFData/Mods/%s_%s\"", GetFileName(m_Path).c_str(), m_CoverImage.c_str()).c_str());
-						std::system(string_format("rm -f \"%s\"", m_Path.c_str()).c_str());
+						if (linked)
+							Metrics::System(string_format("rm -f -r \"%s\"", unpackedDir.c_str()));
+
+						if (!m_CoverImageFilename.empty())
+							unlink(string_format("%s%s", Paths::Mods().c_str(), m_CoverImageFilename.c_str()).c_str());
+						Metrics::System(string_format("rm -f \"%s\"", m_Path.c_str()));
 					}
 
+					transaction.Commit();
 					guard.unlock();
 
-					CleanDependentMods(true);
-					if (!m_IsLibrary)
-						CleanUnusedLibraries(true);
+					if (cleanDependents)
+					{
+						CleanDependentMods(true);
+						if (!m_IsLibrary)
+							CleanUnusedLibraries(true);
+					}
 
 					CleanupTempDir(GetFileName(m_Path));
-					getLogger().info("Successfully Uninstalled \"%s\"!", m_Id.c_str());
+					QLOG_INFO("Successfully Uninstalled \"%s\"!", m_Id.data());
 				});
 		}
 
@@ -445,10 +509,11 @@ namespace QModUtils
 		 * 
 		 * @param onlyDisable If False, the .qmod file will be deleted from the system
 		 * @param blocking If true, the Install will join before the end of this method
+		 * @param cleanDependents If False, mods depending on this one (and libraries only it used) are left alone. Used when switching versions
 		 */
-		void Uninstall(bool onlyDisable = true, bool blocking = false)
+		void Uninstall(bool onlyDisable = true, bool blocking = false, bool cleanDependents = true)
 		{
-			std::optional<std::thread> thread = UninstallAsync(onlyDisable);
+			std::optional<std::thread> thread = UninstallAsync(onlyDisable, cleanDependents);
 			if (thread.has_value())
 			{
 				if (blocking)
@@ -470,9 +535,13 @@ namespace QModUtils
 			CachePackageInfo();
 
 			return std::thread(
-				[fileName, url, installedInBranch]
+				[fileName, url, installedInBranch, context = Operation::Current()]
 				{
-					std::string downloadFileLoc = string_format("/sdcard/BMBFData/Mods/Temp/Downloads/%s", fileName.c_str());
+					Operation::Scope operation(context);
+					Background::ApplyToCurrentThread();
+					TRACE_SCOPE_ARG("QMod", "InstallFromUrl", fileName);
+
+					std::string downloadFileLoc = string_format("%s%s", Paths::Downloads().c_str(), fileName.c_str());
 
 					if (!WebUtils::DownloadFile(url, downloadFileLoc))
 					{
@@ -482,12 +551,67 @@ namespace QModUtils
 
 					// NOTE: There is no clean up here because the cleanup will occur during the install
 					QMod *downloadedMod = new QMod(downloadFileLoc);
-					downloadedMod->m_Installed = false;
+					downloadedMod->m_State.store(ModState::Downloaded, std::memory_order_release);
 
 					downloadedMod->Install(true, installedInBranch);
 				});
 		}
 
+		/**
+		 * @brief While one is in scope, "config.json" changes from every thread are collected instead of written, then written once when the last one goes out of scope
+		 * @details Everything else UpdateBMBFData does (moving the .qmod, the cover) still happens straight away
+		 */
+		class ConfigBatch
+		{
+		public:
+			ConfigBatch()
+			{
+				std::unique_lock lock(m_BmbfConfigLock);
+				m_ConfigBatchDepth++;
+			}
+
+			~ConfigBatch()
+			{
+				Close();
+			}
+
+			/**
+			 * @brief Ends this batch before it goes out of scope, so a failed write can be seen
+			 *
+			 * @return Returns false if this was the last batch, and the changes couldn't be written to "config.json"
+			 */
+			bool Close()
+			{
+				std::unique_lock lock(m_BmbfConfigLock);
+
+				if (m_Closed)
+					return true;
+
+				m_Closed = true;
+				return --m_ConfigBatchDepth != 0 || CommitConfigBatch();
+			}
+
+			ConfigBatch(const ConfigBatch &) = delete;
+			ConfigBatch &operator=(const ConfigBatch &) = delete;
+
+		private:
+			bool m_Closed = false;
+		};
+
+		/**
+		 * @brief Extracts everything an install of this QMod will need, to where the install takes it from
+		 * @details Doesn't take the install lock, so several QMods can be prefetched at once ahead of installing them one after another
+		 */
+		void Prefetch()
+		{
+			TRACE_SCOPE_ARG("QMod", "Prefetch", m_Id);
+
+			if (m_InstallMode.load() == InstallMode::Linked)
+				EnsureUnpacked();
+			else
+				ExtractQMod(GetTempDir(m_Path));
+		}
+
 		/**
 		 * @brief Saves this QMod's data into BMBF's "config.json"
 		 * 
@@ -495,325 +619,1514 @@ namespace QModUtils
 		 */
 		void UpdateBMBFData(bool verbos = true)
 		{
+			TRACE_SCOPE_ARG("Config", "UpdateBMBFData", m_Id);
+			Log::OperationSummary summary("UpdateBMBFData", m_Id);
+
 			// Prevents multiple threads writing to the file at the same time
-			std::unique_lock<std::mutex> guard(m_BmbfConfigLock);
+			Metrics::TimedLock guard(m_BmbfConfigLock, Metrics::Histogram::ConfigLockWait, Metrics::Histogram::ConfigLockHold);
 
 			if (verbos)
-				getLogger().info("Updating BMBF Info for \"%s\"", m_Id.c_str());
-
-			// Read the config.json file
-			std::ifstream configFile("/sdcard/BMBFData/config.json");
-			ASSERT(configFile.good(), GetFileName(m_Path), verbos);
-
-			std::stringstream configJson;
-			configJson << configFile.rdbuf();
+				QLOG_DETAIL("Updating BMBF Info for \"%s\"", m_Id.data());
 
+			// Read the config.json file, unless a batch is going to write it once for every mod
 			rapidjson::Document document;
+			bool batched = m_ConfigBatchDepth > 0;
 
-			ASSERT(!document.Parse(configJson.str().c_str()).HasParseError(), GetFileName(m_Path), verbos);
-			ASSERT(document.HasMember("Mods") && document["Mods"].IsArray(), GetFileName(m_Path), verbos);
-
-			const auto &mods = document["Mods"].GetArray();
-			bool foundMod = false;
+			if (!batched)
+			{
+				ASSERT(ReadConfig(t_ConfigBuffer) && !document.ParseInsitu(t_ConfigBuffer.data()).HasParseError(), GetFileName(m_Path), verbos);
+				ASSERT(document.HasMember("Mods") && document["Mods"].IsArray(), GetFileName(m_Path), verbos);
+			}
 
 			std::string fileName = GetFileName(m_Path, false);
-			std::string displayName = GetFileName(m_Path);
 
 			// Move QMod
-			std::system(string_format("mv -f \"%s\" \"/sdcard/BMBFData/Mods/%s\"", m_Path.c_str(), fileName.c_str()).c_str());
-			m_Path = string_format("/sdcard/BMBFData/Mods/%s", fileName.c_str()).c_str();
+			Metrics::System(string_format("mv -f \"%s\" \"%s%s\"", m_Path.c_str(), Paths::Mods().c_str(), fileName.c_str()));
+			m_Path = string_format("%s%s", Paths::Mods().c_str(), fileName.c_str()).c_str();
 
-			// Attempt To Install The Cover
+			// Attempt To Install The Cover. BMBF reads it from its mods folder, so it's written there, but only if this QMod's cover isn't there already
 
 			if (m_CoverImage != "")
 			{
-				std::string tmpDir = GetTempDir(m_Path);
-
-				std::system(string_format("mkdir -p \"%s\"", tmpDir.c_str()).c_str());
+				std::string coverPath = GetCoverImagePath();
+				std::string coverFilename = coverPath.empty() ? "" : coverPath.substr(coverPath.find_last_of('/') + 1);
 
-				std::system(string_format("unzip \"%s\" \"%s\" -d \"%s\"", m_Path.c_str(), m_CoverImage.c_str(), tmpDir.c_str()).c_str());
+				// A different name means it's a different version's cover
+				if (!m_CoverImageFilename.empty() && m_CoverImageFilename != coverFilename)
+					unlink(string_format("%s%s", Paths::Mods().c_str(), m_CoverImageFilename.c_str()).c_str());
 
-				std::system(string_format("mv -f \"%s/%s\" \"sdcard/BMBFData/Mods/%s_%s\"", tmpDir.c_str(), m_CoverImage.c_str(), displayName.c_str(), m_CoverImage.c_str()).c_str());
-
-				m_CoverImageFilename = string_format("%s_%s", displayName.c_str(), m_CoverImage.c_str());
+				m_CoverImageFilename = coverFilename;
 			}
 
-			// Try Find Our Mod in the BMBF Data
-			for (auto &mod : mods)
+			if (batched)
 			{
-				// Find our mod id, then read the data
-
-				std::string id = GET_STRING("Id", mod);
-
-				if (id != m_Id)
-					continue;
-				foundMod = true;
-
-				if (verbos)
-					getLogger().info("Found existing BMBF Data for \"%s\", Updating It...", m_Id.c_str());
-
-				mod.SetObject();
-				UpdateBMBFJSONData(mod, document.GetAllocator());
+				BatchConfigChange(this);
+				return;
 			}
 
-			// BMBF Data could not be found, create the object first
-			if (!foundMod)
-			{
-				if (verbos)
-					getLogger().info("No BMBF Data Found for \"%s\"! Creating It Now...", m_Id.c_str());
+			// Save To Buffer, replacing our entry (or adding it if there isn't one) as the document is written
 
-				rapidjson::Value modDataObject = rapidjson::Value(rapidjson::Type::kObjectType);
-
-				UpdateBMBFJSONData(modDataObject, document.GetAllocator());
+			rapidjson::StringBuffer buffer;
+			Fields::JsonWriter writer(buffer);
 
-				std::string id = GET_STRING("Id", modDataObject);
-				mods.PushBack(modDataObject, document.GetAllocator());
-			}
+			bool foundMod = WriteBMBFConfig(document, writer, {{m_Id, this}}) > 0;
 
 			if (verbos)
-				getLogger().info("Updated BMBF Data for \"%s\"! Saving...", m_Id.c_str());
-
-			// Save To Buffer
-
-			rapidjson::StringBuffer buffer;
-			rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+			{
+				if (foundMod)
+					QLOG_DETAIL("Found existing BMBF Data for \"%s\", Updated It!", m_Id.data());
+				else
+					QLOG_DETAIL("No BMBF Data Found for \"%s\"! Created It!", m_Id.data());
 
-			document.Accept(writer);
+				QLOG_DETAIL("Updated BMBF Data for \"%s\"! Saving...", m_Id.data());
+			}
 
 			// Write To File
 
-			std::ofstream out("/sdcard/BMBFData/config.json");
-			out << buffer.GetString();
-			out.close();
+			if (!WriteConfig(buffer.GetString(), buffer.GetSize()))
+			{
+				QLOG_ERROR("Failed to save BMBF Data for \"%s\" (errno %i), config.json was left as it was", m_Id.data(), errno);
+				return;
+			}
 
 			if (verbos)
-				getLogger().info("Saved BMBF Data for \"%s\"!", m_Id.c_str());
+				QLOG_INFO("Saved BMBF Data for \"%s\"!", m_Id.data());
 		}
 
-		inline std::string Name() const { return m_Name; }
-		inline std::string Id() const { return m_Id; }
-		inline std::string Description() const { return m_Description; }
-		inline std::string Author() const { return m_Author; }
-		inline std::string Porter() const { return m_Porter; }
-		inline std::string Version() const { return m_Version; }
-		inline std::string CoverImage() const { return m_CoverImage; }
+		// The views point into the metadata arena, so they stay valid until the mods are rescanned. They are always null terminated
+
+		inline std::string_view Name() const { return m_Name; }
+		inline std::string_view Id() const { return m_Id; }
+		inline std::string_view Description() const { return m_Description; }
+		inline std::string_view Author() const { return m_Author; }
+		inline std::string_view Porter() const { return m_Porter; }
+		inline std::string_view Version() const { return m_Version; }
+		inline std::string_view CoverImage() const { return m_CoverImage; }
+
+		inline Semver::VersionId VersionId() const { return m_VersionId; }
 
-		inline std::string PackageId() const { return m_PackageId; }
-		inline std::string PackageVersion() const { return m_PackageVersion; }
+		inline std::string_view PackageId() const { return m_PackageId; }
+		inline std::string_view PackageVersion() const { return m_PackageVersion; }
 
-		inline std::vector<std::string> ModFiles() const { return *m_ModFiles; }
-		inline std::vector<std::string> LibraryFiles() const { return *m_LibraryFiles; }
-		inline std::vector<Dependency> Dependencies() const { return *m_Dependencies; }
-		inline std::vector<FileCopy> FileCopies() const { return *m_FileCopies; }
+		inline std::span<const std::string_view> ModFiles() const { return m_ModFiles; }
+		inline std::span<const std::string_view> LibraryFiles() const { return m_LibraryFiles; }
+		inline std::span<const Dependency> Dependencies() const { return m_Dependencies; }
+		inline std::span<const FileCopy> FileCopies() const { return m_FileCopies; }
 
-		inline std::string Path() const { return m_Path; }
-		inline std::string CoverImageFilename() const { return m_CoverImageFilename; }
+		inline const std::string &Path() const { return m_Path; }
+		inline const std::string &CoverImageFilename() const { return m_CoverImageFilename; }
 
 		inline bool Uninstallable() const { return m_Uninstallable; }
-		inline bool IsInstalled() const { return m_Installed; }
+		inline bool IsInstalled() const { return State() == ModState::Installed; }
+		inline ModState State() const { return m_State.load(std::memory_order_acquire); }
 		inline bool IsLibrary() const { return m_IsLibrary; }
 		inline bool Valid() const { return m_Valid; }
 
 		inline std::string FileName() const { return GetFileName(m_Path, false, true); }
 
+		/**
+		 * @brief Locks the downloaded QMods, the core mods and every mod's versions, which the mod watcher changes from its own thread
+		 * @details Hold it for as long as you use the maps from GetDownloadedQMods or GetCoreMods. Anything that does more than look something up should use DownloadedQMods instead, which copies the QMods out
+		 */
+		static inline std::unique_lock<std::recursive_mutex> LockRegistry() { return std::unique_lock(m_RegistryLock); }
+
 		static inline std::unordered_map<std::string, QMod *> *GetDownloadedQMods() { return m_DownloadedQMods; }
 		static inline std::unordered_map<std::string, QMod *> *GetCoreMods() { return m_CoreMods; }
 
-		void SetName(std::string val) { m_Name = val; }
-		void SetId(std::string val) { m_Id = val; }
-		void SetDescription(std::string val) { m_Description = val; }
-		void SetAuthor(std::string val) { m_Author = val; }
-		void SetPorter(std::string val) { m_Porter = val; }
-		void SetVersion(std::string val) { m_Version = val; }
-		void SetCoverImage(std::string val) { m_CoverImage = val; }
+		/**
+		 * @brief Returns the active version of every downloaded mod. The QMods stay valid until the next rescan, even if they're forgotten in the meantime
+		 */
+		static std::vector<QMod *> DownloadedQMods()
+		{
+			std::unique_lock lock(m_RegistryLock);
 
-		void SetPackageId(std::string val) { m_PackageId = val; }
-		void SetPackageVersion(std::string val) { m_PackageVersion = val; }
+			std::vector<QMod *> qmods;
+			qmods.reserve(m_DownloadedQMods->size());
 
-		void SetModFiles(std::vector<std::string> *val) { m_ModFiles = val; }
-		void SetLibraryFiles(std::vector<std::string> *val) { m_LibraryFiles = val; }
-		void SetDependencies(std::vector<Dependency> *val) { m_Dependencies = val; }
-		void SetFileCopies(std::vector<FileCopy> *val) { m_FileCopies = val; }
+			for (auto &pair : *m_DownloadedQMods)
+				qmods.push_back(pair.second);
 
-		// We must called UpdateBMBFData when changing the path, cus it'll break many things if we dont move the qmod
-		void SetPath(std::string val)
-		{
-			m_Path = val;
-			UpdateBMBFData();
+			return qmods;
 		}
 
-		void SetUninstallable(bool val) { m_Uninstallable = val; }
-
 		/**
-		 * @brief Returns a QMod with the given ID
-		 * 
-		 * @param id The QMod's ID
+		 * @brief Returns the core mods that are downloaded
 		 */
-		static std::optional<QMod *> GetDownloadedQMod(std::string id)
+		static std::vector<QMod *> CoreModsList()
 		{
-			auto search = m_DownloadedQMods->find(id);
-			if (search != m_DownloadedQMods->end())
-				return search->second;
+			std::unique_lock lock(m_RegistryLock);
 
-			return std::nullopt;
+			std::vector<QMod *> qmods;
+			qmods.reserve(m_CoreMods->size());
+
+			for (auto &pair : *m_CoreMods)
+				qmods.push_back(pair.second);
+
+			return qmods;
 		}
 
-		static bool IsCoreMod(QMod *qmod)
+		static void AddCoreMod(QMod *qmod)
 		{
-			return qmod->IsCoreMod();
+			std::unique_lock lock(m_RegistryLock);
+			m_CoreMods->emplace(std::string(qmod->m_Id), qmod);
 		}
+		static inline MetadataArena *GetMetadataArena() { return m_Metadata; }
 
-		bool IsCoreMod() const
+		/**
+		 * @brief Returns every local version of a mod, including the active one
+		 */
+		static std::vector<QMod *> GetVersions(const std::string &id)
 		{
-			for (std::pair<std::string, QMod *> coreModPair : *m_CoreMods)
-			{
-				if (coreModPair.first == m_Id)
-					return true;
-			}
+			std::unique_lock lock(m_RegistryLock);
 
-			return false;
+			auto search = m_QModVersions->find(id);
+			if (search != m_QModVersions->end())
+				return search->second;
+
+			return {};
 		}
 
 		/**
-		 * @brief Returns a vector of QMods that depend on this QMod
-		 * 
-		 * @param onlyInstalledMods If True, this will only return QMods that are installed
+		 * @brief Returns the highest local version of a mod that is in a version range, or null if none are
 		 */
-		std::vector<QMod *> FindModsDependingOn(bool onlyInstalledMods = false) const
+		static QMod *FindVersion(std::string_view id, Semver::RangeId range)
 		{
-			std::vector<QMod *> dependingOn;
+			QMod *best = nullptr;
 
-			for (std::pair<const std::string, QModUtils::QMod *> modPair : *m_DownloadedQMods)
+			for (QMod *version : GetVersions(std::string(id)))
 			{
-				bool isDependency = false;
-				for (Dependency dependency : *modPair.second->m_Dependencies)
-				{
-					if (dependency.id == m_Id)
-					{
-						isDependency = true;
-						break;
-					}
-				}
+				if (!Semver::Satisfies(version->m_VersionId, range))
+					continue;
 
-				if (isDependency && (!onlyInstalledMods || modPair.second->IsInstalled()))
-				{
-					dependingOn.push_back(modPair.second);
-				}
+				if (best == nullptr || Semver::Compare(version->m_VersionId, best->m_VersionId) > 0)
+					best = version;
 			}
 
-			return dependingOn;
+			return best;
 		}
 
-		static void DeleteTempDir()
+		/**
+		 * @brief Returns true if this is the version of the mod in the downloaded QMods, which is the one that gets installed
+		 */
+		bool IsActive() const
 		{
-			std::system("rm -f -r \"/sdcard/BMBFData/Mods/Temp/\"");
+			std::unique_lock lock(m_RegistryLock);
+
+			auto search = m_DownloadedQMods->find(std::string(m_Id));
+			return search != m_DownloadedQMods->end() && search->second == this;
 		}
 
-		// Used for std::map
-		bool operator<(const QMod& rhs) const
+		/**
+		 * @brief Makes this the active version of the mod. The previously active version is moved into the store, and can be brought back with Rollback
+		 * @details If the previous version was installed, this version is installed over its files, and only the files that differ are rewritten.
+		 * Nothing is downloaded or extracted twice, the versions are just moved between the mods folder and the store
+		 * 
+		 * @param reinstall If False, the previous version is uninstalled (without touching mods that depend on it), and this version isn't installed
+		 * @return Returns false if the previous version couldn't be uninstalled
+		 */
+		bool Activate(bool reinstall = true)
 		{
-			std::string lhsStr = m_Id;
-			std::string rhsStr = rhs.m_Id;
+			QMod *replaced = nullptr;
+			if (!SwitchActiveVersion(reinstall, &replaced))
+				return false;
 
-			std::transform(lhsStr.begin(), lhsStr.end(), lhsStr.begin(), [](unsigned char c){ return std::tolower(c); });
-			std::transform(rhsStr.begin(), rhsStr.end(), rhsStr.begin(), [](unsigned char c){ return std::tolower(c); });
+			if (replaced != nullptr)
+			{
+				std::optional<std::thread> thread = InstallAsync(new std::vector<std::string>(), true, replaced);
+				if (thread.has_value())
+					thread.value().join();
+			}
 
-			return lhsStr < rhsStr;
+			return true;
 		}
-	private:
-		inline static std::mutex m_InstallLock;
-		inline static std::mutex m_BmbfConfigLock;
-
-		inline static std::string m_AppPackageId = "";
-		inline static std::string m_AppPackageVersion = "";
 
-		inline static std::unordered_map<std::string, QMod *> *m_DownloadedQMods = new std::unordered_map<std::string, QMod *>();
-		inline static std::unordered_map<std::string, QMod *> *m_CoreMods = new std::unordered_map<std::string, QMod *>();
-
-		void GetBMBFData(bool verbos = true)
+		/**
+		 * @brief Switches a mod back to the version that was active before the last switch
+		 * 
+		 * @return Returns false if there's no version to go back to
+		 */
+		static bool Rollback(const std::string &id)
 		{
-			if (strcmp(m_PackageId.c_str(), "com.beatgames.beatsaber"))
+			QMod *previous = nullptr;
+
 			{
-				if (verbos)
-					getLogger().info("Failed to get BMBF Data, QMod isn't for Beat Saber! (PackageId: %s)", m_PackageId.c_str());
-				return;
+				std::unique_lock lock(m_RegistryLock);
+
+				auto search = m_PreviousVersions->find(id);
+				if (search != m_PreviousVersions->end())
+					previous = search->second;
 			}
 
-			// Read the config.json file
+			if (previous == nullptr)
+			{
+				QLOG_WARNING("Can't roll back \"%s\", there's no previous version", id.c_str());
+				return false;
+			}
+
+			return previous->Activate();
+		}
+
+		/**
+		 * @brief Deletes the least recently used inactive versions from the store, until it takes up at most maxBytes
+		 * @details Versions that a Rollback would go back to are always kept. Their covers stay in the cover cache until CompactCoverCache is called
+		 * 
+		 * @return The number of versions deleted
+		 */
+		static int CollectStoreGarbage(uint64_t maxBytes)
+		{
+			std::vector<FileUtils::DirEntry> files = FileUtils::ScanDir(Paths::Store(), ".qmod");
+
+			uint64_t totalBytes = 0;
+			for (const FileUtils::DirEntry &file : files)
+				totalBytes += file.size;
+
+			// Oldest first. Versions are touched when they're moved into the store, so this is the order they were last used in
+			std::sort(files.begin(), files.end(), [](const FileUtils::DirEntry &lhs, const FileUtils::DirEntry &rhs) { return lhs.mtime < rhs.mtime; });
+
+			int deleted = 0;
+			for (const FileUtils::DirEntry &file : files)
+			{
+				if (totalBytes <= maxBytes)
+					break;
+
+				std::string path = Paths::Store() + file.name;
+
+				{
+					std::unique_lock lock(m_RegistryLock);
+					QMod *version = nullptr;
+
+					for (auto &pair : *m_QModVersions)
+					{
+						for (QMod *qmod : pair.second)
+						{
+							if (qmod->m_Path == path)
+								version = qmod;
+						}
+					}
+
+					if (version != nullptr)
+					{
+						auto previous = m_PreviousVersions->find(std::string(version->m_Id));
+						if (version->IsActive() || (previous != m_PreviousVersions->end() && previous->second == version))
+							continue;
+
+						ForgetVersion(version);
+					}
+				}
+
+				if (unlink(path.c_str()) == 0)
+				{
+					totalBytes -= file.size;
+					deleted++;
+				}
+			}
+
+			QLOG_INFO("Removed %i old versions from the QMod store, it's now using %lu bytes", deleted, (unsigned long)totalBytes);
+
+			return deleted;
+		}
+
+		static inline const std::string &GetStorePath() { return Paths::Store(); }
+
+		/**
+		 * @brief Sets how QMods put their files in place. See InstallMode
+		 * @details Mods that are already installed can be uninstalled with either mode
+		 */
+		static void SetInstallMode(InstallMode mode) { m_InstallMode.store(mode); }
+		static InstallMode GetInstallMode() { return m_InstallMode.load(); }
+
+		/**
+		 * @brief Returns true if the file at this QMod's path isn't the one it was loaded from, as it was overwritten or replaced since
+		 * @details Moving the QMod in and out of the store keeps its inode, size and modification time, so that isn't seen as a change
+		 */
+		bool FileChanged()
+		{
+			FileUtils::DirEntry identity;
+			if (!FileUtils::StatAt(AT_FDCWD, m_Path.c_str(), identity))
+				return true;
+
+			return identity.inode != m_FileIdentity.inode || identity.size != m_FileIdentity.size || identity.mtime != m_FileIdentity.mtime;
+		}
+
+		/**
+		 * @brief A hash of the .qmod's central directory, which lists every file's size and CRC-32. Used to key its unpacked copy, worked out the first time it's needed
+		 */
+		uint64_t ArchiveHash()
+		{
+			// Any thread may be first to work it out, and they all get the same hash, so whichever store lands is fine
+			uint64_t hash = m_ArchiveHash.load(std::memory_order_relaxed);
+			if (hash != 0)
+				return hash;
+
+			hash = ZipUtils::CentralDirectoryHash(m_Path);
+
+			if (hash == 0)
+				hash = FileUtils::HashFile(m_Path);
+
+			m_ArchiveHash.store(hash, std::memory_order_relaxed);
+			return hash;
+		}
+
+		/**
+		 * @brief The folder this QMod's unpacked copy is (or would be) kept in, for linked installs
+		 */
+		std::string GetUnpackedDir()
+		{
+			return string_format("%s%016llx/", Paths::Unpacked().c_str(), (unsigned long long)ArchiveHash());
+		}
+
+		/**
+		 * @brief Gets this QMod's cover image from the cover cache, reading it out of the .qmod the first time it's asked for
+		 * @details Every cover lives in one packed file, so showing a whole mod list's covers only needs the one mapping
+		 * 
+		 * @return Returns an empty view if the mod has no cover. The view stays valid until the cover cache is compacted
+		 */
+		std::string_view GetCoverImageData()
+		{
+			if (m_CoverImage == "")
+				return "";
+
+			uint64_t key = ArchiveHash();
+
+			std::string_view cached = GetCoverCache().Get(key);
+			if (!cached.empty())
+				return cached;
+
+			ZipUtils::ZipReader zip;
+			const ZipUtils::ZipEntry *entry;
+			std::vector<char> buffer;
+
+			if (!zip.Open(m_Path) || (entry = zip.Find(m_CoverImage)) == nullptr || !zip.Read(*entry, buffer))
+			{
+				QLOG_WARNING("Failed to read the cover image \"%s\" of \"%s\"", m_CoverImage.data(), m_Id.data());
+				return "";
+			}
+
+			// Read null terminates the buffer
+			GetCoverCache().Put(key, std::string_view(buffer.data(), buffer.size() - 1));
+
+			return GetCoverCache().Get(key);
+		}
+
+		/**
+		 * @brief Gets the path of this QMod's cover image in BMBF's mods folder, extracting it only if it isn't there yet
+		 * @details The file name has the archive hash in it, so if the file exists it's this QMod's cover, and it never has to be written again
+		 * 
+		 * @return Returns an empty string if the mod has no cover, or it couldn't be extracted
+		 */
+		std::string GetCoverImagePath()
+		{
+			if (m_CoverImage == "")
+				return "";
+
+			std::string path = string_format("%s%s_%016llx_%s", Paths::Mods().c_str(), m_Id.data(), (unsigned long long)ArchiveHash(), m_CoverImage.data());
+			if (access(path.c_str(), F_OK) == 0)
+				return path;
+
+			// Stored covers are copied straight from the .qmod, so there's no need to go through the cover cache
+			ZipUtils::ZipReader zip;
+			zip.Open(m_Path);
+
+			if (!ExtractFile(zip, m_CoverImage, path))
+				return "";
+
+			return path;
+		}
+
+		/**
+		 * @brief Drops the covers of QMods that are gone from the cover cache
+		 * @details Never done automatically, as every view from GetCoverImageData is invalid after this. Only call it once nothing is showing covers, like before a rescan
+		 * 
+		 * @return The number of bytes freed
+		 */
+		static size_t CompactCoverCache()
+		{
+			std::unordered_set<uint64_t> liveKeys;
+			std::vector<QMod *> versions;
+
+			{
+				std::unique_lock lock(m_RegistryLock);
+
+				for (auto &pair : *m_QModVersions)
+					versions.insert(versions.end(), pair.second.begin(), pair.second.end());
+			}
+
+			// Hashing can read the .qmod, so it's done without the lock held
+			for (QMod *qmod : versions)
+			{
+				if (qmod->m_CoverImage != "")
+					liveKeys.insert(qmod->ArchiveHash());
+			}
+
+			return GetCoverCache().Compact(liveKeys);
+		}
+
+		/**
+		 * @brief Removes a QMod from the versions of its mod, and from the downloaded QMods if it was the active version
+		 * @details An operation may still be using the QMod, so it isn't deleted here. It's kept until the next rescan, which frees it along with every other QMod
+		 */
+		static void ForgetVersion(QMod *qmod)
+		{
+			std::unique_lock lock(m_RegistryLock);
+			m_ForgottenQMods->push_back(qmod);
+
+			std::string id = std::string(qmod->m_Id);
+
+			if (qmod->IsActive())
+				m_DownloadedQMods->erase(id);
+
+			auto previous = m_PreviousVersions->find(id);
+			if (previous != m_PreviousVersions->end() && previous->second == qmod)
+				m_PreviousVersions->erase(previous);
+
+			auto search = m_QModVersions->find(id);
+			if (search == m_QModVersions->end())
+				return;
+
+			std::erase(search->second, qmod);
+			if (search->second.empty())
+				m_QModVersions->erase(search);
+		}
+
+		/**
+		 * @brief Unregisters and deletes a QMod that was just downloaded but turned out to be the wrong one, and removes its file
+		 * @details Unlike ForgetVersion, the QMod is deleted straight away, so only use this on a QMod nothing else has been handed yet
+		 *
+		 * @param path Where it was downloaded to, as the QMod doesn't know its path if it failed to load
+		 */
+		static void DiscardDownload(QMod *qmod, const std::string &path)
+		{
+			if (qmod->m_Valid)
+			{
+				ForgetVersion(qmod);
+
+				std::unique_lock lock(m_RegistryLock);
+				std::erase(*m_ForgottenQMods, qmod);
+			}
+
+			unlink(path.c_str());
+			delete qmod;
+		}
+
+		/**
+		 * @brief Deletes every downloaded QMod and resets the metadata arena, so a rescan can reuse its memory
+		 * @details Every QMod pointer (and every view returned from them) is invalid after this, so make sure nothing is being installed first!
+		 */
+		static void ClearDownloadedQMods()
+		{
+			std::unique_lock lock(m_RegistryLock);
+
+			for (auto &pair : *m_QModVersions)
+			{
+				for (QMod *qmod : pair.second)
+					delete qmod;
+			}
+
+			for (QMod *qmod : *m_ForgottenQMods)
+				delete qmod;
+
+			m_ForgottenQMods->clear();
+			m_QModVersions->clear();
+			m_PreviousVersions->clear();
+			m_DownloadedQMods->clear();
+			m_CoreMods->clear();
+			m_Metadata->Reset();
+		}
+
+		/**
+		 * @brief Finishes or undoes every install and uninstall that was cut short, from the journal they left behind
+		 * @details An install that never got as far as config.json is undone, as config.json still says it isn't installed. Anything else is finished.
+		 * Call this once the QMods have been read, and before anything is installed
+		 */
+		static void RecoverFromJournal()
+		{
+			TRACE_SCOPE("QMod", "RecoverFromJournal");
+
+			std::vector<Journal::Pending> pending = Journal::ReadIncomplete();
+
+			for (const Journal::Pending &transaction : pending)
+			{
+				QMod *qmod = nullptr;
+
+				for (QMod *version : GetVersions(transaction.modId))
+				{
+					if (version->m_Version == transaction.version)
+						qmod = version;
+				}
+
+				if (qmod == nullptr)
+				{
+					QLOG_WARNING("Found an unfinished %s of \"%s\" %s, but that QMod is gone. Leaving its files as they are", transaction.operation.c_str(), transaction.modId.c_str(), transaction.version.c_str());
+					continue;
+				}
+
+				QLOG_INFO("Recovering an unfinished %s of \"%s\" %s", transaction.operation.c_str(), transaction.modId.c_str(), transaction.version.c_str());
+				qmod->Recover(transaction);
+			}
+
+			if (!Journal::Reset())
+				QLOG_WARNING("Failed to empty the journal (errno %i), its transactions will be recovered again on the next start", errno);
+
+			// Recovery changes which mods are installed without going through the library references
+			if (!pending.empty())
+				RebuildLibraryRegistry();
+		}
+
+		/**
+		 * @brief Rebuilds which installed mods hold each library, from the downloaded QMods. Call this after a rescan
+		 */
+		static void RebuildLibraryRegistry()
+		{
+			TRACE_SCOPE("QMod", "RebuildLibraryRegistry");
+
+			std::vector<std::pair<std::string_view, std::vector<std::string_view>>> owners;
+
+			for (QMod *qmod : DownloadedQMods())
+			{
+				ModState state = qmod->State();
+
+				if ((state == ModState::Installed || state == ModState::Installing) && !qmod->m_LibraryFiles.empty())
+					owners.emplace_back(qmod->m_Id, std::vector<std::string_view>(qmod->m_LibraryFiles.begin(), qmod->m_LibraryFiles.end()));
+			}
+
+			LibraryRegistry::Rebuild(owners);
+		}
+
+		void SetName(std::string val) { m_Name = m_Metadata->Store(val); }
+		void SetId(std::string val) { m_Id = m_Metadata->Intern(val); }
+		void SetDescription(std::string val) { m_Description = m_Metadata->Store(val); }
+		void SetAuthor(std::string val) { m_Author = m_Metadata->Intern(val); }
+		void SetPorter(std::string val) { m_Porter = m_Metadata->Intern(val); }
+		void SetVersion(std::string val)
+		{
+			m_Version = m_Metadata->Intern(val);
+			m_VersionId = Semver::InternVersion(m_Version);
+		}
+		void SetCoverImage(std::string val) { m_CoverImage = m_Metadata->Store(val); }
+
+		void SetPackageId(std::string val) { m_PackageId = m_Metadata->Intern(val); }
+		void SetPackageVersion(std::string val) { m_PackageVersion = m_Metadata->Intern(val); }
+
+		// These are copied into the metadata arena, so the vectors can be freed afterwards
+
+		void SetModFiles(std::vector<std::string> *val) { m_ModFiles = StoreStrings(*val); }
+		void SetLibraryFiles(std::vector<std::string> *val) { m_LibraryFiles = StoreStrings(*val); }
+		void SetDependencies(std::vector<Dependency> *val)
+		{
+			m_Dependencies = m_Metadata->AllocArray<Dependency>(val->size());
+
+			for (size_t i = 0; i < val->size(); i++)
+				m_Dependencies[i] = {m_Metadata->Intern(val->at(i).id), m_Metadata->Intern(val->at(i).version), m_Metadata->Intern(val->at(i).downloadIfMissing), Semver::InternRange(val->at(i).version)};
+		}
+		void SetFileCopies(std::vector<FileCopy> *val)
+		{
+			m_FileCopies = m_Metadata->AllocArray<FileCopy>(val->size());
+
+			for (size_t i = 0; i < val->size(); i++)
+				m_FileCopies[i] = {m_Metadata->Store(val->at(i).name), m_Metadata->Store(val->at(i).destination)};
+		}
+
+		// We must called UpdateBMBFData when changing the path, cus it'll break many things if we dont move the qmod
+		void SetPath(std::string val)
+		{
+			m_Path = val;
+			UpdateBMBFData();
+		}
+
+		void SetUninstallable(bool val) { m_Uninstallable = val; }
+
+		/**
+		 * @brief Returns a QMod with the given ID
+		 * 
+		 * @param id The QMod's ID
+		 */
+		static std::optional<QMod *> GetDownloadedQMod(std::string id)
+		{
+			std::unique_lock lock(m_RegistryLock);
+
+			auto search = m_DownloadedQMods->find(id);
+			if (search != m_DownloadedQMods->end())
+				return search->second;
+
+			return std::nullopt;
+		}
+
+		static bool IsCoreMod(QMod *qmod)
+		{
+			return qmod->IsCoreMod();
+		}
+
+		bool IsCoreMod() const
+		{
+			std::unique_lock lock(m_RegistryLock);
+
+			for (std::pair<std::string, QMod *> coreModPair : *m_CoreMods)
+			{
+				if (coreModPair.first == m_Id)
+					return true;
+			}
+
+			return false;
+		}
+
+		/**
+		 * @brief Returns a vector of QMods that depend on this QMod
+		 * 
+		 * @param onlyInstalledMods If True, this will only return QMods that are installed
+		 */
+		std::vector<QMod *> FindModsDependingOn(bool onlyInstalledMods = false) const
+		{
+			std::vector<QMod *> dependingOn;
+
+			for (QMod *qmod : DownloadedQMods())
+			{
+				bool isDependency = false;
+				for (Dependency dependency : qmod->m_Dependencies)
+				{
+					if (dependency.id == m_Id)
+					{
+						isDependency = true;
+						break;
+					}
+				}
+
+				if (isDependency && (!onlyInstalledMods || qmod->IsInstalled()))
+				{
+					dependingOn.push_back(qmod);
+				}
+			}
+
+			return dependingOn;
+		}
+
+		/**
+		 * @brief Checks that an installed QMod still has all of its mod and library files in place
+		 * @details If something else removed them, the QMod is moved back to the Downloaded state
+		 *
+		 * @return Returns false if the QMod was installed but is missing files
+		 */
+		bool VerifyInstalledFiles()
+		{
+			if (!IsInstalled())
+				return true;
+
+			bool filesMissing = false;
+
+			for (std::string_view modFile : m_ModFiles)
+			{
+				if (access(string_format("%s%s", Paths::GameMods().c_str(), modFile.data()).c_str(), F_OK) != 0)
+					filesMissing = true;
+			}
+
+			for (std::string_view libFile : m_LibraryFiles)
+			{
+				if (access(string_format("%s%s", Paths::GameLibs().c_str(), libFile.data()).c_str(), F_OK) != 0)
+					filesMissing = true;
+			}
+
+			if (!filesMissing)
+				return true;
+
+			// If an install / uninstall has already claimed the mod, it's the one moving the files around
+			if (TryTransition(ModState::Installed, ModState::Downloaded))
+				QLOG_WARNING("Files for \"%s\" were removed from outside of QModUtils, marking it as uninstalled", m_Id.data());
+
+			return false;
+		}
+
+		static void DeleteTempDir()
+		{
+			Metrics::System(string_format("rm -f -r \"%s\"", Paths::Temp().c_str()));
+		}
+
+		// Used for std::map
+		bool operator<(const QMod& rhs) const
+		{
+			std::string lhsStr = std::string(m_Id);
+			std::string rhsStr = std::string(rhs.m_Id);
+
+			std::transform(lhsStr.begin(), lhsStr.end(), lhsStr.begin(), [](unsigned char c){ return std::tolower(c); });
+			std::transform(rhsStr.begin(), rhsStr.end(), rhsStr.begin(), [](unsigned char c){ return std::tolower(c); });
+
+			return lhsStr < rhsStr;
+		}
+	private:
+		inline static std::mutex m_InstallLock;
+		inline static std::mutex m_BmbfConfigLock;
+
+		// What we last wrote to config.json, and the file's identity right after. It's reused instead of reading the file, for as long as nothing else has changed it
+		inline static std::mutex m_ConfigCacheLock;
+		inline static std::string m_ConfigCache;
+		inline static FileUtils::DirEntry m_ConfigIdentity;
+		inline static bool m_ConfigCached = false;
+
+		// Guarded by m_BmbfConfigLock
+		inline static int m_ConfigBatchDepth = 0;
+		inline static std::vector<std::pair<std::string_view, QMod *>> m_BatchedConfig;
+
+		inline static std::string m_AppPackageId = "";
+		inline static std::string m_AppPackageVersion = "";
+
+		// Guards m_DownloadedQMods, m_CoreMods, m_QModVersions, m_PreviousVersions and m_ForgottenQMods. Recursive, so a caller holding LockRegistry can still use the getters
+		inline static std::recursive_mutex m_RegistryLock;
+
+		inline static std::unordered_map<std::string, QMod *> *m_DownloadedQMods = new std::unordered_map<std::string, QMod *>();
+		inline static std::unordered_map<std::string, QMod *> *m_CoreMods = new std::unordered_map<std::string, QMod *>();
+
+		// Every local version of each mod, the active one included. m_DownloadedQMods only holds the active ones
+		inline static std::unordered_map<std::string, std::vector<QMod *>> *m_QModVersions = new std::unordered_map<std::string, std::vector<QMod *>>();
+
+		// The version that was active before the last switch, for each mod
+		inline static std::unordered_map<std::string, QMod *> *m_PreviousVersions = new std::unordered_map<std::string, QMod *>();
+
+		// QMods that were forgotten while something may still have been using them, freed on the next rescan
+		inline static std::vector<QMod *> *m_ForgottenQMods = new std::vector<QMod *>();
+
+		inline static std::atomic<InstallMode> m_InstallMode = InstallMode::Extract;
+
+		inline static MetadataArena *m_Metadata = new MetadataArena();
+
+		// Made on first use, so the pack goes under the root set with Paths::SetRoot
+		static CoverCache &GetCoverCache()
+		{
+			static CoverCache *cache = new CoverCache(Paths::CoverCache());
+			return *cache;
+		}
+
+		// Reused between reads so parsing doesn't reallocate a buffer for every file. Kept seperate as the mod.json is still in use while the config.json is read
+		inline static thread_local std::vector<char> t_ManifestBuffer;
+		inline static thread_local std::vector<char> t_ConfigBuffer;
+
+		std::span<std::string_view> StoreStrings(const std::vector<std::string> &strings)
+		{
+			std::span<std::string_view> stored = m_Metadata->AllocArray<std::string_view>(strings.size());
+
+			for (size_t i = 0; i < strings.size(); i++)
+				stored[i] = m_Metadata->Intern(strings[i]);
+
+			return stored;
+		}
+
+		/**
+		 * @brief Reads the mod.json into this QMod, storing everything in the metadata arena
+		 */
+		void ReadManifest(const rapidjson::Value &document);
+
+		/**
+		 * @brief Writes this QMod's BMBF "config.json" entry
+		 *
+		 * @param existing The entry this replaces, if there is one. Its members that aren't in the field table are kept
+		 */
+		void WriteBMBFEntry(Fields::JsonWriter &writer, const rapidjson::Value *existing = nullptr) const;
+
+		// A change to a mod's "config.json" entry. A null QMod removes the entry
+		using ConfigChange = std::pair<std::string_view, QMod *>;
+
+		/**
+		 * @brief Writes BMBF's "config.json" back out, with the changed mods' entries written in place of the existing ones
+		 * 
+		 * @param changes The entries to replace (or add if there isn't one), and to remove
+		 * @return Returns how many of the changed mods had an existing entry
+		 */
+		static int WriteBMBFConfig(const rapidjson::Document &document, Fields::JsonWriter &writer, const std::vector<ConfigChange> &changes)
+		{
+			std::vector<bool> found(changes.size(), false);
+
+			writer.StartObject();
+
+			for (auto member = document.MemberBegin(); member != document.MemberEnd(); ++member)
+			{
+				writer.Key(member->name.GetString(), member->name.GetStringLength());
+
+				if (Fields::ToView(member->name) != "Mods" || !member->value.IsArray())
+				{
+					member->value.Accept(writer);
+					continue;
+				}
+
+				writer.StartArray();
+
+				for (auto mod = member->value.Begin(); mod != member->value.End(); ++mod)
+				{
+					if (mod->IsObject())
+					{
+						auto id = mod->FindMember("Id");
+						auto change = changes.end();
+
+						if (id != mod->MemberEnd() && id->value.IsString())
+						{
+							std::string_view entryId = Fields::ToView(id->value);
+							change = std::find_if(changes.begin(), changes.end(), [&](const ConfigChange &candidate) { return candidate.first == entryId; });
+						}
+
+						// When removing only the first entry goes, when updating every entry with the id is replaced
+						if (change != changes.end() && (change->second != nullptr || !found[change - changes.begin()]))
+						{
+							found[change - changes.begin()] = true;
+
+							// Keys BMBF wrote that aren't in the field table are kept
+							if (change->second != nullptr)
+								change->second->WriteBMBFEntry(writer, &*mod);
+
+							continue;
+						}
+					}
+
+					mod->Accept(writer);
+				}
+
+				for (size_t i = 0; i < changes.size(); i++)
+				{
+					if (!found[i] && changes[i].second != nullptr)
+						changes[i].second->WriteBMBFEntry(writer);
+				}
+
+				writer.EndArray();
+			}
+
+			writer.EndObject();
+
+			return (int)std::count(found.begin(), found.end(), true);
+		}
+
+		/**
+		 * @brief Adds a change to the current batch, replacing any earlier change to the same mod. Call with m_BmbfConfigLock held
+		 */
+		static void BatchConfigChange(QMod *qmod, bool remove = false)
+		{
+			QMod *entry = remove ? nullptr : qmod;
+
+			auto existing = std::find_if(m_BatchedConfig.begin(), m_BatchedConfig.end(), [&](const ConfigChange &change) { return change.first == qmod->m_Id; });
+			if (existing != m_BatchedConfig.end())
+				existing->second = entry;
+			else
+				m_BatchedConfig.emplace_back(qmod->m_Id, entry);
+		}
+
+		/**
+		 * @brief Writes every batched change to "config.json" at once. Call with m_BmbfConfigLock held
+		 *
+		 * @return Returns false if "config.json" couldn't be read or written, in which case the changes are dropped
+		 */
+		static bool CommitConfigBatch()
+		{
+			if (m_BatchedConfig.empty())
+				return true;
+
+			TRACE_SCOPE("Config", "CommitConfigBatch");
+
+			std::vector<ConfigChange> changes;
+			changes.swap(m_BatchedConfig);
+
+			rapidjson::Document document;
+			if (!ReadConfig(t_ConfigBuffer) || document.ParseInsitu(t_ConfigBuffer.data()).HasParseError() || !document.HasMember("Mods") || !document["Mods"].IsArray())
+			{
+				QLOG_ERROR("Failed to read BMBF's config.json, dropped the changes to %zu mods", changes.size());
+				return false;
+			}
+
+			rapidjson::StringBuffer buffer;
+			Fields::JsonWriter writer(buffer);
+
+			WriteBMBFConfig(document, writer, changes);
+
+			if (!WriteConfig(buffer.GetString(), buffer.GetSize()))
+			{
+				QLOG_ERROR("Failed to save BMBF Data for %zu mods (errno %i), config.json was left as it was", changes.size(), errno);
+				return false;
+			}
+
+			QLOG_INFO("Saved BMBF Data for %zu mods at once", changes.size());
+			return true;
+		}
+
+		/**
+		 * @brief Reads config.json into a buffer, null terminated so it can be parsed in-situ
+		 * @details Uses what we last wrote if the file's inode, size and modification time haven't changed since, so a run of updates only stats the file
+		 */
+		static bool ReadConfig(std::vector<char> &buffer)
+		{
+			FileUtils::DirEntry identity;
+			bool exists = FileUtils::StatAt(AT_FDCWD, Paths::Config().c_str(), identity);
+
+			{
+				std::unique_lock lock(m_ConfigCacheLock);
+
+				if (exists && m_ConfigCached && identity.inode == m_ConfigIdentity.inode && identity.size == m_ConfigIdentity.size && identity.mtime == m_ConfigIdentity.mtime)
+				{
+					buffer.assign(m_ConfigCache.begin(), m_ConfigCache.end());
+					buffer.push_back('\0');
+					return true;
+				}
+			}
+
+			Metrics::Add(Metrics::Counter::ConfigReads);
+			return JsonUtils::ReadFile(Paths::Config(), buffer);
+		}
+
+		/**
+		 * @brief Replaces config.json atomically, see FileUtils::WriteFileAtomic, and remembers what was written for ReadConfig
+		 */
+		static bool WriteConfig(const char *data, size_t size)
+		{
+			Metrics::Add(Metrics::Counter::ConfigWrites);
+			bool written = FileUtils::WriteFileAtomic(Paths::Config(), data, size);
+
+			FileUtils::DirEntry identity;
+			std::unique_lock lock(m_ConfigCacheLock);
+
+			m_ConfigCached = written && FileUtils::StatAt(AT_FDCWD, Paths::Config().c_str(), identity);
+			if (m_ConfigCached)
+			{
+				m_ConfigCache.assign(data, size);
+				m_ConfigIdentity = identity;
+			}
+
+			return written;
+		}
+
+		void GetBMBFData(bool verbos = true)
+		{
+			if (m_PackageId != "com.beatgames.beatsaber")
+			{
+				if (verbos)
+					QLOG_INFO("Failed to get BMBF Data, QMod isn't for Beat Saber! (PackageId: %s)", m_PackageId.data());
+				return;
+			}
+
+			// Find our entry in the config.json file. Only our entry is read, and parsing stops as soon as it's been found
+
+			JsonUtils::BMBFModData data;
+			JsonUtils::FindResult result = ReadConfig(t_ConfigBuffer) ? JsonUtils::FindBMBFModDataInsitu(t_ConfigBuffer, m_Id, data) : JsonUtils::FindResult::Invalid;
+
+			ASSERT(result != JsonUtils::FindResult::Invalid, GetFileName(m_Path), verbos);
+
+			if (result == JsonUtils::FindResult::Found)
+			{
+				m_CoverImageFilename = std::move(data.coverImageFilename);
+				m_State.store(data.installed ? ModState::Installed : ModState::Downloaded, std::memory_order_release);
+				m_Uninstallable = data.uninstallable;
+			}
+			else
+			{
+				// Couldnt Find existing BMBF Data, So just set default values;
+				m_CoverImageFilename = "";
+				m_State.store(ModState::Downloaded, std::memory_order_release);
+				m_Uninstallable = true;
+			}
+		}
+
+		// How extracting or placing a QMod's files ended
+		enum class FilesResult : uint8_t
+		{
+			Done,
+			Cancelled,
+			Failed // A file couldn't be extracted
+		};
+
+		/**
+		 * @return Returns Cancelled if the operation was cancelled part way through, or Failed if a file couldn't be extracted
+		 */
+		FilesResult ExtractQMod(const std::string &tmpDir)
+		{
+			TRACE_SCOPE_ARG("QMod", "ExtractQMod", m_Id);
+
+			ZipUtils::ZipReader zip;
+			zip.Open(m_Path);
+
+			// Mods, Libs and File Copies each go in their own folder
+			for (const PayloadFile &file : GetPayload())
+			{
+				if (Operation::IsCancelled())
+					return FilesResult::Cancelled;
+
+				std::string extractionPath = tmpDir + file.folder + std::string(file.entry);
+
+				// Already extracted by Prefetch. Extracted files are only renamed into place once complete, so a matching one is whole
+				const ZipUtils::ZipEntry *entry = zip.IsOpen() ? zip.Find(file.entry) : nullptr;
+				if (entry != nullptr && ZipUtils::MatchesEntry(extractionPath, *entry))
+					continue;
+
+				// Shared with the copy another mod has in place, so it won't be placed
+				if (file.library && entry != nullptr && LibraryRegistry::IsSharedWith(file.entry, m_Id, *entry))
+					continue;
+
+				if (!ExtractFile(zip, file.entry, extractionPath))
+				{
+					QLOG_ERROR("Failed to extract \"%s\" from \"%s\"", file.entry.data(), m_Path.c_str());
+					return FilesResult::Failed;
+				}
+			}
+
+			return FilesResult::Done;
+		}
+
+		/**
+		 * @brief Extracts a single file from this QMod, in process if possible
+		 * @details Falls back to unzip if the QMod couldn't be opened, or uses something other than store / deflate
+		 */
+		bool ExtractFile(ZipUtils::ZipReader &zip, std::string_view name, const std::string &destination)
+		{
+			TRACE_SCOPE_ARG("File", "Extract", name);
+
+			FileUtils::MakeDirs(destination.substr(0, destination.find_last_of('/')));
+
+			if (zip.IsOpen() && zip.Extract(name, destination))
+				return true;
+
+			if (Operation::IsCancelled())
+				return false;
+
+			QLOG_WARNING("Failed to extract \"%s\" from \"%s\" in process, falling back to unzip", name.data(), m_Path.c_str());
+
+			return Metrics::System(string_format("unzip -o -p \"%s\" \"%s\" > \"%s\"", m_Path.c_str(), name.data(), destination.c_str())) == 0;
+		}
+
+		/**
+		 * @brief Makes this the active version of the mod, without installing it
+		 * 
+		 * @param keepFiles If true and the previous version was installed, its files are left in place for this version to be installed over
+		 * @param replaced Set to the previous version if its files were kept
+		 * @return Returns false if the previous version couldn't be uninstalled
+		 */
+		bool SwitchActiveVersion(bool keepFiles, QMod **replaced)
+		{
+			if (!m_Valid)
+				return false;
 
-			std::ifstream configFile("/sdcard/BMBFData/config.json");
-			ASSERT(configFile.good(), GetFileName(m_Path), verbos);
+			std::string id = std::string(m_Id);
+			QMod *current = GetDownloadedQMod(id).value_or(nullptr);
 
-			std::stringstream configJson;
-			configJson << configFile.rdbuf();
+			if (current == this)
+				return true;
 
-			rapidjson::Document document;
+			bool wasInstalled = current != nullptr && current->IsInstalled();
 
-			ASSERT(!document.Parse(configJson.str().c_str()).HasParseError(), GetFileName(m_Path), verbos);
-			ASSERT(document.HasMember("Mods") && document["Mods"].IsArray(), GetFileName(m_Path), verbos);
+			if (current != nullptr)
+			{
+				// Kept files are left installed, but the previous version no longer owns them
+				if (wasInstalled && keepFiles && current->TryTransition(ModState::Installed, ModState::Downloaded))
+					*replaced = current;
+				else if (wasInstalled)
+					current->Uninstall(true, true, false);
+
+				if (current->State() != ModState::Downloaded)
+				{
+					QLOG_ERROR("Failed to switch \"%s\" to version %s, version %s couldn't be uninstalled", m_Id.data(), m_Version.data(), current->m_Version.data());
+					return false;
+				}
+
+				current->MoveToStore();
+
+				std::unique_lock lock(m_RegistryLock);
+				(*m_PreviousVersions)[id] = current;
+			}
+
+			MoveOutOfStore();
+
+			{
+				std::unique_lock lock(m_RegistryLock);
+				(*m_DownloadedQMods)[id] = this;
+			}
+
+			QLOG_INFO("Switched \"%s\" to version %s", m_Id.data(), m_Version.data());
+
+			return true;
+		}
+
+		struct PayloadFile
+		{
+			std::string_view entry; // The file's name in the .qmod
+			std::string destination;
+			bool library;
+			const char *folder; // The folder it's extracted to, under the temp or unpacked folder
+		};
+
+		/**
+		 * @brief Lists every file this QMod puts in place, and where it goes
+		 */
+		std::vector<PayloadFile> GetPayload() const
+		{
+			std::vector<PayloadFile> payload;
+			payload.reserve(m_ModFiles.size() + m_LibraryFiles.size() + m_FileCopies.size());
+
+			for (std::string_view mod : m_ModFiles)
+				payload.push_back({mod, string_format("%s%s", Paths::GameMods().c_str(), mod.data()), false, "Mods/"});
+
+			for (std::string_view lib : m_LibraryFiles)
+				payload.push_back({lib, string_format("%s%s", Paths::GameLibs().c_str(), lib.data()), true, "Libs/"});
+
+			for (const FileCopy &fileCopy : m_FileCopies)
+				payload.push_back({fileCopy.name, std::string(fileCopy.destination), false, "FileCopies/"});
 
-			const auto &mods = document["Mods"].GetArray();
+			return payload;
+		}
+
+		/**
+		 * @brief Returns true if a library file is also used by another mod that is installed, or being installed
+		 */
+		bool IsLibraryUsedElsewhere(std::string_view libFile) const
+		{
+			return LibraryRegistry::IsHeldElsewhere(libFile, m_Id);
+		}
+
+		/**
+		 * @brief Brings installed files in line with this QMod, rewriting only the ones that differ from it
+		 * @details A file is unchanged if its size and CRC-32 match the .qmod's central directory, so unchanged files are never extracted.
+		 * Files from the previous install that this QMod doesn't ship are removed, apart from libraries other mods still use
+		 * 
+		 * @param previous The QMod whose files are installed, this QMod when reloading it
+		 * @param transaction Gets the files that will be removed as its plan, and is begun before anything is touched. Rewritten files aren't planned, as recovery just reconciles again
+		 * @return Returns Cancelled if the operation was cancelled, or Failed if a file couldn't be extracted. Either way nothing is removed, and the files already rewritten are whole
+		 */
+		FilesResult ReconcileFiles(QMod *previous, Journal::Transaction &transaction)
+		{
+			TRACE_SCOPE_ARG("QMod", "ReconcileFiles", m_Id);
+
+			// Without the central directory every file would go through unzip, which writes straight over the installed file
+			ZipUtils::ZipReader zip;
+			if (!zip.Open(m_Path))
+			{
+				QLOG_ERROR("Failed to read the central directory of \"%s\", not touching its installed files", m_Path.c_str());
+				return FilesResult::Failed;
+			}
+
+			std::vector<PayloadFile> payload = GetPayload();
+			int unchanged = 0, rewritten = 0, removed = 0;
+
+			std::vector<std::string> removals;
 
-			bool foundMod = false;
-			for (rapidjson::SizeType i = 0; i < mods.Size(); i++)
+			if (previous != this)
 			{
-				// Find our mod id, then read the data
+				for (const PayloadFile &file : previous->GetPayload())
+				{
+					bool stillShipped = std::any_of(payload.begin(), payload.end(), [&](const PayloadFile &newFile) { return newFile.destination == file.destination; });
+					if (stillShipped || (file.library && !LibraryRegistry::Release(file.entry, m_Id)))
+						continue;
+
+					transaction.Remove(false, "", file.destination);
+					removals.push_back(file.destination);
+				}
+			}
+
+			if (!transaction.Begin())
+			{
+				QLOG_ERROR("Failed to write the journal (errno %i), not touching the files of \"%s\"", errno, m_Id.data());
+				return FilesResult::Failed;
+			}
 
-				auto &mod = mods[i];
-				std::string id = GET_STRING("Id", mod);
+			for (const PayloadFile &file : payload)
+			{
+				if (Operation::IsCancelled())
+					return FilesResult::Cancelled;
+
+				const ZipUtils::ZipEntry *entry = zip.Find(file.entry);
 
-				if (id != m_Id)
+				if (file.library && LibraryRegistry::Acquire(file.entry, m_Id, entry) == LibraryRegistry::Claim::Conflict)
+					QLOG_WARNING("\"%s\" ships a different \"%s\" than another installed mod, it will replace theirs", m_Id.data(), file.entry.data());
+
+				if (entry != nullptr && ZipUtils::MatchesEntry(file.destination, *entry))
+				{
+					Metrics::Add(Metrics::Counter::BytesReused, entry->uncompressedSize);
+					unchanged++;
 					continue;
-				foundMod = true;
+				}
+
+				// Extracted straight over the old file, which is only replaced once the new one is complete
+				if (!ExtractFile(zip, file.entry, file.destination))
+				{
+					if (Operation::IsCancelled())
+						return FilesResult::Cancelled;
+
+					QLOG_ERROR("Failed to extract \"%s\" from \"%s\"", file.entry.data(), m_Path.c_str());
+					return FilesResult::Failed;
+				}
+
+				rewritten++;
 
-				m_CoverImageFilename = GET_STRING("CoverImageFilename", mod);
-				m_Installed = GET_BOOL("Installed", mod);
-				m_Uninstallable = GET_BOOL("Uninstallable", mod);
+				if (file.library && entry != nullptr)
+					LibraryRegistry::Placed(file.entry, *entry);
 			}
 
-			// Couldnt Find existing BMBF Data, So just set default values;
-			if (!foundMod)
+			for (const std::string &destination : removals)
 			{
-				m_CoverImageFilename = "";
-				m_Installed = false;
-				m_Uninstallable = true;
+				QLOG_DETAIL("Removing \"%s\", which \"%s\" %s no longer ships", destination.c_str(), m_Id.data(), m_Version.data());
+
+				if (unlink(destination.c_str()) == 0)
+					removed++;
+			}
+
+			QLOG_INFO("Reconciled the files of \"%s\": %i unchanged, %i rewritten, %i removed", m_Id.data(), unchanged, rewritten, removed);
+			return FilesResult::Done;
+		}
+
+		/**
+		 * @brief Puts every file in place from scratch, either extracted or linked depending on the install mode
+		 * @details Checks for cancellation between files. If the operation is cancelled or a file can't be put in place, the files already in place are removed again
+		 *
+		 * @param transaction Gets every placement as its plan, and is begun once the files have been extracted
+		 * @return Returns Cancelled if the operation was cancelled, or Failed if the QMod couldn't be extracted or a file couldn't be put in place. Either way none of its files are left in place
+		 */
+		FilesResult PlaceAllFiles(Journal::Transaction &transaction)
+		{
+			TRACE_SCOPE_ARG("QMod", "PlaceAllFiles", m_Id);
+
+			// Extract QMod so we can move the files. Linked installs reuse the unpacked copy in the store, and only extract what's missing from it
+			bool linked = m_InstallMode.load() == InstallMode::Linked;
+			std::string extractionDir = linked ? GetUnpackedDir() : GetTempDir(m_Path);
+
+			FilesResult extracted = linked ? EnsureUnpacked() : ExtractQMod(extractionDir);
+			if (extracted != FilesResult::Done)
+				return extracted;
+
+			// Libraries another mod already has in place with the same content are only referenced, the rest are planned and placed
+			ZipUtils::ZipReader zip;
+			if (!m_LibraryFiles.empty())
+				zip.Open(m_Path);
+
+			std::vector<PayloadFile> payload;
+			std::vector<std::string_view> libraries;
+
+			for (PayloadFile &file : GetPayload())
+			{
+				if (file.library)
+				{
+					const ZipUtils::ZipEntry *entry = zip.IsOpen() ? zip.Find(file.entry) : nullptr;
+					libraries.push_back(file.entry);
+
+					switch (LibraryRegistry::Acquire(file.entry, m_Id, entry))
+					{
+					case LibraryRegistry::Claim::Shared:
+						QLOG_DETAIL("Lib File \"%s\" is already in place with the same content, sharing it", file.entry.data());
+						Metrics::Add(Metrics::Counter::BytesReused, entry->uncompressedSize);
+						continue;
+					case LibraryRegistry::Claim::Conflict:
+						QLOG_WARNING("\"%s\" ships a different \"%s\" than another installed mod, it will replace theirs", m_Id.data(), file.entry.data());
+						break;
+					case LibraryRegistry::Claim::Place:
+						break;
+					}
+				}
+
+				transaction.Place(linked, extractionDir + file.folder + std::string(file.entry), file.destination);
+				payload.push_back(std::move(file));
+			}
+
+			// Every file put in place so far, so a cancelled or failed install can take them back out
+			std::vector<std::pair<std::string, std::string>> placed;
+
+			auto RollBack = [&](FilesResult result)
+			{
+				// Libraries are only removed if this was the last mod holding them
+				for (std::string_view library : libraries)
+				{
+					if (LibraryRegistry::Release(library, m_Id))
+						continue;
+
+					std::string destination = Paths::GameLibs() + std::string(library);
+					std::erase_if(placed, [&](const std::pair<std::string, std::string> &placedFile) { return placedFile.second == destination; });
+				}
+
+				for (auto placedFile = placed.rbegin(); placedFile != placed.rend(); ++placedFile)
+					RemovePayloadFile(placedFile->first, placedFile->second, linked);
+
+				return result;
+			};
+
+			if (!transaction.Begin())
+			{
+				QLOG_ERROR("Failed to write the journal (errno %i), not putting the files of \"%s\" in place", errno, m_Id.data());
+				return RollBack(FilesResult::Failed);
+			}
+
+			// Mods go to the Mods folder, Libs to the Libs folder, and File Copies to their own destination folders
+			for (const PayloadFile &file : payload)
+			{
+				if (Operation::IsCancelled())
+					return RollBack(FilesResult::Cancelled);
+
+				std::string source = extractionDir + file.folder + std::string(file.entry);
+
+				if (std::strcmp(file.folder, "FileCopies/") == 0)
+				{
+					std::string desPath = file.destination.substr(0, file.destination.find_last_of("/\\"));
+
+					Metrics::System(string_format("mkdir -p \"%s\"", desPath.c_str()));
+					std::remove(file.destination.c_str());
+				}
+
+				if (!PlacePayloadFile(source, file.destination, linked))
+				{
+					QLOG_ERROR("Failed to put \"%s\" in place for mod \"%s\" (errno %i)", file.destination.c_str(), m_Id.data(), errno);
+					return RollBack(FilesResult::Failed);
+				}
+
+				placed.emplace_back(std::move(source), file.destination);
+
+				const ZipUtils::ZipEntry *entry = file.library && zip.IsOpen() ? zip.Find(file.entry) : nullptr;
+				if (entry != nullptr)
+					LibraryRegistry::Placed(file.entry, *entry);
 			}
+
+			return FilesResult::Done;
 		}
 
-		void ExtractQMod()
+		/**
+		 * @brief Makes sure every file of this QMod is in its unpacked copy, extracting only the ones that are missing
+		 * @details Files can go missing from the unpacked copy when the filesystem can't link them, as they're moved into place instead
+		 * 
+		 * @return Returns Cancelled if the operation was cancelled, or Failed if a missing file couldn't be extracted into the unpacked copy, see GetUnpackedDir
+		 */
+		FilesResult EnsureUnpacked()
 		{
-			std::string tmpDir = GetTempDir(m_Path);
-			std::string modsExtractionPath = tmpDir + "Mods/";
-			std::string libsExtractionPath = tmpDir + "Libs/";
-			std::string fileCopiesExtractionPath = tmpDir + "FileCopies/";
+			std::string unpackedDir = GetUnpackedDir();
+			ZipUtils::ZipReader zip;
+
+			auto Extract = [&](std::string_view name, const char *folder)
+			{
+				if (Operation::IsCancelled())
+					return FilesResult::Cancelled;
+
+				std::string extractionPath = unpackedDir + folder + std::string(name);
+				if (access(extractionPath.c_str(), F_OK) == 0)
+					return FilesResult::Done;
+
+				// Only opened once something is actually missing
+				if (!zip.IsOpen())
+					zip.Open(m_Path);
+
+				// A library shared with the copy another mod has in place won't be placed, so it isn't needed
+				const ZipUtils::ZipEntry *entry = zip.IsOpen() ? zip.Find(name) : nullptr;
+				if (std::strcmp(folder, "Libs/") == 0 && entry != nullptr && LibraryRegistry::IsSharedWith(name, m_Id, *entry))
+					return FilesResult::Done;
+
+				if (ExtractFile(zip, name, extractionPath))
+					return FilesResult::Done;
+
+				if (Operation::IsCancelled())
+					return FilesResult::Cancelled;
+
+				QLOG_ERROR("Failed to extract \"%s\" from \"%s\"", name.data(), m_Path.c_str());
+				return FilesResult::Failed;
+			};
 
-			// Create dirs
-			std::system(string_format("mkdir -p \"%s\"", modsExtractionPath.c_str()).c_str());
-			std::system(string_format("mkdir -p \"%s\"", libsExtractionPath.c_str()).c_str());
-			std::system(string_format("mkdir -p \"%s\"", fileCopiesExtractionPath.c_str()).c_str());
+			for (std::string_view mod : m_ModFiles)
+			{
+				FilesResult result = Extract(mod, "Mods/");
+				if (result != FilesResult::Done)
+					return result;
+			}
+
+			for (std::string_view lib : m_LibraryFiles)
+			{
+				FilesResult result = Extract(lib, "Libs/");
+				if (result != FilesResult::Done)
+					return result;
+			}
+
+			for (FileCopy fileCopy : m_FileCopies)
+			{
+				FilesResult result = Extract(fileCopy.name, "FileCopies/");
+				if (result != FilesResult::Done)
+					return result;
+			}
 
-			// Extract Mods
-			for (std::string mod : *m_ModFiles)
+			return FilesResult::Done;
+		}
+
+		void Recover(const Journal::Pending &transaction)
+		{
+			bool forBeatSaber = m_PackageId == "com.beatgames.beatsaber";
+
+			if (transaction.operation == "Install" && transaction.config.empty())
 			{
-				std::system(string_format("unzip \"%s\" \"%s\" -d \"%s\"", m_Path.c_str(), mod.c_str(), modsExtractionPath.c_str()).c_str());
+				// The files were still being placed, take back out the ones that made it
+				for (auto entry = transaction.plan.rbegin(); entry != transaction.plan.rend(); ++entry)
+				{
+					std::string_view fileName = std::string_view(entry->destination).substr(entry->destination.find_last_of('/') + 1);
+
+					if (entry->destination.starts_with(Paths::GameLibs()) && !LibraryRegistry::Release(fileName, m_Id))
+						continue;
+
+					RemovePayloadFile(entry->source, entry->destination, entry->linked);
+				}
+
+				m_State.store(ModState::Downloaded, std::memory_order_release);
+				CleanupTempDir(GetFileName(m_Path));
+				return;
 			}
 
-			// Extract Libs
-			for (std::string lib : *m_LibraryFiles)
+			if (transaction.operation == "Install" || transaction.operation == "Reconcile")
 			{
-				std::system(string_format("unzip \"%s\" \"%s\" -d \"%s\"", m_Path.c_str(), lib.c_str(), libsExtractionPath.c_str()).c_str());
+				// A reconcile is finished by reconciling again, which only rewrites the files that still differ
+				if (transaction.operation == "Reconcile")
+				{
+					for (const Journal::Entry &entry : transaction.plan)
+						unlink(entry.destination.c_str());
+
+					Journal::Transaction again("Reconcile", m_Id, m_Version);
+					if (ReconcileFiles(this, again) != FilesResult::Done)
+					{
+						QLOG_ERROR("Failed to recover \"%s\", its files couldn't be reconciled", m_Id.data());
+
+						m_State.store(ModState::Failed, std::memory_order_release);
+						CleanupTempDir(GetFileName(m_Path));
+						return;
+					}
+
+					again.Commit();
+				}
+
+				m_State.store(ModState::Installed, std::memory_order_release);
+
+				if (forBeatSaber)
+					UpdateBMBFData(false);
+
+				CleanupTempDir(GetFileName(m_Path));
+				return;
 			}
 
-			// Extract File Copies
-			for (FileCopy fileCopy : *m_FileCopies)
+			// Uninstalls are finished, every removal is safe to repeat
+			for (const Journal::Entry &entry : transaction.plan)
+				RemovePayloadFile(entry.source, entry.destination, entry.linked);
+
+			m_State.store(ModState::Downloaded, std::memory_order_release);
+
+			if (transaction.operation == "Remove")
+				Uninstall(false, true, false);
+			else if (forBeatSaber)
+				UpdateBMBFData(false);
+		}
+
+		bool PlacePayloadFile(const std::string &source, const std::string &destination, bool linked)
+		{
+			TRACE_SCOPE_ARG("File", "Place", destination);
+
+			if (!linked)
+				return Metrics::System(string_format("mv -f \"%s\" \"%s\"", source.c_str(), destination.c_str())) == 0;
+
+			return FileUtils::PlaceFile(source, destination) != FileUtils::PlaceMethod::Failed;
+		}
+
+		void RemovePayloadFile(const std::string &unpackedPath, const std::string &destination, bool linked)
+		{
+			TRACE_SCOPE_ARG("File", "Remove", destination);
+
+			if (!linked)
 			{
-				std::system(string_format("unzip \"%s\" \"%s\" -d \"%s\"", m_Path.c_str(), fileCopy.name.c_str(), fileCopiesExtractionPath.c_str()).c_str());
+				Metrics::System(string_format("rm -f \"%s\"", destination.c_str()));
+				return;
 			}
+
+			if (!FileUtils::ReturnFile(unpackedPath, destination))
+				unlink(destination.c_str());
 		}
 
 		bool PrepareDependency(Dependency dependency, std::vector<std::string> *installedInBranch)
 		{
-			getLogger().info("Preparing dependency of %s version %s", dependency.id.c_str(), dependency.version.c_str());
+			TRACE_SCOPE_ARG("QMod", "PrepareDependency", dependency.id);
+
+			QLOG_DETAIL("Preparing dependency of %s version %s", dependency.id.data(), dependency.version.data());
 
 			// Try to see if there's a recurssive dependency
 			auto it = find(installedInBranch->begin(), installedInBranch->end(), dependency.id);
@@ -825,32 +2138,30 @@ namespace QModUtils
 
 				for (std::string mod : *installedInBranch)
 				{
-					errorMsg += string_format("\"%s\" -> ", mod.c_str());
+					errorMsg += string_format("\"%s\" -> ", mod.data());
 				}
 				errorMsg += dependency.id;
 
-				getLogger().error("Recursive dependency detected: %s", errorMsg.c_str());
+				QLOG_ERROR("Recursive dependency detected: %s", errorMsg.c_str());
 				return false;
 			}
 
-			QMod *existing = nullptr;
-			for (std::pair<std::string, QMod *> modPair : *m_DownloadedQMods)
-			{
-				if (modPair.first == dependency.id)
-				{
-					existing = modPair.second;
-				}
-			}
+			QMod *existing = GetDownloadedQMod(std::string(dependency.id)).value_or(nullptr);
+
+			// Any local version that fits will do, installing an inactive one just switches to it
+			QMod *fitting = FindVersion(dependency.id, dependency.versionRange);
+			if (fitting != nullptr)
+				existing = fitting;
 
 			if (existing != nullptr)
 			{
-				if (semver::satisfies(existing->m_Version, dependency.version))
+				if (Semver::Satisfies(existing->m_VersionId, dependency.versionRange))
 				{
-					getLogger().info("Dependency is already downloaded and fits the version range \"%s\"", dependency.version.c_str());
+					QLOG_DETAIL("Dependency is already downloaded and fits the version range \"%s\"", dependency.version.data());
 
 					if (!existing->IsInstalled())
 					{
-						getLogger().info("Installing Dependency...");
+						QLOG_INFO("Installing Dependency...");
 
 						existing->Install(true, installedInBranch);
 					}
@@ -860,30 +2171,30 @@ namespace QModUtils
 
 				if (dependency.downloadIfMissing == "")
 				{
-					getLogger().error("Dependency with ID \"%s\" is already installed but with an incorrect version (\"%s\" does not intersect \"%s\"). Upgrading was not possible as there was no download link provided", dependency.id.c_str(), existing->m_Version.c_str(), dependency.version.c_str());
+					QLOG_ERROR("Dependency with ID \"%s\" is already installed but with an incorrect version (\"%s\" does not intersect \"%s\"). Upgrading was not possible as there was no download link provided", dependency.id.data(), existing->m_Version.data(), dependency.version.data());
 					return false;
 				}
 				else
 				{
-					getLogger().warning("Dependency with ID \"%s\" is already installed but with an incorrect version (\"%s\" does not intersect \"%s\"). Attempting to upgrade now...", dependency.id.c_str(), existing->m_Version.c_str(), dependency.version.c_str());
+					QLOG_WARNING("Dependency with ID \"%s\" is already installed but with an incorrect version (\"%s\" does not intersect \"%s\"). Attempting to upgrade now...", dependency.id.data(), existing->m_Version.data(), dependency.version.data());
 				}
 			}
 			else if (dependency.downloadIfMissing == "")
 			{
-				getLogger().error("Dependency \"%s\" is not installed, and the mod depending on it does not specify a download path if missing", dependency.id.c_str());
+				QLOG_ERROR("Dependency \"%s\" is not installed, and the mod depending on it does not specify a download path if missing", dependency.id.data());
 				return false;
 			}
 
 			// If we didnt return, then the correct dependency version isnt installed and we have a url, so we attempt to download it now
 
 			QMod *downloadedDependency = nullptr;
-			std::string downloadFileLoc = string_format("/sdcard/BMBFData/Mods/Temp/Downloads/%s", dependency.id.c_str());
+			std::string downloadFileLoc = string_format("%s%s", Paths::Downloads().c_str(), dependency.id.data());
 
 			// Putting cleanup function in lambda cus its messy and i dont wanna copy it everywhere
 			auto CleanupFunction = [&]()
-			{ CleanupTempDir(string_format("Downloads/%s", dependency.id.c_str()).c_str(), true); };
+			{ CleanupTempDir(string_format("Downloads/%s", dependency.id.data()).c_str(), true); };
 
-			if (!WebUtils::DownloadFile(dependency.downloadIfMissing, downloadFileLoc))
+			if (!WebUtils::DownloadFile(std::string(dependency.downloadIfMissing), downloadFileLoc))
 			{
 				CleanupFunction();
 				return false;
@@ -891,10 +2202,11 @@ namespace QModUtils
 
 			downloadedDependency = new QMod(downloadFileLoc);
 
-			if (downloadedDependency == nullptr)
+			if (!downloadedDependency->m_Valid)
 			{
-				getLogger().error("Failed to parse QMod for dependency \"%s\"", dependency.id.c_str());
+				QLOG_ERROR("Failed to parse QMod for dependency \"%s\"", dependency.id.data());
 
+				DiscardDownload(downloadedDependency, downloadFileLoc);
 				CleanupFunction();
 				return false;
 			}
@@ -902,16 +2214,18 @@ namespace QModUtils
 			// Sanity checks that the download link actually pointed to the right mod
 			if (dependency.id != downloadedDependency->m_Id)
 			{
-				getLogger().error("Downloaded dependency had Id \"%s\", whereas the dependency stated ID \"%s\"", downloadedDependency->m_Id.c_str(), dependency.id.c_str());
+				QLOG_ERROR("Downloaded dependency had Id \"%s\", whereas the dependency stated ID \"%s\"", downloadedDependency->m_Id.data(), dependency.id.data());
 
+				DiscardDownload(downloadedDependency, downloadFileLoc);
 				CleanupFunction();
 				return false;
 			}
 
-			if (!semver::satisfies(downloadedDependency->m_Version, dependency.version))
+			if (!Semver::Satisfies(downloadedDependency->m_VersionId, dependency.versionRange))
 			{
-				getLogger().error("Downloaded dependency \"%s\" v%s was not within the version range stated in the dependency info (%s)", downloadedDependency->m_Id.c_str(), downloadedDependency->m_Version.c_str(), dependency.version.c_str());
+				QLOG_ERROR("Downloaded dependency \"%s\" v%s was not within the version range stated in the dependency info (%s)", downloadedDependency->m_Id.data(), downloadedDependency->m_Version.data(), dependency.version.data());
 
+				DiscardDownload(downloadedDependency, downloadFileLoc);
 				CleanupFunction();
 				return false;
 			}
@@ -923,80 +2237,54 @@ namespace QModUtils
 			return true;
 		}
 
-		void UpdateBMBFJSONData(auto &mod, auto &allocator)
-		{
-			ADD_STRING_MEMBER("Id", m_Id, mod, allocator);
-			ADD_STRING_MEMBER("Path", m_Path, mod, allocator);
-			ADD_MEMBER("Installed", m_Installed, mod, allocator);
-			ADD_MEMBER("TogglingOnSync", false, mod, allocator);
-			ADD_MEMBER("RemovingOnSync", false, mod, allocator);
-			ADD_STRING_MEMBER("Version", m_Version, mod, allocator);
-			ADD_MEMBER("Uninstallable", m_Uninstallable, mod, allocator);
-			ADD_STRING_MEMBER("CoverImageFilename", m_CoverImageFilename, mod, allocator);
-			ADD_STRING_MEMBER("TargetBeatsaberVersion", m_PackageVersion, mod, allocator);
-			ADD_STRING_MEMBER("Author", m_Author, mod, allocator);
-			ADD_STRING_MEMBER("Porter", m_Porter, mod, allocator);
-			ADD_STRING_MEMBER("Name", m_Name, mod, allocator);
-			ADD_STRING_MEMBER("Description", m_Description, mod, allocator);
-		}
-
 		void RemoveBMBFData(bool verbos = true)
 		{
+			TRACE_SCOPE_ARG("Config", "RemoveBMBFData", m_Id);
+			Log::OperationSummary summary("RemoveBMBFData", m_Id);
+
 			// Prevents multiple threads writing to the file at the same time
-			std::unique_lock<std::mutex> guard(m_BmbfConfigLock);
+			Metrics::TimedLock guard(m_BmbfConfigLock, Metrics::Histogram::ConfigLockWait, Metrics::Histogram::ConfigLockHold);
 
 			if (verbos)
-				getLogger().info("Removing BMBF Info for \"%s\"", m_Id.c_str());
-
-			// Read the config.json file
-			std::ifstream configFile("/sdcard/BMBFData/config.json");
-			ASSERT(configFile.good(), GetFileName(m_Path), verbos);
+				QLOG_DETAIL("Removing BMBF Info for \"%s\"", m_Id.data());
 
-			std::stringstream configJson;
-			configJson << configFile.rdbuf();
+			if (m_ConfigBatchDepth > 0)
+			{
+				BatchConfigChange(this, true);
+				return;
+			}
 
+			// Read the config.json file
 			rapidjson::Document document;
 
-			ASSERT(!document.Parse(configJson.str().c_str()).HasParseError(), GetFileName(m_Path), verbos);
+			ASSERT(ReadConfig(t_ConfigBuffer) && !document.ParseInsitu(t_ConfigBuffer.data()).HasParseError(), GetFileName(m_Path), verbos);
 			ASSERT(document.HasMember("Mods") && document["Mods"].IsArray(), GetFileName(m_Path), verbos);
 
-			const auto &mods = document["Mods"].GetArray();
-
-			// Try Find Our Mod in the BMBF Data
-			for (int i = 0; i < (int)mods.Size(); i++)
-			{
-				// Find our mod id, then read the data
-
-				std::string id = GET_STRING("Id", mods[i]);
-
-				if (id != m_Id)
-					continue;
+			// Save To Buffer, leaving our entry out as the document is written
 
-				if (verbos)
-					getLogger().info("Found BMBF Data for \"%s\", Removing It...", m_Id.c_str());
+			rapidjson::StringBuffer buffer;
+			Fields::JsonWriter writer(buffer);
 
-				mods.Erase(mods.Begin() + i);
-				break;
-			}
+			bool foundMod = WriteBMBFConfig(document, writer, {{m_Id, nullptr}}) > 0;
 
 			if (verbos)
-				getLogger().info("Removed BMBF Data for \"%s\"! Saving...", m_Id.c_str());
-
-			// Save To Buffer
-
-			rapidjson::StringBuffer buffer;
-			rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+			{
+				if (foundMod)
+					QLOG_DETAIL("Found BMBF Data for \"%s\", Removed It!", m_Id.data());
 
-			document.Accept(writer);
+				QLOG_DETAIL("Removed BMBF Data for \"%s\"! Saving...", m_Id.data());
+			}
 
 			// Write To File
 
-			std::ofstream out("/sdcard/BMBFData/config.json");
-			out << buffer.GetString();
-			out.close();
+			if (!WriteConfig(buffer.GetString(), buffer.GetSize()))
+			{
+				QLOG_ERROR("Failed to save BMBF Data for \"%s\" (errno %i), config.json was left as it was", m_Id.data(), errno);
+				return;
+			}
 
 			if (verbos)
-				getLogger().info("Saved BMBF Data for \"%s\"!", m_Id.c_str());
+				QLOG_INFO("Saved BMBF Data for \"%s\"!", m_Id.data());
 		}
 
 		static void CleanUnusedLibraries(bool onlyDisable, bool forceUninstall = false)
@@ -1006,10 +2294,9 @@ namespace QModUtils
 			{
 				actionPerformed = false;
 
-				for (std::pair<const std::string, QModUtils::QMod *> modPair : *m_DownloadedQMods)
+				// Uninstalling can forget QMods, so this goes over a copy
+				for (QMod *mod : DownloadedQMods())
 				{
-					QMod *mod = modPair.second;
-
 					if (!mod->IsLibrary())
 						continue;
 					if (!forceUninstall && !mod->Uninstallable())
@@ -1019,7 +2306,7 @@ namespace QModUtils
 
 					if (mod->IsInstalled())
 					{
-						getLogger().info("\"%s\" is unused, %s", mod->Id().c_str(), onlyDisable ? "uninstalling" : "deleting");
+						QLOG_DETAIL("\"%s\" is unused, %s", mod->Id().data(), onlyDisable ? "uninstalling" : "deleting");
 						actionPerformed = true;
 
 						mod->Uninstall(onlyDisable, true);
@@ -1035,24 +2322,92 @@ namespace QModUtils
 				if (!forceUninstall && !mod->Uninstallable())
 					continue;
 
-				getLogger().info("\"%s\" depends on \"%s\", %s", mod->Id().c_str(), m_Id.c_str(), onlyDisable ? "uninstalling" : "deleting");
+				QLOG_DETAIL("\"%s\" depends on \"%s\", %s", mod->Id().data(), m_Id.data(), onlyDisable ? "uninstalling" : "deleting");
 				mod->Uninstall(onlyDisable, true);
 			}
 		}
 
+		/**
+		 * @brief Adds this QMod to the list of versions of its mod. It becomes the active version if there isn't one yet, otherwise it waits for Activate
+		 */
+		void RegisterVersion()
+		{
+			std::string id = std::string(m_Id);
+			std::unique_lock lock(m_RegistryLock);
+
+			(*m_QModVersions)[id].push_back(this);
+
+			if (!m_DownloadedQMods->contains(id))
+			{
+				m_DownloadedQMods->insert({id, this});
+				lock.unlock();
+
+				MoveOutOfStore();
+				return;
+			}
+
+			// The BMBF Data is per mod id, so it's describing the active version, not this one
+			m_State.store(ModState::Downloaded, std::memory_order_release);
+		}
+
+		void MoveToStore()
+		{
+			if (m_Path.starts_with(Paths::Store()))
+				return;
+
+			FileUtils::MakeDirs(Paths::Store());
+
+			std::string storedPath = string_format("%s%s@%s.qmod", Paths::Store().c_str(), m_Id.data(), m_Version.data());
+			if (rename(m_Path.c_str(), storedPath.c_str()) != 0)
+			{
+				QLOG_ERROR("Failed to move \"%s\" into the QMod store (errno %i)", m_Path.c_str(), errno);
+				return;
+			}
+
+			// Marks when this version stopped being used, for the garbage collection
+			utimensat(AT_FDCWD, storedPath.c_str(), nullptr, 0);
+
+			m_Path = storedPath;
+		}
+
+		void MoveOutOfStore()
+		{
+			if (!m_Path.starts_with(Paths::Store()))
+				return;
+
+			std::string activePath = string_format("%s%s.qmod", Paths::Mods().c_str(), m_Id.data());
+			if (rename(m_Path.c_str(), activePath.c_str()) != 0)
+			{
+				QLOG_ERROR("Failed to move \"%s\" out of the QMod store (errno %i)", m_Path.c_str(), errno);
+				return;
+			}
+
+			m_Path = activePath;
+		}
+
+		/**
+		 * @brief Atomically moves this QMod from one state to another
+		 * 
+		 * @return Returns false if the QMod was not in the "from" state, in which case nothing changes
+		 */
+		bool TryTransition(ModState from, ModState to)
+		{
+			return m_State.compare_exchange_strong(from, to, std::memory_order_acq_rel, std::memory_order_acquire);
+		}
+
 		static void CachePackageInfo()
 		{
 			if (m_AppPackageId != "") return;
 
-			JNIEnv *env = JNIUtils::GetJNIEnv();
+			const PackageInfo::Info &info = PackageInfo::Get();
 
-			m_AppPackageId = JNIUtils::ToString(JNIUtils::GetPackageName(env), env);
-			m_AppPackageVersion = JNIUtils::ToString(JNIUtils::GetGameVersion(env), env);
+			m_AppPackageId = info.packageId;
+			m_AppPackageVersion = info.version;
 		}
 
 		const static std::string GetTempDir(std::string path)
 		{
-			return string_format("/sdcard/BMBFData/Mods/Temp/%s/", GetFileName(path).c_str());
+			return string_format("%s%s/", Paths::Temp().c_str(), GetFileName(path).c_str());
 		}
 
 		const static void CleanupTempDir(std::string name, bool isFile = false)
@@ -1061,16 +2416,16 @@ namespace QModUtils
 			{
 				if (isFile)
 				{
-					std::system(string_format("rm -f \"/sdcard/BMBFData/Mods/Temp/%s\"", name.c_str()).c_str()); // Remove The file
+					Metrics::System(string_format("rm -f \"%s%s\"", Paths::Temp().c_str(), name.c_str())); // Remove The file
 				}
 				else
 				{
-					std::system(string_format("rm -f -r \"/sdcard/BMBFData/Mods/Temp/%s/\"", name.c_str()).c_str()); // Remove This QMod's Temp Dir
+					Metrics::System(string_format("rm -f -r \"%s%s/\"", Paths::Temp().c_str(), name.c_str())); // Remove This QMod's Temp Dir
 				}
 			}
 
-			std::system("rmdir \"/sdcard/BMBFData/Mods/Temp/Downloads/\""); // Attempt To Remove the downloads Temp Dir, but only if it's empty
-			std::system("rmdir \"/sdcard/BMBFData/Mods/Temp/\"");			// Attempt To Remove the entire Temp Dir, but only if it's empty
+			rmdir(Paths::Downloads().c_str()); // Attempt To Remove the downloads Temp Dir, but only if it's empty
+			rmdir(Paths::Temp().c_str());			// Attempt To Remove the entire Temp Dir, but only if it's empty
 		}
 
 		static const std::string GetFileName(std::string path, bool removeFileExtension = true, bool returnTrueName = false)
@@ -1102,32 +2457,95 @@ namespace QModUtils
 			return fileName;
 		}
 
-		std::string m_Name;
-		std::string m_Id;
-		std::string m_Description;
-		std::string m_Author;
-		std::string m_Porter;
-		std::string m_Version;
-		std::string m_CoverImage;
+		// Everything from the mod.json lives in m_Metadata. Fields missing from the mod.json stay as empty (but still null terminated) strings
+
+		std::string_view m_Name = "";
+		std::string_view m_Id = "";
+		std::string_view m_Description = "";
+		std::string_view m_Author = "";
+		std::string_view m_Porter = "";
+		std::string_view m_Version = "";
+		Semver::VersionId m_VersionId = 0;
+		std::string_view m_CoverImage = "";
 
-		std::string m_PackageId;
-		std::string m_PackageVersion;
+		std::string_view m_PackageId = "";
+		std::string_view m_PackageVersion = "";
 
 		std::string m_Path;
+		FileUtils::DirEntry m_FileIdentity = {};
+		std::atomic<uint64_t> m_ArchiveHash = 0;
 
-		std::vector<std::string> *m_ModFiles;
-		std::vector<std::string> *m_LibraryFiles;
-		std::vector<Dependency> *m_Dependencies;
-		std::vector<FileCopy> *m_FileCopies;
+		std::span<std::string_view> m_ModFiles;
+		std::span<std::string_view> m_LibraryFiles;
+		std::span<Dependency> m_Dependencies;
+		std::span<FileCopy> m_FileCopies;
 
-		bool m_Valid;
-		bool m_IsLibrary;
+		std::atomic<bool> m_Valid = false;
+		bool m_IsLibrary = false;
 
 		// BMBF Stuff
 
 		std::string m_CoverImageFilename;
 
-		bool m_Installed;
-		bool m_Uninstallable;
+		std::atomic<ModState> m_State = ModState::Downloaded;
+		std::atomic<bool> m_Uninstallable = true;
+
+		friend struct Fields::FieldTable<QMod>;
+	};
+
+	template <>
+	struct Fields::FieldTable<QMod>
+	{
+		// The mod.json. Strings that repeat across mods (ids, authors, versions, file names) are interned
+		static constexpr std::array<FieldDescriptor<QMod>, 14> fields = {
+			ArenaString<QMod, &QMod::m_Name>("name"),
+			ArenaString<QMod, &QMod::m_Id, true>("id"),
+			ArenaString<QMod, &QMod::m_Description>("description"),
+			ArenaString<QMod, &QMod::m_Author, true>("author"),
+			ArenaString<QMod, &QMod::m_Porter, true>("porter"),
+			ArenaString<QMod, &QMod::m_Version, true>("version"),
+			ArenaString<QMod, &QMod::m_CoverImage>("coverImage"),
+			ArenaString<QMod, &QMod::m_PackageId, true>("packageId"),
+			ArenaString<QMod, &QMod::m_PackageVersion, true>("packageVersion"),
+			ArenaStringArray<QMod, &QMod::m_ModFiles>("modFiles"),
+			ArenaStringArray<QMod, &QMod::m_LibraryFiles>("libraryFiles"),
+			ArenaObjectArray<QMod, &QMod::m_Dependencies, Dependency>("dependencies"),
+			ArenaObjectArray<QMod, &QMod::m_FileCopies, FileCopy>("fileCopies"),
+			Bool<QMod, &QMod::m_IsLibrary>("isLibrary")};
+
+		// An entry in BMBF's "config.json", in the order BMBF writes it
+		static constexpr std::array<FieldDescriptor<QMod>, 13> bmbfEntry = {
+			StringOrNull<QMod, &QMod::m_Id>("Id"),
+			StringOrNull<QMod, &QMod::m_Path>("Path"),
+			Computed<QMod>("Installed", [](const QMod &mod, JsonWriter &writer) { writer.Bool(mod.IsInstalled()); }),
+			Computed<QMod>("TogglingOnSync", [](const QMod &, JsonWriter &writer) { writer.Bool(false); }),
+			Computed<QMod>("RemovingOnSync", [](const QMod &, JsonWriter &writer) { writer.Bool(false); }),
+			StringOrNull<QMod, &QMod::m_Version>("Version"),
+			Computed<QMod>("Uninstallable", [](const QMod &mod, JsonWriter &writer) { writer.Bool(mod.Uninstallable()); }),
+			StringOrNull<QMod, &QMod::m_CoverImageFilename>("CoverImageFilename"),
+			StringOrNull<QMod, &QMod::m_PackageVersion>("TargetBeatsaberVersion"),
+			StringOrNull<QMod, &QMod::m_Author>("Author"),
+			StringOrNull<QMod, &QMod::m_Porter>("Porter"),
+			StringOrNull<QMod, &QMod::m_Name>("Name"),
+			StringOrNull<QMod, &QMod::m_Description>("Description")};
 	};
+
+	inline void QMod::ReadManifest(const rapidjson::Value &document)
+	{
+		Fields::ReadObject<Fields::FieldTable<QMod>::fields>(*this, document, m_Metadata);
+
+		// Parse the version and compile the dependency ranges now, so dependency checks don't have to
+		m_VersionId = Semver::InternVersion(m_Version);
+
+		for (Dependency &dependency : m_Dependencies)
+			dependency.versionRange = Semver::InternRange(dependency.version);
+	}
+
+	inline void QMod::WriteBMBFEntry(Fields::JsonWriter &writer, const rapidjson::Value *existing) const
+	{
+		if (existing != nullptr && existing->IsObject())
+			Fields::WriteObjectOver<Fields::FieldTable<QMod>::bmbfEntry>(*this, *existing, writer);
+		else
+			Fields::WriteObject<Fields::FieldTable<QMod>::bmbfEntry>(*this, writer);
+	}
 }
\ No newline at end of file
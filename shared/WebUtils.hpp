@@ -1,5 +1,13 @@
 #pragma once
 
+#include "qmod-utils/shared/FileUtils.hpp"
+#include "qmod-utils/shared/Log.hpp"
+#include "qmod-utils/shared/Paths.hpp"
+#include "qmod-utils/shared/Trace.hpp"
+#include "qmod-utils/shared/Metrics.hpp"
+#include "qmod-utils/shared/Operation.hpp"
+#include "qmod-utils/shared/Background.hpp"
+
 #include "libcurl/shared/curl.h"
 
 #include "beatsaber-hook/shared/rapidjson/include/rapidjson/document.h"
@@ -8,7 +16,12 @@
 #include "beatsaber-hook/shared/rapidjson/include/rapidjson/error/error.h"
 #include "beatsaber-hook/shared/rapidjson/include/rapidjson/error/en.h"
 
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <optional>
 #include <string>
+#include <thread>
 
 namespace QModUtils {
 	namespace WebUtils {
@@ -20,22 +33,31 @@ namespace QModUtils {
 				s->append((char*)contents, newLength);
 			} catch(std::bad_alloc &e) {
 				//handle memory problem
-				getLogger().critical("Failed to allocate string of size: %lu", newLength);
+				QLOG_CRITICAL("Failed to allocate string of size: %lu", newLength);
 				return 0;
 			}
+			Metrics::Add(Metrics::Counter::BytesDownloaded, newLength);
 			return newLength;
 		}
 
+		// Called by curl every so often during a transfer. Background transfers wait here for interactive operations, and a cancelled one is aborted
+		inline int TransferProgress(void*, curl_off_t, curl_off_t, curl_off_t, curl_off_t)
+		{
+			return Operation::Checkpoint() ? 0 : 1;
+		}
+
 		inline bool DownloadFile(std::string url, std::string downloadFileLoc) {
+			TRACE_SCOPE_ARG("Web", "DownloadFile", url);
+
 			CURL* curl = curl_easy_init();
 			std::string val;
 
 			if (curl) {
-				getLogger().info("Downloading file \"%s\"", url.c_str());
+				QLOG_INFO("Downloading file \"%s\"", url.c_str());
 				
 				CURLcode res;
 
-				std::system("mkdir -p \"/sdcard/BMBFData/Mods/Temp/Downloads/\"");
+				FileUtils::MakeDirs(Paths::Downloads());
 
 				curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
 				curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteData);
@@ -45,11 +67,26 @@ namespace QModUtils {
 				// Follow HTTP redirects if necessary.
                 curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
 
+				curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+				curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, TransferProgress);
+
+				if (uint64_t rate = Background::DownloadRate(); rate != 0)
+					curl_easy_setopt(curl, CURLOPT_MAX_RECV_SPEED_LARGE, (curl_off_t)rate);
+
+				auto start = std::chrono::steady_clock::now();
 				res = curl_easy_perform(curl);
 				curl_easy_cleanup(curl);
 
+				Metrics::Record(Metrics::Histogram::Download, std::chrono::steady_clock::now() - start);
+
+				if (res == CURLE_ABORTED_BY_CALLBACK) {
+					QLOG_INFO("Cancelled the transfer from \"%s\"", url.c_str());
+
+					return false;
+				}
+
 				if (res != CURLE_OK) {
-					getLogger().error("Curl Failed to download \"%s\"! Error: (%i) %s", url.c_str(), res, curl_easy_strerror(res));
+					QLOG_ERROR("Curl Failed to download \"%s\"! Error: (%i) %s", url.c_str(), res, curl_easy_strerror(res));
 
 					return false;
 				}
@@ -58,7 +95,7 @@ namespace QModUtils {
 				file << val;
 				file.close();
 			} else {
-				getLogger().error("Curl failed to initialize for \"%s\". No futher info was given", url.c_str());
+				QLOG_ERROR("Curl failed to initialize for \"%s\". No futher info was given", url.c_str());
 				return false;
 			}
 
@@ -66,11 +103,13 @@ namespace QModUtils {
 		}
 
 		inline std::string GetData(std::string url, std::function<void(std::string)> onComplete = nullptr) {
+			TRACE_SCOPE_ARG("Web", "GetData", url);
+
 			CURL* curl = curl_easy_init();
 			std::string val;
 
 			if (curl != nullptr) {
-				getLogger().info("Getting data from \"%s\"", url.c_str());
+				QLOG_INFO("Getting data from \"%s\"", url.c_str());
 				
 				CURLcode res;
 
@@ -82,23 +121,35 @@ namespace QModUtils {
 				// Follow HTTP redirects if necessary.
                 curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
 
+				curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+				curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, TransferProgress);
+
+				if (uint64_t rate = Background::DownloadRate(); rate != 0)
+					curl_easy_setopt(curl, CURLOPT_MAX_RECV_SPEED_LARGE, (curl_off_t)rate);
+
 				curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, "GET");
 
 				res = curl_easy_perform(curl);
 
 				curl_easy_cleanup(curl);
 
+				if (res == CURLE_ABORTED_BY_CALLBACK) {
+					QLOG_INFO("Cancelled the transfer from \"%s\"", url.c_str());
+
+					return "";
+				}
+
 				if (res != CURLE_OK) {
-					getLogger().error("Curl Failed to Get from Url \"%s\"! Error: (%i) %s", url.c_str(), res, curl_easy_strerror(res));
+					QLOG_ERROR("Curl Failed to Get from Url \"%s\"! Error: (%i) %s", url.c_str(), res, curl_easy_strerror(res));
 
 					return "";
 				}
 			} else {
-				getLogger().error("Curl failed to initialize for url \"%s\". No futher info was given", url.c_str());
+				QLOG_ERROR("Curl failed to initialize for url \"%s\". No futher info was given", url.c_str());
 				return "";
 			}
 
-			getLogger().info("Got Data from \"%s\"!", url.c_str());
+			QLOG_INFO("Got Data from \"%s\"!", url.c_str());
 
 			if (onComplete != nullptr) onComplete(val);
 			return val;
@@ -106,6 +157,7 @@ namespace QModUtils {
 
 		inline void GetDataAsync(std::string url, std::function<void(std::string)> onComplete = nullptr) {
 			std::thread([url, onComplete]() {
+				Background::ApplyToCurrentThread();
 				GetData(url, onComplete);
 			}).detach();
 		}
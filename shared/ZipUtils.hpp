@@ -0,0 +1,646 @@
+#pragma once
+
+#include "qmod-utils/shared/FileUtils.hpp"
+#include "qmod-utils/shared/Metrics.hpp"
+#include "qmod-utils/shared/Background.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <zlib.h>
+
+#if defined(__aarch64__)
+#include <arm_acle.h>
+#include <asm/hwcap.h>
+#include <sys/auxv.h>
+#elif defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace QModUtils {
+	namespace ZipUtils {
+		/**
+		 * @brief An entry from a zip's central directory, this is everything that's known about a file without reading it
+		 */
+		struct ZipEntry {
+			std::string name;
+			uint16_t method; // 0 is stored, 8 is deflated
+			uint32_t crc32;
+			uint64_t compressedSize;
+			uint64_t uncompressedSize;
+			uint64_t localHeaderOffset;
+		};
+
+		// Zip integers are always little endian
+		inline uint16_t ReadU16(const uint8_t* data) {
+			return data[0] | (data[1] << 8);
+		}
+
+		inline uint32_t ReadU32(const uint8_t* data) {
+			return data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t)data[3] << 24);
+		}
+
+		inline uint64_t ReadU64(const uint8_t* data) {
+			return ReadU32(data) | ((uint64_t)ReadU32(data + 4) << 32);
+		}
+
+		/**
+		 * @brief Slice-by-8 tables for the zip CRC-32 (reflected polynomial 0xEDB88320), built at compile time
+		 */
+		constexpr std::array<std::array<uint32_t, 256>, 8> MakeCrcTables() {
+			std::array<std::array<uint32_t, 256>, 8> tables {};
+
+			for (uint32_t i = 0; i < 256; i++) {
+				uint32_t crc = i;
+				for (int bit = 0; bit < 8; bit++) crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1)));
+
+				tables[0][i] = crc;
+			}
+
+			for (uint32_t i = 0; i < 256; i++) {
+				for (int slice = 1; slice < 8; slice++) tables[slice][i] = (tables[slice - 1][i] >> 8) ^ tables[0][tables[slice - 1][i] & 0xFF];
+			}
+
+			return tables;
+		}
+
+		inline constexpr std::array<std::array<uint32_t, 256>, 8> c_CrcTables = MakeCrcTables();
+
+		/**
+		 * @brief Updates a zip CRC-32 with more data, 8 bytes at a time. Used when the CPU has no CRC instructions
+		 *
+		 * @param crc The CRC of the data before this, 0 to start a new one
+		 */
+		inline uint32_t Crc32Software(const void* data, size_t size, uint32_t crc = 0) {
+			const uint8_t* bytes = (const uint8_t*)data;
+			crc = ~crc;
+
+			while (size >= 8) {
+				uint32_t low = ReadU32(bytes) ^ crc;
+				uint32_t high = ReadU32(bytes + 4);
+
+				crc = c_CrcTables[7][low & 0xFF] ^ c_CrcTables[6][(low >> 8) & 0xFF] ^ c_CrcTables[5][(low >> 16) & 0xFF] ^ c_CrcTables[4][low >> 24] ^
+					c_CrcTables[3][high & 0xFF] ^ c_CrcTables[2][(high >> 8) & 0xFF] ^ c_CrcTables[1][(high >> 16) & 0xFF] ^ c_CrcTables[0][high >> 24];
+
+				bytes += 8;
+				size -= 8;
+			}
+
+			while (size--) crc = (crc >> 8) ^ c_CrcTables[0][(crc ^ *bytes++) & 0xFF];
+
+			return ~crc;
+		}
+
+#if defined(__aarch64__)
+		/**
+		 * @brief CRC-32 using the ARMv8 CRC32 instructions, which use the same polynomial as zip
+		 */
+		__attribute__((target("crc")))
+		inline uint32_t Crc32Armv8(const void* data, size_t size, uint32_t crc) {
+			const uint8_t* bytes = (const uint8_t*)data;
+			crc = ~crc;
+
+			for (; size > 0 && ((uintptr_t)bytes & 7) != 0; size--) crc = __crc32b(crc, *bytes++);
+
+			for (; size >= 8; size -= 8, bytes += 8) {
+				uint64_t word;
+				memcpy(&word, bytes, 8);
+
+				crc = __crc32d(crc, word);
+			}
+
+			for (; size > 0; size--) crc = __crc32b(crc, *bytes++);
+
+			return ~crc;
+		}
+#elif defined(__x86_64__)
+		__attribute__((target("pclmul,sse4.1")))
+		inline __m128i Crc32PclmulFold(__m128i x, __m128i k, __m128i next) {
+			return _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x, k, 0x11), _mm_clmulepi64_si128(x, k, 0x00)), next);
+		}
+
+		/**
+		 * @brief CRC-32 by folding 64 bytes at a time with carry-less multiplication, then a Barrett reduction
+		 * @details From Intel's "Fast CRC Computation for Generic Polynomials Using PCLMULQDQ Instruction", with the constants for the bit-reflected zip polynomial
+		 */
+		__attribute__((target("pclmul,sse4.1")))
+		inline uint32_t Crc32Pclmul(const void* data, size_t size, uint32_t crc) {
+			const uint8_t* bytes = (const uint8_t*)data;
+			if (size < 64) return Crc32Software(bytes, size, crc);
+
+			size_t tail = size & 15;
+			size -= tail;
+
+			const __m128i k1k2 = _mm_set_epi64x(0x01c6e41596, 0x0154442bd4);
+			const __m128i k3k4 = _mm_set_epi64x(0x00ccaa009e, 0x01751997d0);
+			const __m128i k5k0 = _mm_set_epi64x(0, 0x0163cd6124);
+			const __m128i poly = _mm_set_epi64x(0x01f7011641, 0x01db710641);
+			const __m128i mask = _mm_setr_epi32(~0, 0, ~0, 0);
+
+			__m128i x1 = _mm_loadu_si128((const __m128i*)(bytes + 0x00));
+			__m128i x2 = _mm_loadu_si128((const __m128i*)(bytes + 0x10));
+			__m128i x3 = _mm_loadu_si128((const __m128i*)(bytes + 0x20));
+			__m128i x4 = _mm_loadu_si128((const __m128i*)(bytes + 0x30));
+
+			x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128(~crc));
+
+			bytes += 64;
+			size -= 64;
+
+			// Fold 4 lanes in parallel
+			for (; size >= 64; size -= 64, bytes += 64) {
+				x1 = Crc32PclmulFold(x1, k1k2, _mm_loadu_si128((const __m128i*)(bytes + 0x00)));
+				x2 = Crc32PclmulFold(x2, k1k2, _mm_loadu_si128((const __m128i*)(bytes + 0x10)));
+				x3 = Crc32PclmulFold(x3, k1k2, _mm_loadu_si128((const __m128i*)(bytes + 0x20)));
+				x4 = Crc32PclmulFold(x4, k1k2, _mm_loadu_si128((const __m128i*)(bytes + 0x30)));
+			}
+
+			// Fold the lanes into one, then the rest 16 bytes at a time
+			x1 = Crc32PclmulFold(x1, k3k4, x2);
+			x1 = Crc32PclmulFold(x1, k3k4, x3);
+			x1 = Crc32PclmulFold(x1, k3k4, x4);
+
+			for (; size >= 16; size -= 16, bytes += 16) x1 = Crc32PclmulFold(x1, k3k4, _mm_loadu_si128((const __m128i*)bytes));
+
+			// Fold 128 bits down to 64, then Barrett reduce to 32
+			x2 = _mm_clmulepi64_si128(x1, k3k4, 0x10);
+			x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+
+			x2 = _mm_srli_si128(x1, 4);
+			x1 = _mm_and_si128(x1, mask);
+			x1 = _mm_xor_si128(_mm_clmulepi64_si128(x1, k5k0, 0x00), x2);
+
+			x2 = _mm_and_si128(x1, mask);
+			x2 = _mm_clmulepi64_si128(x2, poly, 0x10);
+			x2 = _mm_and_si128(x2, mask);
+			x2 = _mm_clmulepi64_si128(x2, poly, 0x00);
+			x1 = _mm_xor_si128(x1, x2);
+
+			return Crc32Software(bytes, tail, ~(uint32_t)_mm_extract_epi32(x1, 1));
+		}
+#endif
+
+		using Crc32Function = uint32_t (*)(const void* data, size_t size, uint32_t crc);
+
+		/**
+		 * @brief Picks the fastest CRC-32 the CPU supports, this is only checked once
+		 */
+		inline Crc32Function SelectCrc32() {
+#if defined(__aarch64__)
+			if (getauxval(AT_HWCAP) & HWCAP_CRC32) return Crc32Armv8;
+#elif defined(__x86_64__)
+			if (__builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse4.1")) return Crc32Pclmul;
+#endif
+
+			return Crc32Software;
+		}
+
+		inline const Crc32Function c_Crc32 = SelectCrc32();
+
+		/**
+		 * @brief Updates a zip CRC-32 with more data, using CRC instructions if the CPU has them
+		 *
+		 * @param crc The CRC of the data before this, 0 to start a new one
+		 */
+		inline uint32_t Crc32(const void* data, size_t size, uint32_t crc = 0) {
+			return c_Crc32(data, size, crc);
+		}
+
+		/**
+		 * @brief Works out the CRC-32 of a whole file
+		 *
+		 * @return Returns false if the file couldn't be read
+		 */
+		inline bool FileCrc32(const std::string& path, uint32_t& crc) {
+			FileUtils::ScopedFd fd(open(path.c_str(), O_RDONLY | O_CLOEXEC));
+			if (fd < 0) return false;
+
+			char buffer[64 * 1024];
+			crc = 0;
+
+			while (true) {
+				ssize_t len = read(fd, buffer, sizeof(buffer));
+
+				if (len < 0 && errno == EINTR) continue;
+				if (len < 0) return false;
+				if (len == 0) return true;
+
+				crc = Crc32(buffer, len, crc);
+			}
+		}
+
+		/**
+		 * @brief Finds the central directory of a mapped zip, from its end of central directory record
+		 *
+		 * @return Returns false if the data isn't a zip
+		 */
+		inline bool FindCentralDirectory(const uint8_t* data, size_t size, uint64_t& offset, uint64_t& directorySize, uint64_t& count) {
+			if (size < 22) return false;
+
+			// The record is 22 bytes, followed by a comment of up to 64KB
+			size_t searchStart = size - std::min<size_t>(size, 22 + 0xFFFF);
+
+			for (size_t i = size - 22; ; i--) {
+				if (ReadU32(data + i) == 0x06054b50) {
+					count = ReadU16(data + i + 10);
+					directorySize = ReadU32(data + i + 12);
+					offset = ReadU32(data + i + 16);
+
+					// Zip64 archives keep the real values in a record pointed to by the locator, which comes just before this one
+					if ((offset == 0xFFFFFFFF || count == 0xFFFF) && i >= 20 && ReadU32(data + i - 20) == 0x07064b50) {
+						uint64_t recordOffset = ReadU64(data + i - 12);
+						if (recordOffset + 56 > size || ReadU32(data + recordOffset) != 0x06064b50) return false;
+
+						count = ReadU64(data + recordOffset + 32);
+						directorySize = ReadU64(data + recordOffset + 40);
+						offset = ReadU64(data + recordOffset + 48);
+					}
+
+					return offset <= size && directorySize <= size - offset;
+				}
+
+				if (i == searchStart) return false;
+			}
+		}
+
+		/**
+		 * @brief Reads every entry in a mapped zip's central directory, without touching any of the files in it
+		 *
+		 * @return Returns false if the central directory is corrupt
+		 */
+		inline bool ParseCentralDirectory(const uint8_t* directory, size_t size, uint64_t count, std::vector<ZipEntry>& entries) {
+			entries.clear();
+			entries.reserve(std::min<uint64_t>(count, size / 46));
+
+			for (size_t pos = 0; pos + 46 <= size; ) {
+				const uint8_t* header = directory + pos;
+				if (ReadU32(header) != 0x02014b50) return false;
+
+				uint16_t nameLength = ReadU16(header + 28);
+				uint16_t extraLength = ReadU16(header + 30);
+				uint16_t commentLength = ReadU16(header + 32);
+				if (pos + 46 + nameLength + extraLength > size) return false;
+
+				ZipEntry& entry = entries.emplace_back();
+				entry.method = ReadU16(header + 10);
+				entry.crc32 = ReadU32(header + 16);
+				entry.compressedSize = ReadU32(header + 20);
+				entry.uncompressedSize = ReadU32(header + 24);
+				entry.localHeaderOffset = ReadU32(header + 42);
+				entry.name.assign((const char*)header + 46, nameLength);
+
+				// Sizes and offsets that don't fit are in the zip64 extra field, in this order
+				const uint8_t* extra = header + 46 + nameLength;
+				for (size_t extraPos = 0; extraPos + 4 <= extraLength; ) {
+					uint16_t id = ReadU16(extra + extraPos);
+					uint16_t length = ReadU16(extra + extraPos + 2);
+
+					if (id == 0x0001) {
+						const uint8_t* field = extra + extraPos + 4;
+						const uint8_t* fieldEnd = field + std::min<size_t>(length, extraLength - extraPos - 4);
+
+						if (entry.uncompressedSize == 0xFFFFFFFF && field + 8 <= fieldEnd) { entry.uncompressedSize = ReadU64(field); field += 8; }
+						if (entry.compressedSize == 0xFFFFFFFF && field + 8 <= fieldEnd) { entry.compressedSize = ReadU64(field); field += 8; }
+						if (entry.localHeaderOffset == 0xFFFFFFFF && field + 8 <= fieldEnd) { entry.localHeaderOffset = ReadU64(field); }
+					}
+
+					extraPos += 4 + length;
+				}
+
+				pos += 46 + nameLength + extraLength + commentLength;
+			}
+
+			return true;
+		}
+
+		inline const ZipEntry* FindEntry(const std::vector<ZipEntry>& entries, std::string_view name) {
+			for (const ZipEntry& entry : entries) {
+				if (entry.name == name) return &entry;
+			}
+
+			return nullptr;
+		}
+
+		/**
+		 * @brief Checks if a file on disk has the same contents as an entry in a zip
+		 * @details The size is checked first, so most changed files are caught by a stat. Only files of the same size are read, and have their CRC-32 checked
+		 */
+		inline bool MatchesEntry(const std::string& path, const ZipEntry& entry) {
+			struct stat st;
+			if (stat(path.c_str(), &st) != 0 || (uint64_t)st.st_size != entry.uncompressedSize) return false;
+
+			uint32_t crc;
+			return FileCrc32(path, crc) && crc == entry.crc32;
+		}
+
+		/**
+		 * @brief Reads files out of a zip in process, instead of spawning unzip for each one
+		 * @details The zip is memory mapped, so the central directory and small files like the mod.json are read straight from the page cache.
+		 * Stored entries are copied to their destination by the kernel, and deflated entries are inflated straight from the mapping with zlib, which is SIMD accelerated in the zlib Android ships.
+		 * Every entry's CRC-32 is checked
+		 */
+		class ZipReader {
+		public:
+			ZipReader() = default;
+			ZipReader(const ZipReader&) = delete;
+			ZipReader& operator=(const ZipReader&) = delete;
+			~ZipReader() { Close(); }
+
+			/**
+			 * @brief Maps a zip and reads its central directory
+			 *
+			 * @return Returns false if the file isn't a zip
+			 */
+			bool Open(const std::string& path) {
+				Close();
+
+				m_Fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+				if (m_Fd < 0) return false;
+
+				struct stat st;
+				if (fstat(m_Fd, &st) != 0 || st.st_size == 0) {
+					Close();
+					return false;
+				}
+
+				void* mapping = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, m_Fd, 0);
+				if (mapping == MAP_FAILED) {
+					Close();
+					return false;
+				}
+
+				m_Data = (const uint8_t*)mapping;
+				m_Size = st.st_size;
+
+				uint64_t count;
+				if (!FindCentralDirectory(m_Data, m_Size, m_DirectoryOffset, m_DirectorySize, count) || !ParseCentralDirectory(m_Data + m_DirectoryOffset, m_DirectorySize, count, m_Entries)) {
+					Close();
+					return false;
+				}
+
+				Metrics::Add(Metrics::Counter::ArchivesOpened);
+				return true;
+			}
+
+			void Close() {
+				if (m_Data != nullptr) munmap((void*)m_Data, m_Size);
+				if (m_Fd >= 0) close(m_Fd);
+
+				m_Fd = -1;
+				m_Data = nullptr;
+				m_Size = 0;
+				m_Entries.clear();
+			}
+
+			bool IsOpen() const { return m_Data != nullptr; }
+
+			const std::vector<ZipEntry>& Entries() const { return m_Entries; }
+
+			const ZipEntry* Find(std::string_view name) const { return FindEntry(m_Entries, name); }
+
+			/**
+			 * @brief The raw bytes of the central directory
+			 */
+			std::string_view CentralDirectory() const { return std::string_view((const char*)m_Data + m_DirectoryOffset, m_DirectorySize); }
+
+			/**
+			 * @brief Gets a stored entry's contents straight from the mapping, without copying it. Only valid until the reader is closed
+			 *
+			 * @return Returns false if the entry is compressed, or its CRC-32 doesn't match
+			 */
+			bool View(const ZipEntry& entry, std::string_view& out) {
+				const uint8_t* data;
+				if (entry.method != 0 || !EntryData(entry, data) || Crc32(data, entry.compressedSize) != entry.crc32) return false;
+
+				out = std::string_view((const char*)data, entry.compressedSize);
+				return true;
+			}
+
+			/**
+			 * @brief Reads an entry into a buffer, null terminated so it can be parsed in situ
+			 */
+			bool Read(const ZipEntry& entry, std::vector<char>& out) {
+				out.clear();
+				out.reserve(entry.uncompressedSize + 1);
+
+				bool success = Decompress(entry, [&](const uint8_t* data, size_t size) {
+					out.insert(out.end(), (const char*)data, (const char*)data + size);
+					return true;
+				});
+
+				out.push_back('\0');
+				return success;
+			}
+
+			/**
+			 * @brief Writes an entry to a file. It's written next to the destination first, so a failed extraction never leaves a partial file behind
+			 *
+			 * @return Returns false if the entry couldn't be read, or its CRC-32 doesn't match
+			 */
+			bool Extract(const ZipEntry& entry, const std::string& destination) {
+				std::string tmpPath = destination + ".qmodtmp";
+
+				FileUtils::ScopedFd out(open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666));
+				if (out < 0) return false;
+
+				bool success;
+				if (entry.method == 0) {
+					success = CopyStored(entry, out);
+				} else {
+					success = Decompress(entry, [&](const uint8_t* data, size_t size) {
+						return WriteAll(out, data, size);
+					});
+				}
+
+				if (!success || rename(tmpPath.c_str(), destination.c_str()) != 0) {
+					unlink(tmpPath.c_str());
+					return false;
+				}
+
+				Metrics::Add(Metrics::Counter::EntriesExtracted);
+				return true;
+			}
+
+			bool Extract(std::string_view name, const std::string& destination) {
+				const ZipEntry* entry = Find(name);
+				return entry != nullptr && Extract(*entry, destination);
+			}
+
+		private:
+			int m_Fd = -1;
+			const uint8_t* m_Data = nullptr;
+			size_t m_Size = 0;
+
+			uint64_t m_DirectoryOffset = 0;
+			uint64_t m_DirectorySize = 0;
+			std::vector<ZipEntry> m_Entries;
+
+			static bool WriteAll(int fd, const uint8_t* data, size_t size) {
+				while (size > 0) {
+					size_t chunk = Background::WriteChunk(size);
+					if (!Background::ThrottleWrite(chunk)) return false;
+
+					ssize_t len = write(fd, data, chunk);
+
+					if (len < 0 && errno == EINTR) continue;
+					if (len <= 0) return false;
+
+					data += len;
+					size -= len;
+				}
+
+				return true;
+			}
+
+			/**
+			 * @brief Finds an entry's data in the mapping, which starts after its local header. The local header's name and extra field can differ from the central directory's
+			 */
+			bool EntryData(const ZipEntry& entry, const uint8_t*& data) const {
+				if (m_Data == nullptr || entry.localHeaderOffset + 30 > m_Size) return false;
+
+				const uint8_t* header = m_Data + entry.localHeaderOffset;
+				if (ReadU32(header) != 0x04034b50) return false;
+
+				uint64_t offset = entry.localHeaderOffset + 30 + ReadU16(header + 26) + ReadU16(header + 28);
+				if (offset > m_Size || entry.compressedSize > m_Size - offset) return false;
+
+				data = m_Data + offset;
+				return true;
+			}
+
+			/**
+			 * @brief Copies a stored entry from the zip's file descriptor to another, without it passing through user space
+			 * @details Uses copy_file_range, then sendfile if the filesystems don't support it. The CRC-32 is checked against the mapping, which only reads the page cache
+			 */
+			bool CopyStored(const ZipEntry& entry, int out) {
+				const uint8_t* data;
+				if (!EntryData(entry, data) || Crc32(data, entry.compressedSize) != entry.crc32) return false;
+
+				loff_t offset = data - m_Data;
+				uint64_t remaining = entry.compressedSize;
+				bool useSendfile = false;
+
+				while (remaining > 0) {
+					ssize_t len;
+
+					uint64_t chunk = Background::WriteChunk(remaining);
+					if (!Background::ThrottleWrite(chunk)) return false;
+
+					if (!useSendfile) {
+						// Called through syscall, as the libc wrapper needs a newer API level than we target
+						len = syscall(__NR_copy_file_range, m_Fd, &offset, out, nullptr, chunk, 0);
+
+						if (len < 0 && (errno == ENOSYS || errno == EXDEV || errno == EINVAL || errno == EOPNOTSUPP)) {
+							useSendfile = true;
+							continue;
+						}
+					} else {
+						off_t sendOffset = offset;
+						len = sendfile(out, m_Fd, &sendOffset, std::min<uint64_t>(chunk, 0x7ffff000));
+
+						if (len > 0) offset = sendOffset;
+					}
+
+					if (len < 0 && errno == EINTR) continue;
+
+					// Neither works, so write it from the mapping
+					if (len < 0) return WriteAll(out, m_Data + offset, remaining);
+					if (len == 0) return false;
+
+					remaining -= len;
+				}
+
+				return true;
+			}
+
+			/**
+			 * @brief Streams an entry's uncompressed contents into a sink, and checks its size and CRC-32
+			 */
+			template<typename Sink>
+			bool Decompress(const ZipEntry& entry, Sink&& sink) {
+				const uint8_t* data;
+				if (!EntryData(entry, data)) return false;
+
+				if (entry.method == 0) {
+					return Crc32(data, entry.compressedSize) == entry.crc32 && sink(data, entry.compressedSize);
+				}
+
+				if (entry.method != 8) return false;
+
+				std::vector<uint8_t> output(256 * 1024);
+				uint64_t remaining = entry.compressedSize;
+				uint64_t written = 0;
+				uint32_t crc = 0;
+
+				z_stream stream {};
+				if (inflateInit2(&stream, -MAX_WBITS) != Z_OK) return false;
+
+				stream.next_in = (Bytef*)data;
+
+				int result = Z_OK;
+				bool sinkFailed = false;
+
+				while (result != Z_STREAM_END) {
+					// avail_in is only 32 bits
+					if (stream.avail_in == 0) {
+						if (remaining == 0) break;
+
+						stream.avail_in = std::min<uint64_t>(remaining, 0x40000000);
+						remaining -= stream.avail_in;
+					}
+
+					stream.next_out = output.data();
+					stream.avail_out = output.size();
+
+					result = inflate(&stream, Z_NO_FLUSH);
+					if (result != Z_OK && result != Z_STREAM_END) break;
+
+					size_t produced = output.size() - stream.avail_out;
+					crc = Crc32(output.data(), produced, crc);
+					written += produced;
+
+					// Even on the last chunk, as the data never made it out
+					if (!sink(output.data(), produced)) {
+						sinkFailed = true;
+						break;
+					}
+				}
+
+				inflateEnd(&stream);
+
+				return !sinkFailed && result == Z_STREAM_END && written == entry.uncompressedSize && crc == entry.crc32;
+			}
+		};
+
+		/**
+		 * @brief Hashes a zip's central directory. Every entry's name, size and CRC-32 is in it, so this changes with the contents, but only a few KB are read
+		 *
+		 * @return Returns 0 if the file isn't a zip
+		 */
+		inline uint64_t CentralDirectoryHash(const std::string& path) {
+			ZipReader zip;
+			if (!zip.Open(path)) return 0;
+
+			uint64_t hash = 14695981039346656037ull;
+			for (char byte : zip.CentralDirectory()) {
+				hash ^= (uint8_t)byte;
+				hash *= 1099511628211ull;
+			}
+
+			return hash;
+		}
+	}
+}